@@ -0,0 +1,547 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"./machine.h"
+#include"./body/trace.h"
+#ifdef _WIN32
+#include<Windows.h>
+#else
+#include<pthread.h>
+#include<sched.h>
+#include<time.h>
+#include<unistd.h>
+#endif
+
+/*
+ * Batch runner, runs many headless machines at full speed.
+ *
+ *   my_gameboy_batch [-f frames] [-j threads] [-e engine] [-b boot] [-s scheme] rom...
+ *   my_gameboy_batch [-f frames] [-j threads] [-e engine] [-b boot] [-s scheme] -n seeds rom
+ *
+ * The first form runs every rom once without input,
+ * the second form runs one rom with seeds 0 .. seeds - 1,
+ * each seed drives its own pseudo random joypad presses.
+ *
+ * engine is interp(default), jit for native blocks, or diff which runs
+ * a jit machine and an interpreter machine side by side and reports
+ * the first frame their cpu or memory differ.
+ *
+ * boot is keep(default) to run the boot rom, or skip to start at the cart
+ * entry with the registers the boot rom leaves.
+ *
+ * scheme is the host colors of the 4 shades, which the screen hash
+ * depends on: green(default), gray, or 4 RRGGBB colors separated by
+ * commas, lightest first.
+ *
+ * Instances are stepped by slices of whole frames on a work stealing pool:
+ * every worker owns a deque of instances, runs a slice of the bottom one
+ * and pushes it back, a worker running out of instances steals the top one
+ * of another worker. So long and short roms keep every core busy.
+ */
+
+// 114 * 154 = 17556
+#define CYCLES_PER_FRAME 17556
+#define FRAMES_PER_SECOND 59.73
+
+#define DEFAULT_FRAMES 3600
+// Frames run before an instance goes back to the deque,
+// short enough for idle workers to steal the remaining ones.
+#define FRAMES_PER_SLICE 60
+#define MAX_WORKERS 64
+
+enum ENGINE {
+    ENGINE_INTERP,
+    ENGINE_JIT,
+    ENGINE_DIFF,
+};
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION batch_mutex;
+typedef HANDLE batch_thread;
+#define BATCH_THREAD_RETURN DWORD WINAPI
+#else
+typedef pthread_mutex_t batch_mutex;
+typedef pthread_t batch_thread;
+#define BATCH_THREAD_RETURN void *
+#endif
+
+struct instance {
+    const char *rom;
+    uint32_t seed;
+    int has_input;
+    uint32_t random;            // xorshift state of the joypad
+    enum BUTTON_TYPE button;    // button held during the last frame
+    uint32_t frames_done;
+    int failed;
+    int diverged;               // frames_done is the frame the engines differ
+    uint16_t pc;
+    uint32_t screen_hash;
+    struct gb_machine *gb;
+    struct gb_machine *twin;    // interpreter running beside gb in diff engine
+};
+
+struct worker {
+    batch_mutex lock;
+    uint32_t *jobs;             // ring buffer of instance indexes
+    uint32_t top;               // thieves take from top
+    uint32_t bottom;            // owner pushes and pops at bottom
+    uint32_t id;
+    batch_thread thread;
+};
+
+static struct instance *instances;
+static uint32_t instance_count;
+static uint32_t frames_target = DEFAULT_FRAMES;
+static enum ENGINE engine = ENGINE_INTERP;
+static uint32_t skip_boot;
+static const uint32_t *scheme = my_gb_screen_scheme_green;
+static uint32_t scheme_user[4];
+
+static struct worker workers[MAX_WORKERS];
+static uint32_t worker_count;
+
+static batch_mutex remaining_lock;
+static uint32_t remaining;
+
+static void _mutex_init(batch_mutex *m)
+{
+#ifdef _WIN32
+    InitializeCriticalSection(m);
+#else
+    pthread_mutex_init(m, NULL);
+#endif
+}
+
+static void _mutex_destroy(batch_mutex *m)
+{
+#ifdef _WIN32
+    DeleteCriticalSection(m);
+#else
+    pthread_mutex_destroy(m);
+#endif
+}
+
+static void _mutex_lock(batch_mutex *m)
+{
+#ifdef _WIN32
+    EnterCriticalSection(m);
+#else
+    pthread_mutex_lock(m);
+#endif
+}
+
+static void _mutex_unlock(batch_mutex *m)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(m);
+#else
+    pthread_mutex_unlock(m);
+#endif
+}
+
+static void _thread_yield(void)
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+static uint32_t _cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+#endif
+}
+
+static double _time_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, freq;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&freq);
+    return (double)counter.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Every instance lives in exactly one deque or is being run,
+// so a ring of instance_count entries never overflows.
+static void _deque_push(struct worker *w, uint32_t job)
+{
+    _mutex_lock(&w->lock);
+    w->jobs[w->bottom % instance_count] = job;
+    ++w->bottom;
+    _mutex_unlock(&w->lock);
+}
+
+static int _deque_pop(struct worker *w, uint32_t *job)
+{
+    int found = 0;
+    _mutex_lock(&w->lock);
+    if (w->bottom != w->top) {
+        --w->bottom;
+        *job = w->jobs[w->bottom % instance_count];
+        found = 1;
+    }
+    _mutex_unlock(&w->lock);
+    return found;
+}
+
+static int _deque_steal(struct worker *w, uint32_t *job)
+{
+    int found = 0;
+    _mutex_lock(&w->lock);
+    if (w->bottom != w->top) {
+        *job = w->jobs[w->top % instance_count];
+        ++w->top;
+        found = 1;
+    }
+    _mutex_unlock(&w->lock);
+    return found;
+}
+
+static uint32_t _remaining_get(void)
+{
+    uint32_t result;
+    _mutex_lock(&remaining_lock);
+    result = remaining;
+    _mutex_unlock(&remaining_lock);
+    return result;
+}
+
+static void _remaining_done(void)
+{
+    _mutex_lock(&remaining_lock);
+    --remaining;
+    _mutex_unlock(&remaining_lock);
+}
+
+// FNV-1a of the screen buffer, same frames give the same hash.
+static uint32_t _screen_hash(struct gb_machine *gb)
+{
+    uint32_t hash = 2166136261u;
+    const uint8_t *bytes = (const uint8_t *)gb->screen.screen_buffer;
+    for (size_t i = 0; i < sizeof(gb->screen.screen_buffer); ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Release the button of last frame, then press a new one 1/8 of frames.
+static void _instance_input(struct instance *it)
+{
+    uint32_t r = it->random;
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    it->random = r;
+
+    if (it->button != BUTTON_OTHERS) {
+        my_gb_input_callback(it->gb, it->button, EDGE_UP);
+        if (it->twin)
+            my_gb_input_callback(it->twin, it->button, EDGE_UP);
+        it->button = BUTTON_OTHERS;
+    }
+    if ((r & 0x7) == 0) {
+        it->button = (enum BUTTON_TYPE)(BUTTON_A + (r >> 3) % 8);
+        my_gb_input_callback(it->gb, it->button, EDGE_DOWN);
+        if (it->twin)
+            my_gb_input_callback(it->twin, it->button, EDGE_DOWN);
+    }
+}
+
+// Both engines run the same handlers, so registers, clock and memory
+// of the machines are equal after every frame.
+static int _machines_differ(struct gb_machine *a, struct gb_machine *b)
+{
+    return a->scheduler.clock != b->scheduler.clock
+        || a->cpu.AF != b->cpu.AF || a->cpu.BC != b->cpu.BC
+        || a->cpu.DE != b->cpu.DE || a->cpu.HL != b->cpu.HL
+        || a->cpu.SP != b->cpu.SP || a->cpu.PC != b->cpu.PC
+        || a->cpu.IME != b->cpu.IME || a->cpu.IF != b->cpu.IF
+        || memcmp(a->ram.ram, b->ram.ram, RAM_OFFSET_HRAM + 0x7F) != 0;
+}
+
+static struct gb_machine *_machine_new(const char *rom, uint32_t jit)
+{
+    struct gb_machine *gb = (struct gb_machine *)malloc(sizeof(struct gb_machine));
+    // a failed construct has destructed the parts it built, only gb is left
+    if (gb == NULL || my_gb_machine_construct(gb, rom, NULL) == -1) {
+        free(gb);
+        return NULL;
+    }
+    if (jit && my_gb_cpu_set_jit(gb, 1) == -1) {
+        fprintf(stderr, "native code is not available, running the interpreter.\n");
+    }
+    my_gb_screen_set_scheme(gb, scheme);
+    if (skip_boot)
+        my_gb_cpu_skip_boot(gb);
+    return gb;
+}
+
+static void _machine_delete(struct gb_machine *gb)
+{
+    if (gb == NULL)
+        return;
+    my_gb_machine_destruct(gb);
+    free(gb);
+}
+
+// Run one slice of the instance, return 1 when it is finished.
+static int _instance_slice(struct instance *it)
+{
+    if (it->gb == NULL) {
+        // construct on the worker, so construction runs in parallel too
+        it->gb = _machine_new(it->rom, engine != ENGINE_INTERP);
+        if (it->gb && engine == ENGINE_DIFF)
+            it->twin = _machine_new(it->rom, 0);
+        if (it->gb == NULL || (engine == ENGINE_DIFF && it->twin == NULL)) {
+            _machine_delete(it->gb);
+            it->gb = NULL;
+            it->failed = 1;
+            return 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < FRAMES_PER_SLICE && it->frames_done < frames_target; ++i) {
+        if (it->has_input)
+            _instance_input(it);
+        my_gb_machine_run(it->gb, CYCLES_PER_FRAME);
+        if (it->twin) {
+            my_gb_machine_run(it->twin, CYCLES_PER_FRAME);
+            if (_machines_differ(it->gb, it->twin)) {
+                it->diverged = 1;
+                break;
+            }
+        }
+        ++it->frames_done;
+    }
+    if (it->frames_done < frames_target && !it->diverged)
+        return 0;
+
+    it->pc = it->gb->cpu.PC;
+    it->screen_hash = _screen_hash(it->gb);
+    _machine_delete(it->gb);
+    _machine_delete(it->twin);
+    it->gb = NULL;
+    it->twin = NULL;
+    return 1;
+}
+
+static BATCH_THREAD_RETURN _worker_main(void *arg)
+{
+    struct worker *self = (struct worker *)arg;
+    uint32_t job;
+
+    for (;;) {
+        int found = _deque_pop(self, &job);
+        // own deque is empty, steal from the others
+        for (uint32_t i = 1; !found && i < worker_count; ++i)
+            found = _deque_steal(&workers[(self->id + i) % worker_count], &job);
+
+        if (!found) {
+            // the remaining instances are being run by other workers
+            if (_remaining_get() == 0)
+                break;
+            _thread_yield();
+            continue;
+        }
+
+        if (_instance_slice(&instances[job]))
+            _remaining_done();
+        else
+            _deque_push(self, job);
+    }
+    return 0;
+}
+
+static void _usage(void)
+{
+    fprintf(stderr,
+        "usage: my_gameboy_batch [-f frames] [-j threads] [-e interp|jit|diff] [-b keep|skip] [-s green|gray|c0,c1,c2,c3] rom...\n"
+        "       my_gameboy_batch [-f frames] [-j threads] [-e interp|jit|diff] [-b keep|skip] [-s green|gray|c0,c1,c2,c3] -n seeds rom\n");
+}
+
+// 4 RRGGBB colors separated by commas.
+static int _scheme_parse(const char *text, uint32_t colors[4])
+{
+    for (uint32_t i = 0; i < 4; ++i) {
+        char *end;
+        colors[i] = (uint32_t)strtoul(text, &end, 16);
+        if (end - text != 6 || *end != (i == 3 ? '\0' : ','))
+            return -1;
+        text = end + 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t threads = 0;
+    uint32_t seeds = 0;
+    int argi = 1;
+
+    for (; argi < argc && argv[argi][0] == '-'; ++argi) {
+        if (argi + 1 >= argc) {
+            _usage();
+            return -1;
+        }
+        if (strcmp(argv[argi], "-f") == 0) {
+            frames_target = (uint32_t)strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "-j") == 0) {
+            threads = (uint32_t)strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "-n") == 0) {
+            seeds = (uint32_t)strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "-e") == 0) {
+            ++argi;
+            if (strcmp(argv[argi], "interp") == 0) {
+                engine = ENGINE_INTERP;
+            } else if (strcmp(argv[argi], "jit") == 0) {
+                engine = ENGINE_JIT;
+            } else if (strcmp(argv[argi], "diff") == 0) {
+                engine = ENGINE_DIFF;
+            } else {
+                _usage();
+                return -1;
+            }
+        } else if (strcmp(argv[argi], "-b") == 0) {
+            ++argi;
+            if (strcmp(argv[argi], "keep") == 0) {
+                skip_boot = 0;
+            } else if (strcmp(argv[argi], "skip") == 0) {
+                skip_boot = 1;
+            } else {
+                _usage();
+                return -1;
+            }
+        } else if (strcmp(argv[argi], "-s") == 0) {
+            ++argi;
+            if (strcmp(argv[argi], "green") == 0) {
+                scheme = my_gb_screen_scheme_green;
+            } else if (strcmp(argv[argi], "gray") == 0) {
+                scheme = my_gb_screen_scheme_gray;
+            } else if (_scheme_parse(argv[argi], scheme_user) == 0) {
+                scheme = scheme_user;
+            } else {
+                _usage();
+                return -1;
+            }
+        } else {
+            _usage();
+            return -1;
+        }
+    }
+    if (argi >= argc || (seeds && argc - argi != 1)) {
+        _usage();
+        return -1;
+    }
+
+    instance_count = seeds ? seeds : (uint32_t)(argc - argi);
+    instances = (struct instance *)calloc(instance_count, sizeof(struct instance));
+    if (instances == NULL) {
+        fprintf(stderr, "instances allocation failed.\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < instance_count; ++i) {
+        struct instance *it = &instances[i];
+        it->rom = seeds ? argv[argi] : argv[argi + i];
+        it->seed = i;
+        it->has_input = seeds != 0;
+        // xorshift state must not be 0
+        it->random = (i + 1) * 2654435761u;
+        it->button = BUTTON_OTHERS;
+    }
+    remaining = instance_count;
+    // boot and interruption traces of every instance would bury the results
+    my_gb_trace_set_sink(NULL);
+
+    if (threads == 0)
+        threads = _cpu_count();
+    if (threads > instance_count)
+        threads = instance_count;
+    if (threads > MAX_WORKERS)
+        threads = MAX_WORKERS;
+    worker_count = threads;
+
+    _mutex_init(&remaining_lock);
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        _mutex_init(&workers[i].lock);
+        workers[i].jobs = (uint32_t *)malloc(instance_count * sizeof(uint32_t));
+        if (workers[i].jobs == NULL) {
+            fprintf(stderr, "worker allocation failed.\n");
+            return -1;
+        }
+        workers[i].top = 0;
+        workers[i].bottom = 0;
+        workers[i].id = i;
+    }
+    // deal instances out like cards, stealing evens out the rest
+    for (uint32_t i = 0; i < instance_count; ++i)
+        _deque_push(&workers[i % worker_count], i);
+
+    double time_start = _time_seconds();
+    // the main thread works as worker 0
+    for (uint32_t i = 1; i < worker_count; ++i) {
+#ifdef _WIN32
+        workers[i].thread = CreateThread(NULL, 0, _worker_main, &workers[i], 0, NULL);
+        if (workers[i].thread == NULL) {
+#else
+        if (pthread_create(&workers[i].thread, NULL, _worker_main, &workers[i]) != 0) {
+#endif
+            fprintf(stderr, "worker thread creation failed.\n");
+            return -1;
+        }
+    }
+    _worker_main(&workers[0]);
+    for (uint32_t i = 1; i < worker_count; ++i) {
+#ifdef _WIN32
+        WaitForSingleObject(workers[i].thread, INFINITE);
+        CloseHandle(workers[i].thread);
+#else
+        pthread_join(workers[i].thread, NULL);
+#endif
+    }
+    double time_used = _time_seconds() - time_start;
+
+    uint64_t frames_total = 0;
+    int failed = 0;
+    for (uint32_t i = 0; i < instance_count; ++i) {
+        struct instance *it = &instances[i];
+        frames_total += it->frames_done;
+        if (it->has_input)
+            printf("%4u %s seed=%u ", i, it->rom, it->seed);
+        else
+            printf("%4u %s ", i, it->rom);
+        if (it->failed) {
+            failed = 1;
+            printf("failed\n");
+        } else if (it->diverged) {
+            failed = 1;
+            printf("engines differ at frame %u PC=%04X\n", it->frames_done, it->pc);
+        } else {
+            printf("frames=%u PC=%04X screen=%08X\n", it->frames_done, it->pc, it->screen_hash);
+        }
+    }
+    printf("%u instances on %u threads, %llu frames in %.3fs, %.1f frames/sec (%.1fx real time)\n",
+        instance_count, worker_count, (unsigned long long)frames_total, time_used,
+        frames_total / time_used, frames_total / time_used / FRAMES_PER_SECOND);
+
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        _mutex_destroy(&workers[i].lock);
+        free(workers[i].jobs);
+    }
+    _mutex_destroy(&remaining_lock);
+    free(instances);
+    return failed ? -1 : 0;
+}
@@ -1,3172 +1,2755 @@
-#include"cpu.h"
-#include"../cart/cart.h"
-#include"ram.h"         // get offset of each ram chunk
-#include"input.h"       // get joypad IO registers
-#include"sound.h"       // get sound IO registers
-#include"screen.h"      // get screen IO registers
-
-#include<stdio.h>	    // for debug information output
-#include<stdlib.h>
-#include<stdint.h>
-
-
-static uint8_t *internal_ram;
-static uint8_t internal_rom[256] = {
-    0x31, 0xfe, 0xff, 0xaf, 0x21, 0xff, 0x9f, 0x32, 0xcb, 0x7c, 0x20, 0xfb,
-    0x21, 0x26, 0xff, 0x0e, 0x11, 0x3e, 0x80, 0x32, 0xe2, 0x0c, 0x3e, 0xf3,
-    0xe2, 0x32, 0x3e, 0x77, 0x77, 0x3e, 0xfc, 0xe0, 0x47, 0x11, 0x04, 0x01,
-    0x21, 0x10, 0x80, 0x1a, 0xcd, 0x95, 0x00, 0xcd, 0x96, 0x00, 0x13, 0x7b,
-    0xfe, 0x34, 0x20, 0xf3, 0x11, 0xd8, 0x00, 0x06, 0x08, 0x1a, 0x13, 0x22,
-    0x23, 0x05, 0x20, 0xf9, 0x3e, 0x19, 0xea, 0x10, 0x99, 0x21, 0x2f, 0x99,
-    0x0e, 0x0c, 0x3d, 0x28, 0x08, 0x32, 0x0d, 0x20, 0xf9, 0x2e, 0x0f, 0x18,
-    0xf3, 0x67, 0x3e, 0x64, 0x57, 0xe0, 0x42, 0x3e, 0x91, 0xe0, 0x40, 0x04,
-    0x1e, 0x02, 0x0e, 0x0c, 0xf0, 0x44, 0xfe, 0x90, 0x20, 0xfa, 0x0d, 0x20,
-    0xf7, 0x1d, 0x20, 0xf2, 0x0e, 0x13, 0x24, 0x7c, 0x1e, 0x83, 0xfe, 0x62,
-    0x28, 0x06, 0x1e, 0xc1, 0xfe, 0x64, 0x20, 0x06, 0x7b, 0xe2, 0x0c, 0x3e,
-    0x87, 0xe2, 0xf0, 0x42, 0x90, 0xe0, 0x42, 0x15, 0x20, 0xd2, 0x05, 0x20,
-    0x4f, 0x16, 0x20, 0x18, 0xcb, 0x4f, 0x06, 0x04, 0xc5, 0xcb, 0x11, 0x17,
-    0xc1, 0xcb, 0x11, 0x17, 0x05, 0x20, 0xf5, 0x22, 0x23, 0x22, 0x23, 0xc9,
-    0xce, 0xed, 0x66, 0x66, 0xcc, 0x0d, 0x00, 0x0b, 0x03, 0x73, 0x00, 0x83,
-    0x00, 0x0c, 0x00, 0x0d, 0x00, 0x08, 0x11, 0x1f, 0x88, 0x89, 0x00, 0x0e,
-    0xdc, 0xcc, 0x6e, 0xe6, 0xdd, 0xdd, 0xd9, 0x99, 0xbb, 0xbb, 0x67, 0x63,
-    0x6e, 0x0e, 0xec, 0xcc, 0xdd, 0xdc, 0x99, 0x9f, 0xbb, 0xb9, 0x33, 0x3e,
-    0x3c, 0x42, 0xb9, 0xa5, 0xb9, 0xa5, 0x42, 0x3c, 0x21, 0x04, 0x01, 0x11,
-    0xa8, 0x00, 0x1a, 0x13, 0xbe, 0x20, 0xfe, 0x23, 0x7d, 0xfe, 0x34, 0x20,
-    0xf5, 0x06, 0x19, 0x78, 0x86, 0x23, 0x05, 0x20, 0xfb, 0x86, 0x20, 0xfe,
-    0x3e, 0x01, 0xe0, 0x50
-};
-
-static uint32_t is_stopped;
-
-static uint16_t AF;
-static uint16_t BC;
-static uint16_t DE;
-static uint16_t HL;
-static uint16_t SP;
-static uint16_t PC;
-
-// bit mask of the interruptions
-// The bigger the value, the higher the priority
-#define INT_VBLANK_MASK 0x1
-#define INT_LCDC_STATUS_MASK 0x2
-#define INT_TIMER_OVERFLOW_MASK 0x4
-#define INT_SERIAL_TRANSFER_COMPLETION_MASK 0x8
-#define INT_BUTTON_PRESS_MASK 0x10
-
-#define INT_VBLANK_ADDRESS 0x0040
-#define INT_LCDC_STATUS_ADDRESS 0x0048
-#define INT_TIMER_OVERFLOW_ADDRESS 0x0050
-#define INT_SERIAL_TRANSFER_COMPLETION_ADDRESS 0x0058
-#define INT_BUTTON_PRESS_ADDRESS 0x0060
-
-// Currently we ensure only valid bits of the result can be 0 or 1,
-// invalid bit can only be 0.
-// Maybe we can do something to get rid of these duplicate defensive measure,
-// to squeeze the last drop of cpu performance.
-#define get_A ((uint8_t)(AF >> 8))
-#define get_B ((uint8_t)(BC >> 8))
-#define get_C ((uint8_t)(BC & (uint16_t)0x00FF))
-#define get_D ((uint8_t)(DE >> 8))
-#define get_E ((uint8_t)(DE & (uint16_t)0x00FF))
-#define get_H ((uint8_t)(HL >> 8))
-#define get_L ((uint8_t)(HL & (uint16_t)0x00FF))
-#define get_flag_Z (((uint8_t)AF >> 7) & (uint8_t)0x1)
-#define get_flag_N (((uint8_t)AF >> 6) & (uint8_t)0x1)
-#define get_flag_H (((uint8_t)AF >> 5) & (uint8_t)0x1)
-#define get_flag_C (((uint8_t)AF >> 4) & (uint8_t)0x1)
-
-#define set_A(a) do { AF = (AF & (uint16_t)0x00FF) | ((uint16_t)(a) << 8); } while(0)
-#define set_B(b) do { BC = (BC & (uint16_t)0x00FF) | ((uint16_t)(b) << 8); } while(0)
-#define set_C(c) do { BC = (BC & (uint16_t)0xFF00) | ((uint16_t)(c) & (uint16_t)0x00FF); } while(0)
-#define set_D(d) do { DE = (DE & (uint16_t)0x00FF) | ((uint16_t)(d) << 8); } while(0)
-#define set_E(e) do { DE = (DE & (uint16_t)0xFF00) | ((uint16_t)(e) & (uint16_t)0x00FF); } while(0)
-#define set_H(h) do { HL = (HL & (uint16_t)0x00FF) | ((uint16_t)(h) << 8); } while(0)
-#define set_L(l) do { HL = (HL & (uint16_t)0xFF00) | ((uint16_t)(l) & (uint16_t)0x00FF); } while(0)
-#define set_flag_Z(b) do { AF = (AF & ~((uint16_t)0x1 << 7)) | (((uint16_t)(b) & (uint16_t)0x1) << 7); } while(0)
-#define set_flag_N(b) do { AF = (AF & ~((uint16_t)0x1 << 6)) | (((uint16_t)(b) & (uint16_t)0x1) << 6); } while(0)
-#define set_flag_H(b) do { AF = (AF & ~((uint16_t)0x1 << 5)) | (((uint16_t)(b) & (uint16_t)0x1) << 5); } while(0)
-#define set_flag_C(b) do { AF = (AF & ~((uint16_t)0x1 << 4)) | (((uint16_t)(b) & (uint16_t)0x1) << 4); } while(0)
-
-// IO registers
-
-/*
-(ATTENTION: CURRENTLY NOT IMPLEMENTED!!!)
-FF01
-   Name     - SB
-   Contents - Serial transfer data (R/W)
-
-              8 Bits of data to be read/written
-
-(ATTENTION: CURRENTLY NOT IMPLEMENTED!!!)
-FF02
-   Name     - SC
-   Contents - SIO control  (R/W)
-
-              Bit 7 - Transfer Start Flag
-                      0: Non transfer
-                      1: Start transfer
-
-              Bit 0 - Shift Clock
-                      0: External Clock (500KHz Max.)
-                      1: Internal Clock (8192Hz)
-
-               Transfer is initiated by setting the
-              Transfer Start Flag. This bit may be read
-              and is automatically set to 0 at the end of
-              Transfer.
-
-               Transmitting and receiving serial data is
-              done simultaneously. The received data is
-              automatically stored in SB.
-
-FF04
-   Name     - DIV
-   Contents - Divider Register (R/W)
-
-              This register is incremented 16384 (~16779
-              on SGB) times a second. Writing any value
-              sets it to $00.
-FF05
-   Name     - TIMA
-   Contents - Timer counter (R/W)
-
-              This timer is incremented by a clock frequency
-              specified by the TAC register ($FF07). The timer
-              generates an interrupt when it overflows.
-
-FF06
-   Name     - TMA
-   Contents - Timer Modulo (R/W)
-
-              When the TIMA overflows, this data will be loaded.
-
-FF07
-   Name     - TAC
-   Contents - Timer Control (R/W)
-
-              Bit 2 - Timer Stop
-                      0: Stop Timer
-                      1: Start Timer
-
-              Bits 1+0 - Input Clock Select
-                         00: 4.096 KHz    (~4.194 KHz SGB)
-                         01: 262.144 KHz  (~268.4 KHz SGB)
-                         10: 65.536 KHz   (~67.11 KHz SGB)
-                         11: 16.384 KHz   (~16.78 KHz SGB)
-
-FF0F
-   Name     - IF
-   Contents - Interrupt Flag (R/W)
-
-              Bit 4: Transition from High to Low of Pin number P10-P13
-              Bit 3: Serial I/O transfer complete
-              Bit 2: Timer Overflow
-              Bit 1: LCDC (see STAT)
-              Bit 0: V-Blank
-
-   The priority and jump address for the above 5 interrupts are:
-
-    Interrupt        Priority        Start Address
-
-    V-Blank             1              $0040
-    LCDC Status         2              $0048 - Modes 0, 1, 2
-                                               LYC=LY coincide (selectable)
-    Timer Overflow      3              $0050
-    Serial Transfer     4              $0058 - when transfer is complete
-    Hi-Lo of P10-P13    5              $0060
-
-    * When more than 1 interrupts occur at the same time
-      only the interrupt with the highest priority can be
-      acknowledged. When an interrupt is used a '0' should
-      be stored in the IF register before the IE register
-      is set.
-
-FF50
-   NAME     - BOOT
-   Contents - Turn off boot rom (R?/W)
-
-FFFF
-   Name     - IE
-   Contents - Interrupt Enable (R/W)
-
-              Bit 4: Transition from High to Low of Pin
-                     number P10-P13.
-              Bit 3: Serial I/O transfer complete
-              Bit 2: Timer Overflow
-              Bit 1: LCDC (see STAT)
-              Bit 0: V-Blank
-
-              0: disable
-              1: enable
-
-*/
-uint8_t SB;
-uint8_t SC;
-uint8_t DIV;
-uint8_t TIMA;
-uint8_t TMA;
-uint8_t TAC;
-uint8_t IF;
-uint8_t BOOT;
-uint8_t IE;
-
-// Interrupt Master Enable flag
-// This register is not mapped to gameboy address space
-// 1. There are only two instruction we can add it
-// 2. This is a boolean value so only the LSB is used.
-uint8_t IME;
-
-
-static uint8_t _address_read(uint16_t address)
-{
-    // return 0xFF when invalid
-    uint8_t read_result;
-
-    if (address <= 0x00FF) {
-        //|------------------------------------------------------
-        //| (0x0000-0x00FF) internal ROM / non-switchable ROM BANK
-        //|------------------------------------------------------
-        if (_address_read(0xFF50)) {	// if bootstrap have been executed
-            read_result = my_gb_cart_address_read(address);
-        } else {
-            read_result = internal_rom[address];
-        }
-    } else if (address <= 0x3FFF) {
-        //|------------------------------------------------------
-        //| (0x00FF-0x3FFF) non-switchable ROM BANK
-        //|------------------------------------------------------
-        read_result = my_gb_cart_address_read(address);
-    } else if (address <= 0x7FFF) {
-        //|------------------------------------------------------
-        //| (0x4000-0x7FFF) switchable ROM BANK
-        //|------------------------------------------------------
-        read_result = my_gb_cart_address_read(address);
-    } else if (address <= 0x9FFF) {
-        //|------------------------------------------------------
-        //| (0x8000-0x9FFF)	Video RAM BANK
-        //|------------------------------------------------------
-        uint8_t lcd_state = _address_read(0xFF41) & 0x3;
-        if (lcd_state == 3) {
-            fprintf(stderr, "LCD state: %d and VRAM cannot be accessed.\n", lcd_state);
-            read_result = 0xFF;
-        } else {
-            read_result = internal_ram[address - 0x8000 + RAM_OFFSET_VRAM];
-        }
-    } else if (address <= 0xBFFF) {
-        //|------------------------------------------------------
-        //| (0xA000-0xBFFF)	switchable Cartridge RAM BANK
-        //|------------------------------------------------------
-        read_result = my_gb_cart_address_read(address);
-    } else if (address <= 0xDFFF) {
-        //|------------------------------------------------------
-        //| (0xC000-0xDFFF) Game Boy internal RAM BANK
-        //|------------------------------------------------------
-        read_result = internal_ram[address - 0xC000 + RAM_OFFSET_INTERNAL_RAM];
-    } else if (address <= 0xFDFF) {
-        //|------------------------------------------------------
-        //| (0xE000-0xFDFF) echo of Game Boy internal RAM BANK
-        //|------------------------------------------------------
-        read_result = internal_ram[address - 0xE000 + RAM_OFFSET_INTERNAL_RAM];
-    } else if (address <= 0xFE9F) {
-        //|------------------------------------------------------
-        //| (0xFE00-0xFE9F) Object Attribute Memory(Sprite information table)
-        //|------------------------------------------------------
-        read_result = internal_ram[address - 0xFE00 + RAM_OFFSET_OAM];
-    } else if (address <= 0xFEFF) {
-        //|------------------------------------------------------
-        //| (0xFEA0-0xFEFF) Unused memory
-        //|------------------------------------------------------
-        fprintf(stderr, "Access to unused memory(%16X) was denied.\n", address);
-        read_result = 0xFF;
-    } else if (address <= 0xFF7F) {
-        //|------------------------------------------------------
-        //| (0xFF00-0xFF7F) Game Boy I/O registers
-        //|------------------------------------------------------
-
-        // Currently doesn't care about the register readability and writability
-        // We assume cart rom writer is smart and don't touch UB of gameboy.
-        // If necessary, UB behavior will be added.
-        if (address == 0xFF00) {
-            read_result = P1;
-        } else if (address == 0xFF01) {
-            read_result = SB;
-        } else if (address == 0xFF02) {
-            read_result = SC;
-        } else if (address == 0xFF03) {
-            read_result = DIV;
-        } else if (address == 0xFF04) {
-            read_result = TIMA;
-        } else if (address == 0xFF05) {
-            read_result = TMA;
-        } else if (address == 0xFF06) {
-            read_result = TAC;
-        } else if (address == 0xFF0F) {
-            read_result = IF;
-        } else if (address == 0xFF10) {
-            read_result = NR10;
-        } else if (address == 0xFF11) {
-            read_result = NR11;
-        } else if (address == 0xFF12) {
-            read_result = NR12;
-        } else if (address == 0xFF13) {
-            read_result = NR13;
-        } else if (address == 0xFF14) {
-            read_result = NR14;
-        } else if (address == 0xFF16) {
-            read_result = NR21;
-        } else if (address == 0xFF17) {
-            read_result = NR22;
-        } else if (address == 0xFF18) {
-            read_result = NR23;
-        } else if (address == 0xFF19) {
-            read_result = NR24;
-        } else if (address == 0xFF1A) {
-            read_result = NR30;
-        } else if (address == 0xFF1B) {
-            read_result = NR31;
-        } else if (address == 0xFF1C) {
-            read_result = NR32;
-        } else if (address == 0xFF1D) {
-            read_result = NR33;
-        } else if (address == 0xFF1E) {
-            read_result = NR34;
-        } else if (address == 0xFF20) {
-            read_result = NR41;
-        } else if (address == 0xFF21) {
-            read_result = NR42;
-        } else if (address == 0xFF22) {
-            read_result = NR43;
-        } else if (address == 0xFF23) {
-            read_result = NR44;
-        } else if (address == 0xFF24) {
-            read_result = NR50;
-        } else if (address == 0xFF25) {
-            read_result = NR51;
-        } else if (address == 0xFF26) {
-            read_result = NR52;
-        } else if (address >= 0xFF30 && address < 0xFF40) {
-            read_result = W[address - 0xFF30];
-        } else if (address == 0xFF40) {
-            read_result = LCDC;
-        } else if (address == 0xFF41) {
-            read_result = STAT;
-        } else if (address == 0xFF42) {
-            read_result = SCY;
-        } else if (address == 0xFF43) {
-            read_result = SCX;
-        } else if (address == 0xFF44) {
-            read_result = LY;
-        } else if (address == 0xFF45) {
-            read_result = LYC;
-        } else if (address == 0xFF46) {
-            read_result = DMA;
-        } else if (address == 0xFF47) {
-            read_result = BGP;
-        } else if (address == 0xFF48) {
-            read_result = OBP0;
-        } else if (address == 0xFF49) {
-            read_result = OBP1;
-        } else if (address == 0xFF4A) {
-            read_result = WY;
-        } else if (address == 0xFF4B) {
-            read_result = WX;
-        } else if (address == 0xFF50) {
-            read_result = BOOT;
-        } else {
-            fprintf(stderr, "Cart want to touch the unused IO register area(%16X).\n", address);
-            read_result = 0xFF;
-        }
-    } else if (address <= 0xFFFE) {
-        //|------------------------------------------------------
-        //| (0xFF80-0xFFFE) Internal RAM(Heap RAM) in Game Boy(often used as stack)
-        //|------------------------------------------------------
-        read_result = internal_ram[address - 0xFF80 + RAM_OFFSET_HRAM];
-    } else { //if (address <= 0xFFFF) {
-        //|------------------------------------------------------
-        //| (0xFFFF-0xFFFF) Interrupt enable flag
-        //|------------------------------------------------------
-        read_result = IE;
-    }
-    return read_result;
-}
-
-static uint16_t _address_read_16(uint16_t address)
-{
-    uint16_t data = (uint16_t)_address_read(address);
-    data |= ((uint16_t)_address_read(address + 1)) << 8;
-    return data;
-}
-
-static void _address_write(uint16_t address, uint8_t data)
-{
-    if (address <= 0x7FFF) {
-        //|------------------------------------------------------
-        //| (0x0000-0x3FFF) non-switchable ROM BANK
-        //|------------------------------------------------------
-        //|------------------------------------------------------
-        //| (0x4000-0x7FFF) switchable ROM BANK
-        //|------------------------------------------------------
-        fprintf(stderr, "Failed to write to ROM area(%16X).\n", address);
-    } else if (address <= 0x9FFF) {
-        //|------------------------------------------------------
-        //| (0x8000-0x9FFF)	Video RAM BANK
-        //|------------------------------------------------------
-        internal_ram[address - 0x8000 + RAM_OFFSET_VRAM] = data;
-    } else if (address <= 0xBFFF) {
-        //|------------------------------------------------------
-        //| (0xA000-0xBFFF)	switchable Cartridge RAM BANK
-        //|------------------------------------------------------
-        my_gb_cart_address_write(address, data);
-    } else if (address <= 0xDFFF) {
-        //|------------------------------------------------------
-        //| (0xC000-0xDFFF) Game Boy internal RAM BANK
-        //|------------------------------------------------------
-        internal_ram[address - 0xC000 + RAM_OFFSET_INTERNAL_RAM] = data;
-    } else if (address <= 0xFDFF) {
-        //|------------------------------------------------------
-        //| (0xE000-0xFDFF) echo of Game Boy internal RAM BANK
-        //|------------------------------------------------------
-        internal_ram[address - 0xE000 + RAM_OFFSET_INTERNAL_RAM] = data;
-    } else if (address <= 0xFE9F) {
-        //|------------------------------------------------------
-        //| (0xFE00-0xFE9F) Object Attribute Memory(Sprite information table)
-        //|------------------------------------------------------
-        internal_ram[address - 0xFE00 + RAM_OFFSET_OAM] = data;
-    } else if (address <= 0xFEFF) {
-        //|------------------------------------------------------
-        //| (0xFEA0-0xFEFF) Unused memory
-        //|------------------------------------------------------
-        fprintf(stderr, "Failed to write to unused memory(%16X).\n", address);
-    } else if (address <= 0xFF7F) {
-        //|------------------------------------------------------
-        //| (0xFF00-0xFF7F) Game Boy I/O registers
-        //|------------------------------------------------------
-        // Implementations needed.
-        // Should refer to the documents for each I/O registers to check if it is mutable
-        // and also implement the UB if needed
-        if (address == 0xFF00) {
-            P1 = data;
-        } else if (address == 0xFF01) {
-            SB = data;
-        } else if (address == 0xFF02) {
-            SC = data;
-        } else if (address == 0xFF03) {
-            DIV = data;
-        } else if (address == 0xFF04) {
-            TIMA = data;
-        } else if (address == 0xFF05) {
-            TMA = data;
-        } else if (address == 0xFF06) {
-            TAC = data;
-        } else if (address == 0xFF0F) {
-            IF = data;
-        } else if (address == 0xFF10) {
-            NR10 = data;
-        } else if (address == 0xFF11) {
-            NR11 = data;
-        } else if (address == 0xFF12) {
-            NR12 = data;
-        } else if (address == 0xFF13) {
-            NR13 = data;
-        } else if (address == 0xFF14) {
-            NR14 = data;
-        } else if (address == 0xFF16) {
-            NR21 = data;
-        } else if (address == 0xFF17) {
-            NR22 = data;
-        } else if (address == 0xFF18) {
-            NR23 = data;
-        } else if (address == 0xFF19) {
-            NR24 = data;
-        } else if (address == 0xFF1A) {
-            NR30 = data;
-        } else if (address == 0xFF1B) {
-            NR31 = data;
-        } else if (address == 0xFF1C) {
-            NR32 = data;
-        } else if (address == 0xFF1D) {
-            NR33 = data;
-        } else if (address == 0xFF1E) {
-            NR34 = data;
-        } else if (address == 0xFF20) {
-            NR41 = data;
-        } else if (address == 0xFF21) {
-            NR42 = data;
-        } else if (address == 0xFF22) {
-            NR43 = data;
-        } else if (address == 0xFF23) {
-            NR44 = data;
-        } else if (address == 0xFF24) {
-            NR50 = data;
-        } else if (address == 0xFF25) {
-            NR51 = data;
-        } else if (address == 0xFF26) {
-            NR52 = data;
-        } else if (address >= 0xFF30 && address < 0xFF40) {
-            W[address - 0xFF30] = data;
-        } else if (address == 0xFF40) {
-            LCDC = data;
-        } else if (address == 0xFF41) {
-            STAT = data;
-        } else if (address == 0xFF42) {
-            SCY = data;
-        } else if (address == 0xFF43) {
-            SCX = data;
-        } else if (address == 0xFF44) {
-            LY = data;
-        } else if (address == 0xFF45) {
-            LYC = data;
-        } else if (address == 0xFF46) {
-            DMA = data;
-        } else if (address == 0xFF47) {
-            BGP = data;
-        } else if (address == 0xFF48) {
-            OBP0 = data;
-        } else if (address == 0xFF49) {
-            OBP1 = data;
-        } else if (address == 0xFF4A) {
-            WY = data;
-        } else if (address == 0xFF4B) {
-            WX = data;
-        } else if (address == 0xFF50) {
-            BOOT = data;
-        } else {
-            fprintf(stderr, "Cart want to touch the unused IO register area(%16X).\n", address);
-        }
-    } else if (address <= 0xFFFE) {
-        //|------------------------------------------------------
-        //| (0xFF80-0xFFFE) Internal RAM in Game Boy(often used as stack)
-        //|------------------------------------------------------
-        internal_ram[address - 0xFF80 + RAM_OFFSET_HRAM] = data;
-    } else /*if (address <= 0xFFFF)*/ {
-        //|------------------------------------------------------
-        //| (0xFFFF-0xFFFF) Interrupt enable flag
-        //|------------------------------------------------------
-        IE = data;
-    }
-}
-
-static void _address_write_16(uint16_t address, uint16_t data_16)
-{
-    // consider situation that write a word across two memory bank into consideration
-    // so split data_16 to write
-    _address_write(address, (uint8_t)data_16);
-    _address_write(address + 1, (uint8_t)(data_16 >> 8));
-}
-
-static int _RLC(int i)
-{
-    int cycles;
-
-    set_flag_N(0);
-    set_flag_H(0);
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// RLC B
-        cycles = 2;
-        set_flag_C(get_B >> 7);
-        set_B(get_B << 1);
-        set_flag_Z(!get_B);
-        break;
-    case 1:		// RLC C
-        cycles = 2;
-        set_flag_C(get_C >> 7);
-        set_C(get_C << 1);
-        set_flag_Z(!get_C);
-        break;
-    case 2:		// RLC D
-        cycles = 2;
-        set_flag_C(get_D >> 7);
-        set_D(get_D << 1);
-        set_flag_Z(!get_D);
-        break;
-    case 3:		// RLC E
-        cycles = 2;
-        set_flag_C(get_E >> 7);
-        set_E(get_E << 1);
-        set_flag_Z(!get_E);
-        break;
-    case 4:		// RLC H
-        cycles = 2;
-        set_flag_C(get_H >> 7);
-        set_H(get_H << 1);
-        set_flag_Z(!get_H);
-        break;
-    case 5:		// RLC L
-        cycles = 2;
-        set_flag_C(get_L >> 7);
-        set_L(get_L << 1);
-        set_flag_Z(!get_L);
-        break;
-    case 6:		// RLC (HL)
-        cycles = 4;
-        data_8 = _address_read(HL);
-        set_flag_C(data_8 >> 7);
-        data_8 <<= 1;
-        _address_write(HL, data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 7:		// RLC A
-        cycles = 2;
-        set_flag_C(get_A >> 7);
-        set_A(get_A << 1);
-        set_flag_Z(!get_A);
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal parameter for RLC.\n");
-        break;
-    }
-    return cycles;
-}
-
-static int _RRC(int i)
-{
-    int cycles;
-
-    set_flag_N(0);
-    set_flag_H(0);
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// RRC B
-        cycles = 2;
-        set_flag_C(get_B & (uint8_t)0x01);
-        set_B(get_B >> 1);
-        set_flag_Z(!get_B);
-        break;
-    case 1:		// RRC C
-        cycles = 2;
-        set_flag_C(get_C & (uint8_t)0x01);
-        set_C(get_C >> 1);
-        set_flag_Z(!get_C);
-        break;
-    case 2:		// RRC D
-        cycles = 2;
-        set_flag_C(get_D & (uint8_t)0x01);
-        set_D(get_D >> 1);
-        set_flag_Z(!get_D);
-        break;
-    case 3:		// RRC E
-        cycles = 2;
-        set_flag_C(get_E & (uint8_t)0x01);
-        set_E(get_E >> 1);
-        set_flag_Z(!get_E);
-        break;
-    case 4:		// RRC H
-        cycles = 2;
-        set_flag_C(get_H & (uint8_t)0x01);
-        set_H(get_H >> 1);
-        set_flag_Z(!get_H);
-        break;
-    case 5:		// RRC L
-        cycles = 2;
-        set_flag_C(get_L & (uint8_t)0x01);
-        set_L(get_L >> 1);
-        set_flag_Z(!get_L);
-        break;
-    case 6:		// RRC (HL)
-        cycles = 4;
-        data_8 = _address_read(HL);
-        set_flag_C(data_8 & (uint8_t)0x01);
-        data_8 >>= 1;
-        _address_write(HL, data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 7:		// RRC A
-        cycles = 2;
-        set_flag_C(get_A & (uint8_t)0x01);
-        set_A(get_A >> 1);
-        set_flag_Z(!get_A);
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal parameter for RRC.\n");
-        break;
-    }
-    return cycles;
-}
-
-static int _RL(int i)
-{
-    int cycles;
-
-    set_flag_N(0);
-    set_flag_H(0);
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// RL B
-        cycles = 2;
-        data_8 = (get_B << 1) | get_flag_C;
-        set_flag_C(get_B >> 7);
-        set_B(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 1:		// RL C
-        cycles = 2;
-        data_8 = (get_C << 1) | get_flag_C;
-        set_flag_C(get_C >> 7);
-        set_C(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 2:		// RL D
-        cycles = 2;
-        data_8 = (get_D << 1) | get_flag_C;
-        set_flag_C(get_D >> 7);
-        set_D(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 3:		// RL E
-        cycles = 2;
-        data_8 = (get_E << 1) | get_flag_C;
-        set_flag_C(get_E >> 7);
-        set_E(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 4:		// RL H
-        cycles = 2;
-        data_8 = (get_H << 1) | get_flag_C;
-        set_flag_C(get_H >> 7);
-        set_H(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 5:		// RL L
-        cycles = 2;
-        data_8 = (get_L << 1) | get_flag_C;
-        set_flag_C(get_L >> 7);
-        set_L(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 6:		// RL (HL)
-        cycles = 4;
-        data_8 = _address_read(HL) | get_flag_C;
-        set_flag_C(_address_read(HL) >> 7);
-        _address_write(HL, data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 7:		// RL A
-        cycles = 2;
-        data_8 = (get_A << 1) | get_flag_C;
-        set_flag_C(get_A >> 7);
-        set_A(data_8);
-        set_flag_Z(!data_8);
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal parameter for RL.\n");
-        break;
-    }
-    return cycles;
-}
-
-static int _RR(int i)
-{
-    int cycles;
-
-    set_flag_N(0);
-    set_flag_H(0);
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// RR B
-        cycles = 2;
-        data_8 = (get_B >> 1) | (get_flag_C << 7);
-        set_flag_C(get_B & (uint8_t)0x01);
-        set_B(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 1:		// RR C
-        cycles = 2;
-        data_8 = (get_C >> 1) | (get_flag_C << 7);
-        set_flag_C(get_C & (uint8_t)0x01);
-        set_C(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 2:		// RR D
-        cycles = 2;
-        data_8 = (get_D >> 1) | (get_flag_C << 7);
-        set_flag_C(get_D & (uint8_t)0x01);
-        set_D(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 3:		// RR E
-        cycles = 2;
-        data_8 = (get_E >> 1) | (get_flag_C << 7);
-        set_flag_C(get_E & (uint8_t)0x01);
-        set_E(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 4:		// RR H
-        cycles = 2;
-        data_8 = (get_H >> 1) | (get_flag_C << 7);
-        set_flag_C(get_H & (uint8_t)0x01);
-        set_H(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 5:		// RR L
-        cycles = 2;
-        data_8 = (get_L >> 1) | (get_flag_C << 7);
-        set_flag_C(get_L & (uint8_t)0x01);
-        set_L(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 6:		// RR (HL)
-        cycles = 4;
-        data_8 = (_address_read(HL) >> 1) | (get_flag_C << 7);
-        set_flag_C(_address_read(HL) & (uint8_t)0x01);
-        _address_write(HL, data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 7:		// RR A
-        cycles = 2;
-        data_8 = (get_A >> 1) | (get_flag_C << 7);
-        set_flag_C(get_A & (uint8_t)0x01);
-        set_A(data_8);
-        set_flag_Z(!data_8);
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal parameter for RR.\n");
-        break;
-    }
-    return cycles;
-}
-
-static int _SLA(int i)
-{
-    int cycles;
-
-    set_flag_N(0);
-    set_flag_H(0);
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// SLA A
-        cycles = 2;
-        set_flag_C(get_A >> 7);
-        set_A(get_A << 1);
-        set_flag_Z(!get_A);
-        break;
-    case 1:		// SLA B
-        cycles = 2;
-        set_flag_C(get_B >> 7);
-        set_B(get_B << 1);
-        set_flag_Z(!get_B);
-        break;
-    case 2:		// SLA C
-        cycles = 2;
-        set_flag_C(get_C >> 7);
-        set_C(get_C << 1);
-        set_flag_Z(!get_C);
-        break;
-    case 3:		// SLA D
-        cycles = 2;
-        set_flag_C(get_D >> 7);
-        set_D(get_D << 1);
-        set_flag_Z(!get_D);
-        break;
-    case 4:		// SLA H
-        cycles = 2;
-        set_flag_C(get_H >> 7);
-        set_H(get_H << 1);
-        set_flag_Z(!get_H);
-        break;
-    case 5:		// SLA L
-        cycles = 2;
-        set_flag_C(get_L >> 7);
-        set_L(get_L << 1);
-        set_flag_Z(!get_L);
-        break;
-    case 6:		// SLA (HL)
-        cycles = 4;
-        data_8 = _address_read(HL);
-        set_flag_C(data_8 >> 7);
-        data_8 <<= 1;
-        _address_write(HL, data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 7:		// SLA A
-        cycles = 2;
-        set_flag_C(get_A >> 7);
-        set_A(get_A << 1);
-        set_flag_Z(!get_A);
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal instruction in SLA");
-        break;
-    }
-    return cycles;
-}
-
-static int _SRA(int i)
-{
-    int cycles;
-
-    set_flag_N(0);
-    set_flag_H(0);
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// SRA B
-        cycles = 2;
-        set_flag_C(get_B & 0x1);
-        set_B((get_B >> 1) | (get_B & 0x80));
-        set_flag_Z(!get_B);
-        break;
-    case 1:		// SRA C
-        cycles = 2;
-        set_flag_C(get_C & 0x1);
-        set_C((get_C >> 1) | (get_C & 0x80));
-        set_flag_Z(!get_C);
-        break;
-    case 2:		// SRA D
-        cycles = 2;
-        set_flag_C(get_D & 0x1);
-        set_D((get_D >> 1) | (get_D & 0x80));
-        set_flag_Z(!get_D);
-        break;
-    case 3:		// SRA E
-        cycles = 2;
-        set_flag_C(get_E & 0x1);
-        set_A((get_E >> 1) | (get_E & 0x80));
-        set_flag_Z(!get_E);
-        break;
-    case 4:		// SRA H
-        cycles = 2;
-        set_flag_C(get_H & 0x1);
-        set_H((get_H >> 1) | (get_H & 0x80));
-        set_flag_Z(!get_H);
-        break;
-    case 5:		// SRA L
-        cycles = 2;
-        set_flag_C(get_L & 0x1);
-        set_L((get_L >> 1) | (get_L & 0x80));
-        set_flag_Z(!get_L);
-        break;
-    case 6:		// SRA (HL)
-        cycles = 4;
-        data_8 = _address_read(HL);
-        set_flag_C(data_8 & 0x1);
-        data_8 = (data_8 >> 1) | (data_8 & 0x80);
-        _address_write(HL, data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 7:		// SRA A
-        cycles = 2;
-        set_flag_C(get_A & 0x1);
-        set_A((get_A >> 1) | (get_A & 0x80));
-        set_flag_Z(!get_A);
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal instruction in SRA");
-        break;
-    }
-    return cycles;
-}
-
-static int _SWAP(int i)
-{
-    int cycles;
-
-    set_flag_N(0);
-    set_flag_H(0);
-    set_flag_C(0);
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// SWAP B
-        cycles = 2;
-        set_B(((get_B & 0x0F) << 4) | (get_B >> 4));
-        set_flag_Z(!get_B);
-        break;
-    case 1:		// SWAP C
-        cycles = 2;
-        set_C(((get_C & 0x0F) << 4) | (get_C >> 4));
-        set_flag_Z(!get_C);
-        break;
-    case 2:		// SWAP D
-        cycles = 2;
-        set_D(((get_D & 0x0F) << 4) | (get_D >> 4));
-        set_flag_Z(!get_D);
-        break;
-    case 3:		// SWAP E
-        cycles = 2;
-        set_E(((get_E & 0x0F) << 4) | (get_E >> 4));
-        set_flag_Z(!get_E);
-        break;
-    case 4:		// SWAP H
-        cycles = 2;
-        set_H(((get_H & 0x0F) << 4) | (get_H >> 4));
-        set_flag_Z(!get_H);
-        break;
-    case 5:		// SWAP L
-        cycles = 2;
-        set_L(((get_L & 0x0F) << 4) | (get_L >> 4));
-        set_flag_Z(!get_L);
-        break;
-    case 6:		// SWAP (HL)
-        cycles = 4;
-        data_8 = _address_read(HL);
-        data_8 = ((data_8 & 0x0F) << 4) | (data_8 >> 4);
-        _address_write(HL, data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 7:		// SWAP A
-        cycles = 2;
-        set_A(((get_A & 0x0F) << 4) | (get_A >> 4));
-        set_flag_Z(!get_A);
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal SWAP command");
-        break;
-    }
-    return cycles;
-}
-
-static int _SRL(int i)
-{
-    int cycles;
-
-    set_flag_N(0);
-    set_flag_H(0);
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// SRL B
-        cycles = 2;
-        set_flag_C(get_B & 0x1);
-        set_B(get_B >> 1);
-        set_flag_Z(!get_B);
-        break;
-    case 1:		// SRL C
-        cycles = 2;
-        set_flag_C(get_C & 0x1);
-        set_C(get_C >> 1);
-        set_flag_Z(!get_C);
-        break;
-    case 2:		// SRL D
-        cycles = 2;
-        set_flag_C(get_D & 0x1);
-        set_D(get_D >> 1);
-        set_flag_Z(!get_D);
-        break;
-    case 3:		// SRL E
-        cycles = 2;
-        set_flag_C(get_E & 0x1);
-        set_A(get_E >> 1);
-        set_flag_Z(!get_E);
-        break;
-    case 4:		// SRL H
-        cycles = 2;
-        set_flag_C(get_H & 0x1);
-        set_H(get_H >> 1);
-        set_flag_Z(!get_H);
-        break;
-    case 5:		// SRL L
-        cycles = 2;
-        set_flag_C(get_L & 0x1);
-        set_L(get_L >> 1);
-        set_flag_Z(!get_L);
-        break;
-    case 6:		// SRL (HL)
-        cycles = 4;
-        data_8 = _address_read(HL);
-        set_flag_C(data_8 & 0x1);
-        data_8 = data_8 >> 1;
-        _address_write(HL, data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 7:		// SRL A
-        cycles = 2;
-        set_flag_C(get_A & 0x1);
-        set_A(get_A >> 1);
-        set_flag_Z(!get_A);
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal instruction in SRL");
-        break;
-    }
-    return cycles;
-}
-
-static int _BIT(int bit, int i)
-{
-    int cycles;
-
-    set_flag_N(0);
-    set_flag_H(0);
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// BIT bit, B
-        cycles = 2;
-        set_flag_Z(!((get_B >> bit) & 0x1));
-        break;
-    case 1:		// BIT bit, C
-        cycles = 2;
-        set_flag_Z(!((get_C >> bit) & 0x1));
-        break;
-    case 2:		// BIT bit, D
-        cycles = 2;
-        set_flag_Z(!((get_D >> bit) & 0x1));
-        break;
-    case 3:		// BIT bit, E
-        cycles = 2;
-        set_flag_Z(!((get_E >> bit) & 0x1));
-        break;
-    case 4:		// BIT bit, H
-        cycles = 2;
-        set_flag_Z(!((get_H >> bit) & 0x1));
-        break;
-    case 5:		// BIT bit, L
-        cycles = 2;
-        set_flag_Z(!((get_L >> bit) & 0x1));
-        break;
-    case 6:		// BIT bit, (HL)
-        cycles = 4;
-        data_8 = _address_read(HL);
-        set_flag_Z(!((data_8 >> bit) & 0x1));
-        break;
-    case 7:		// BIT bit, A
-        cycles = 2;
-        set_flag_Z(!((get_A >> bit) & 0x1));
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal instruction in BIT.\n");
-    }
-    return cycles;
-}
-
-static int _RES(int bit, int i)
-{
-    int cycles;
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// RES bit, B
-        cycles = 2;
-        set_B(get_B & ~(0x1 << bit));
-        break;
-    case 1:		// RES bit, C
-        cycles = 2;
-        set_C(get_C & ~(0x1 << bit));
-        break;
-    case 2:		// RES bit, D
-        cycles = 2;
-        set_D(get_D & ~(0x1 << bit));
-        break;
-    case 3:		// RES bit, E
-        cycles = 2;
-        set_E(get_E & ~(0x1 << bit));
-        break;
-    case 4:		// RES bit, H
-        cycles = 2;
-        set_H(get_H & ~(0x1 << bit));
-        break;
-    case 5:		// RES bit, L
-        cycles = 2;
-        set_L(get_L & ~(0x1 << bit));
-        break;
-    case 6:		// RES bit, (HL)
-        cycles = 4;
-        data_8 = _address_read(HL) & ~(0x1 << bit);
-        _address_write(HL, data_8);
-        break;
-    case 7:		// RES bit, A
-        cycles = 2;
-        set_A(get_A & ~(0x1 << bit));
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal instruction in RES");
-        break;
-    }
-    return cycles;
-}
-
-static int _SET(int bit, int i)
-{
-    int cycles;
-
-    uint8_t data_8;
-    switch (i) {
-    case 0:		// SET bit, B
-        cycles = 2;
-        set_B(get_B | (0x1 << bit));
-        break;
-    case 1:		// SET bit, C
-        cycles = 2;
-        set_C(get_C | (0x1 << bit));
-        break;
-    case 2:		// SET bit, D
-        cycles = 2;
-        set_D(get_D | (0x1 << bit));
-        break;
-    case 3:		// SET bit, E
-        cycles = 2;
-        set_E(get_E | (0x1 << bit));
-        break;
-    case 4:		// SET bit, H
-        cycles = 2;
-        set_H(get_H | (0x1 << bit));
-        break;
-    case 5:		// SET bit, L
-        cycles = 2;
-        set_L(get_L | (0x1 << bit));
-        break;
-    case 6:		// SET bit, (HL)
-        cycles = 4;
-        data_8 = _address_read(HL) | (0x1 << bit);
-        _address_write(HL, data_8);
-        break;
-    case 7:		// SET bit, A
-        cycles = 2;
-        set_A(get_A | (0x1 << bit));
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal tail in SET.\n");
-        break;
-    }
-    return cycles;
-}
-
-static uint32_t _cpu_interruption(void)
-{
-    // If no interrupting, do nothing.
-    // If interrupting, do interruption.
-    /*
-     * 1. If IME flag is set and IE corresponding to current IF is set,
-          following 3 steps are executed:
-     * 2. Reset IME to disable all interruptions
-     * 3. Push current PC to the stack
-     * 4. Jump to address corresponding to current interruption type
-     */
-
-    uint32_t cycles;
-
-    uint8_t _int = (IE & IF);
-    if (IME && _int) {
-        IME = 0;    // reset IME
-        IF = 0;     // reset IF
-
-        // push PC to the stack
-        SP -= 2;
-        _address_write_16(SP, PC);
-
-        switch (_int) {
-        case INT_VBLANK_MASK:
-            PC = INT_VBLANK_ADDRESS;
-            printf("VBLANK interruption.\n");
-            break;
-        case INT_LCDC_STATUS_MASK:
-            printf("LCDC status interruption.\n");
-            PC = INT_LCDC_STATUS_ADDRESS;
-            break;
-        case INT_TIMER_OVERFLOW_MASK:
-            printf("Timer overflow interruption.\n");
-            PC = INT_TIMER_OVERFLOW_ADDRESS;
-            break;
-        case INT_SERIAL_TRANSFER_COMPLETION_MASK:
-            printf("Serial transfer interruption.\n");
-            PC = INT_SERIAL_TRANSFER_COMPLETION_ADDRESS;
-            break;
-        case INT_BUTTON_PRESS_MASK:
-            printf("Button press interruption.\n");
-            PC = INT_BUTTON_PRESS_ADDRESS;
-            break;
-        }
-        // currently we assume interruption doesn't consume any cycles.
-        // I know it's not realistic, but I also don't know how many cycles an interruption will consume
-        // and I don't want to put a wrong number here.
-        cycles = 0;
-    }
-    cycles = 0;
-
-    return cycles;
-}
-
-static uint32_t _cpu_execute_cb(void)
-{
-    uint32_t cycles;
-    uint8_t command = _address_read(PC);
-    uint8_t low = command % 8;
-    command >>= 3;
-    ++PC;
-    switch (command) {
-    case 0x00:		// RLC
-        cycles = _RLC(low);
-        break;
-    case 0x01:		// RRC
-        cycles = _RRC(low);
-        break;
-    case 0x02:		// RL
-        cycles = _RL(low);
-        break;
-    case 0x03:		// RR
-        cycles = _RR(low);
-        break;
-    case 0x04:		// SLA
-        cycles = _SLA(low);
-        break;
-    case 0x05:		// SRA
-        cycles = _SRA(low);
-        break;
-    case 0x06:		// SWAP
-        cycles = _SWAP(low);
-        break;
-    case 0x07:		// SRL
-        cycles = _SRL(low);
-        break;
-    case 0x08:		// BIT 0
-        cycles = _BIT(0, low);
-        break;
-    case 0x09:		// BIT 1
-        cycles = _BIT(1, low);
-        break;
-    case 0x0A:		// BIT 2
-        cycles = _BIT(2, low);
-        break;
-    case 0x0B:		// BIT 3
-        cycles = _BIT(3, low);
-        break;
-    case 0x0C:		// BIT 4
-        cycles = _BIT(4, low);
-        break;
-    case 0x0D:		// BIT 5
-        cycles = _BIT(5, low);
-        break;
-    case 0x0E:		// BIT 6
-        cycles = _BIT(6, low);
-        break;
-    case 0x0F:		// BIT 8
-        cycles = _BIT(7, low);
-        break;
-    case 0x10:		// RES 0
-        cycles = _RES(0, low);
-        break;
-    case 0x11:		// RES 1
-        cycles = _RES(1, low);
-        break;
-    case 0x12:		// RES 2
-        cycles = _RES(2, low);
-        break;
-    case 0x13:		// RES 3
-        cycles = _RES(3, low);
-        break;
-    case 0x14:		// RES 4
-        cycles = _RES(4, low);
-        break;
-    case 0x15:		// RES 5
-        cycles = _RES(5, low);
-        break;
-    case 0x16:		// RES 6
-        cycles = _RES(6, low);
-        break;
-    case 0x17:		// RES 7
-        cycles = _RES(7, low);
-        break;
-    case 0x18:		// SET 0
-        cycles = _SET(0, low);
-        break;
-    case 0x19:		// SET 1
-        cycles = _SET(1, low);
-        break;
-    case 0x1A:		// SET 2
-        cycles = _SET(2, low);
-        break;
-    case 0x1B:		// SET 3
-        cycles = _SET(3, low);
-        break;
-    case 0x1C:		// SET 4
-        cycles = _SET(4, low);
-        break;
-    case 0x1D:		// SET 5
-        cycles = _SET(5, low);
-        break;
-    case 0x1E:		// SET 6
-        cycles = _SET(6, low);
-        break;
-    case 0x1F:		// SET 7
-        cycles = _SET(7, low);
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Illegal prefix CB instruction.\n");
-        break;
-    }
-    return cycles;
-}
-
-static uint32_t _cpu_execute(void)
-{
-    uint32_t cycles;	// number of CPU cycles
-
-    uint8_t command = _address_read(PC);
-    if (PC == 0xE6) {
-        //printf("Logo comparing...\n");
-    } else if (PC == 0x34) {
-        printf("Logo data half loaded.\n");
-    } else if (PC == 0x40) {
-        printf("Logo data fully loaded.\n");
-    } else if (PC == 0x6A) {
-        //printf("Another frame.\n");
-    } else if (PC == 0xF1) {
-        printf("Logo is valid!\n");
-    } else if (PC == 0x80) {
-        printf("Play Init Sound.\n");
-    } else if (PC == 0x100) {
-        printf("Run through boot rom.\n");
-        if (!(
-            AF == 0x01B0 &&
-            BC == 0x0013 &&
-            DE == 0x00D8 &&
-            HL == 0x014D &&
-            SP == 0xFFFE &&
-            PC == 0x0100)) {
-            fprintf(stderr, "Boot ROM running badly!!!\n");
-        } else {
-            printf("Boot rom running correctly.\n");
-        }
-    }
-    ++PC;
-
-    // tmp values used when translating instructions
-    uint8_t data_8;
-    uint16_t data_16;
-    uint32_t data_32;
-    switch (command) {
-    case 0x00:		// NOP
-        cycles = 1;
-        break;
-    case 0x01:		// LD BC, d16
-        cycles = 3;
-        data_16 = _address_read_16(PC);
-        PC += 2;
-        break;
-    case 0x02:		// LD (BC), A
-        cycles = 2;
-        _address_write(BC, get_A);
-        break;
-    case 0x03:		// INC BC
-        cycles = 2;
-        ++BC;
-        break;
-    case 0x04:		// INC B
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_B + 1;
-        set_B(data_8);
-        set_flag_H(!(data_8 & 0xF));
-        set_flag_Z(!data_8);
-        break;
-    case 0x05:		// DEC B
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_B;
-        set_flag_H(!(data_8 & 0xF));
-        --data_8;
-        set_B(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 0x06:		// LD B, d8
-        cycles = 2;
-        data_8 = _address_read(PC);
-        ++PC;
-        set_B(data_8);
-        break;
-    case 0x07:		// RLCA
-        cycles = 1;
-        set_flag_Z(0);
-        set_flag_N(0);
-        set_flag_H(0);
-        data_8 = (get_A & 0x80) >> 7;
-        set_A((get_A << 1) | data_8);
-        set_flag_C(data_8);
-        break;
-    case 0x08:		// LD (a16), SP
-        cycles = 5;
-        data_16 = _address_read_16(PC);
-        PC += 2;
-        _address_write_16(data_16, SP);
-        break;
-    case 0x09:		// ADD HL, BC
-        cycles = 2;
-        set_flag_N(0);
-        data_32 = (uint32_t)HL + (uint32_t)BC;
-        set_flag_H((data_32 & (uint32_t)0xFFF) < ((uint32_t)HL & (uint32_t)0xFFF));
-        HL = (uint16_t)data_32;
-        set_flag_C(data_32 >> 16);
-        break;
-    case 0x0A:		// LD A, (BC)
-        cycles = 2;
-        set_A(_address_read(BC));
-        break;
-    case 0x0B:		// DEC BC
-        cycles = 2;
-        --BC;
-        break;
-    case 0x0C:		// INC C
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_C + 1;
-        set_C(data_8);
-        set_flag_H(!(data_8 & 0xF));
-        set_flag_Z(!data_8);
-        break;
-    case 0x0D:		// DEC C
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_C;
-        set_flag_H(!(data_8 & 0xF));
-        --data_8;
-        set_C(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 0x0E:		// LD C, d8
-        cycles = 2;
-        data_8 = _address_read(PC);
-        ++PC;
-        set_C(data_8);
-        break;
-    case 0x0F:		// RRCA
-        cycles = 1;
-        set_flag_Z(0);
-        set_flag_N(0);
-        set_flag_H(0);
-        data_8 = get_A & 0x1;
-        set_A((get_A >> 1) | (data_8 << 7));
-        set_flag_C(data_8);
-        break;
-    case 0x10:		// STOP 0
-        cycles = 0xFFFF;
-        is_stopped = 1;
-        if (_address_read(PC) == 0x00) {
-            fprintf(stdout, "Entering stop mode. Halt CPU & LCD display until button pressed.\n");
-        } else {
-            fprintf(stdout, "Entering corrupted stop mode.\n");
-        }
-        ++PC;
-        break;
-    case 0x11:		// LD DE, d16
-        cycles = 3;
-        data_16 = _address_read_16(PC);
-        PC += 2;
-        DE = data_16;
-        break;
-    case 0x12:		// LD (DE), A
-        cycles = 2;
-        _address_write_16(DE, get_A);
-        break;
-    case 0x13:		// INC DE
-        cycles = 2;
-        ++DE;
-        break;
-    case 0x14:		// INC D
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_D + 1;
-        set_D(data_8);
-        set_flag_Z(!(data_8 & 0xF));
-        set_flag_H(!data_8);
-        break;
-    case 0x15:		// DEC D
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_D;
-        set_flag_H(!(data_8 & 0xF));
-        --data_8;
-        set_D(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 0x16:		// LD D, d8
-        cycles = 2;
-        data_8 = _address_read(PC);
-        ++PC;
-        set_D(data_8);
-        break;
-    case 0x17:		// RLA
-        cycles = 1;
-        set_flag_Z(0);
-        set_flag_N(0);
-        set_flag_H(0);
-        data_8 = get_A >> 7;
-        set_A(get_A << 1 | get_flag_C);
-        set_flag_C(data_8);
-        break;
-    case 0x18:		// JR r8
-        cycles = 3;
-        data_8 = _address_read(PC);
-        ++PC;
-        PC = (PC & 0xFF00) | ((PC + data_8) & 0x00FF);
-        break;
-    case 0x19:		// ADD HL, DE
-        cycles = 2;
-        set_flag_N(0);
-        data_32 = (uint32_t)HL + (uint32_t)DE;
-        set_flag_H((data_32 & (uint32_t)0xFFF) < ((uint32_t)HL & (uint32_t)0xFFF));
-        HL = (uint16_t)data_32;
-        set_flag_C(data_32 >> 16);
-        break;
-    case 0x1A:		// LD A, (DE)
-        cycles = 2;
-        set_A(_address_read(DE));
-        break;
-    case 0x1B:		// DEC DE
-        cycles = 2;
-        --DE;
-        break;
-    case 0x1C:		// INC E
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_E + 1;
-        set_E(data_8);
-        set_flag_H(!(data_8 & 0xF));
-        set_flag_Z(!(data_8));
-        break;
-    case 0x1D:		// DEC E
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_E;
-        set_flag_H(!(data_8 & 0xF));
-        --data_8;
-        set_E(data_8);
-        set_flag_Z(!(data_8));
-        break;
-    case 0x1E:		// LD E, d8
-        cycles = 2;
-        data_8 = _address_read(PC);
-        ++PC;
-        set_E(data_8);
-        break;
-    case 0x1F:		// RRA
-        cycles = 1;
-        set_flag_Z(0);
-        set_flag_N(0);
-        set_flag_H(0);
-        data_8 = get_A & 0x1;
-        set_A((get_A >> 1) | (get_flag_C << 7));
-        set_flag_C(data_8);
-        break;
-    case 0x20:		// JR NZ, r8
-        data_8 = _address_read(PC);
-        ++PC;
-        if (get_flag_Z) {		// NOT JUMP
-            cycles = 2;
-        } else {				// JUMP
-            cycles = 3;
-            PC = (PC & 0xFF00) | ((PC + data_8) & 0x00FF);
-        }
-        break;
-    case 0x21:		// LD HL, d16
-        cycles = 3;
-        HL = _address_read_16(PC);
-        PC += 2;
-        break;
-    case 0x22:		// LD (HL+), A
-        cycles = 2;
-        _address_write(HL, get_A);
-        ++HL;
-        break;
-    case 0x23:		// INC HL
-        cycles = 2;
-        ++HL;
-        break;
-    case 0x24:		// INC H
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_H + 1;
-        set_H(data_8);
-        set_flag_H(!(data_8 & 0xF));
-        set_flag_Z(!data_8);
-        break;
-    case 0x25:		// DEC H
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_H;
-        set_flag_H(!(data_8 & 0xF));
-        --data_8;
-        set_H(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 0x26:		// LD H, d8
-        cycles = 2;
-        data_8 = _address_read(PC);
-        ++PC;
-        set_H(data_8);
-        break;
-    case 0x27:		// DAA
-        cycles = 1;
-        if (get_flag_N) {
-            if (get_flag_H)
-                set_A(get_A - 0x6);
-            if (get_flag_C)
-                set_A(get_A - 0x60);
-        } else {
-            if (get_flag_H || (get_A & 0xF) > 0x9) {
-                set_A(get_A + 0x6);
-            }
-            if (get_flag_C || ((get_A >> 4) & 0xF) > 0x9) {
-                set_A(get_A + 0x60);
-            }
-        }
-        break;
-    case 0x28:		// JR Z, r8 
-        data_8 = _address_read(PC);
-        ++PC;
-        if (get_flag_Z) {
-            cycles = 3;
-            PC = (PC & 0xFF00) | ((PC + data_8) & 0x00FF);
-        } else {
-            cycles = 2;
-        }
-        break;
-    case 0x29:		// ADD HL, HL
-        cycles = 2;
-        set_flag_N(0);
-        data_32 = (uint32_t)HL + (uint32_t)HL;
-        set_flag_H((data_32 & (uint32_t)0xFFF) < ((uint32_t)HL & (uint32_t)0xFFF));
-        HL = (uint16_t)data_32;
-        set_flag_C(data_32 >> 16);
-        break;
-    case 0x2A:		// LD A, (HL+)
-        cycles = 2;
-        data_8 = _address_read(HL);
-        ++HL;
-        set_A(data_8);
-        break;
-    case 0x2B:		// DEC HL
-        cycles = 2;
-        --HL;
-        break;
-    case 0x2C:		// INC L
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_L + 1;
-        set_L(data_8);
-        set_flag_H(!(data_8 & 0xF));
-        set_flag_Z(!data_8);
-        break;
-    case 0x2D:		// DEC L
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_L;
-        set_flag_H(!(data_8 & 0xF));
-        --data_8;
-        set_L(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 0x2E:		// LD L, d8
-        cycles = 2;
-        data_8 = _address_read(PC);
-        ++PC;
-        set_L(data_8);
-        break;
-    case 0x2F:		// CPL
-        cycles = 1;
-        set_flag_N(1);
-        set_flag_H(1);
-        set_A(~get_A);
-        break;
-    case 0x30:		// JR NC, r8
-        data_8 = _address_read(PC);
-        ++PC;
-        if (get_flag_C) {
-            cycles = 2;
-        } else {
-            cycles = 3;
-            PC = (PC & 0xFF00) | ((PC + data_8) & 0x00FF);
-        }
-        break;
-    case 0x31:		// LD SP, s16
-        cycles = 3;
-        data_16 = _address_read_16(PC);
-        PC += 2;
-        SP = data_16;
-        break;
-    case 0x32:		// LD (HL-), A
-        cycles = 2;
-        _address_write(HL, get_A);
-        --HL;
-        break;
-    case 0x33:		// INC SP
-        cycles = 2;
-        ++SP;
-        break;
-    case 0x34:		// INC (HL)
-        cycles = 3;
-        set_flag_N(0);
-        data_8 = _address_read(HL);
-        ++data_8;
-        set_flag_H(!(data_8 & 0xF));
-        set_flag_Z(!(data_8));
-        _address_write(HL, data_8);
-        break;
-    case 0x35:		// DEC (HL)
-        cycles = 3;
-        set_flag_N(0);
-        data_8 = _address_read(HL);
-        set_flag_H(!(data_8 & 0xF));
-        --data_8;
-        set_flag_Z(!(data_8));
-        _address_write(HL, data_8);
-        break;
-    case 0x36:		// LD (HL), d8
-        cycles = 3;
-        data_8 = _address_read(PC);
-        ++PC;
-        _address_write(HL, data_8);
-        break;
-    case 0x37:		// SCF
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(1);
-        break;
-    case 0x38:		// JR C, r8
-        data_8 = _address_read(PC);
-        ++PC;
-        if (get_flag_C) {
-            cycles = 12;
-            PC = (PC & 0xFF00) | ((PC + data_8) & 0x00FF);
-        } else {
-            cycles = 8;
-        }
-        break;
-    case 0x39:		// ADD HL, SP
-        cycles = 2;
-        set_flag_N(0);
-        data_32 = (uint32_t)HL + (uint32_t)SP;
-        set_flag_H((data_32 & (uint32_t)0xFFF) < ((uint32_t)HL & (uint32_t)0xFFF));
-        HL = (uint16_t)data_32;
-        set_flag_C(data_32 >> 16);
-        break;
-    case 0x3A:		// LD A, (HL-)
-        cycles = 2;
-        data_8 = _address_read(HL);
-        --HL;
-        set_A(data_8);
-        break;
-    case 0x3B:		// DEC SP
-        cycles = 2;
-        --SP;
-        break;
-    case 0x3C:		// INC A
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + 1;
-        set_A(data_8);
-        set_flag_H(!(data_8 & 0xF));
-        set_flag_Z(!data_8);
-        break;
-    case 0x3D:		// DEC A
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A;
-        set_flag_H(!(data_8 & 0xF));
-        --data_8;
-        set_A(data_8);
-        set_flag_Z(!data_8);
-        break;
-    case 0x3E:		// LD A, d8
-        cycles = 2;
-        data_8 = _address_read(PC);
-        ++PC;
-        set_A(data_8);
-        break;
-    case 0x3F:		// CCF
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(!get_flag_C);
-        break;
-    case 0x40:		// LD B, B
-        cycles = 1;
-        break;
-    case 0x41:		// LD B, C
-        cycles = 1;
-        set_B(get_C);
-        break;
-    case 0x42:		// LD B, D
-        cycles = 1;
-        set_B(get_D);
-        break;
-    case 0x43:		// LD B, E
-        cycles = 1;
-        set_B(get_E);
-        break;
-    case 0x44:		// LD B, H
-        cycles = 1;
-        set_B(get_H);
-        break;
-    case 0x45:		// LD B, L
-        cycles = 1;
-        set_B(get_L);
-        break;
-    case 0x46:		// LD B, (HL)
-        cycles = 2;
-        data_8 = _address_read(HL);
-        set_B(data_8);
-        break;
-    case 0x47:		// LD B, A
-        cycles = 1;
-        set_B(get_A);
-        break;
-    case 0x48:		// LD C, B
-        cycles = 1;
-        set_C(get_B);
-        break;
-    case 0x49:		// LD C, C
-        cycles = 1;
-        break;
-    case 0x4A:		// LD C, D
-        cycles = 1;
-        set_C(get_D);
-        break;
-    case 0x4B:		// LD C, E
-        cycles = 1;
-        set_C(get_E);
-        break;
-    case 0x4C:		// LD C, H
-        cycles = 1;
-        set_C(get_H);
-        break;
-    case 0x4D:		// LD C, L
-        cycles = 1;
-        set_C(get_L);
-        break;
-    case 0x4E:		// LD C, (HL)
-        cycles = 2;
-        data_8 = _address_read(HL);
-        set_C(data_8);
-        break;
-    case 0x4F:		// LD C, A
-        cycles = 1;
-        set_C(get_A);
-        break;
-    case 0x50:		// LD D, B
-        cycles = 1;
-        set_D(get_B);
-        break;
-    case 0x51:		// LD D, C
-        cycles = 1;
-        set_D(get_C);
-        break;
-    case 0x52:		// LD D, D
-        cycles = 1;
-        break;
-    case 0x53:		// LD D, E
-        cycles = 1;
-        set_D(get_E);
-        break;
-    case 0x54:		// LD D, H
-        cycles = 1;
-        set_D(get_H);
-        break;
-    case 0x55:		// LD D, L
-        cycles = 1;
-        set_D(get_L);
-        break;
-    case 0x56:		// LD D, (HL)
-        cycles = 2;
-        data_8 = _address_read(HL);
-        set_D(data_8);
-        break;
-    case 0x57:		// LD D, A
-        cycles = 1;
-        set_D(get_A);
-        break;
-    case 0x58:		// LD E, B
-        cycles = 1;
-        set_E(get_B);
-        break;
-    case 0x59:		// LD E, C
-        cycles = 1;
-        set_E(get_C);
-        break;
-    case 0x5A:		// LD E, D
-        cycles = 1;
-        set_E(get_D);
-        break;
-    case 0x5B:		// LD E, E
-        cycles = 1;
-        break;
-    case 0x5C:		// LD E, H
-        cycles = 1;
-        set_E(get_H);
-        break;
-    case 0x5D:		// LD E, L
-        cycles = 1;
-        set_E(get_L);
-        break;
-    case 0x5E:		// LD E, (HL)
-        cycles = 2;
-        data_8 = _address_read(HL);
-        set_E(data_8);
-        break;
-    case 0x5F:		// LD E, A
-        cycles = 1;
-        set_E(get_A);
-        break;
-    case 0x60:		// LD H, B
-        cycles = 1;
-        set_H(get_B);
-        break;
-    case 0x61:		// LD H, C
-        cycles = 1;
-        set_H(get_C);
-        break;
-    case 0x62:		// LD H, D
-        cycles = 1;
-        set_H(get_D);
-        break;
-    case 0x63:		// LD H, E
-        cycles = 1;
-        set_H(get_E);
-        break;
-    case 0x64:		// LD H, H
-        cycles = 1;
-        break;
-    case 0x65:		// LD H, L
-        cycles = 1;
-        set_H(get_L);
-        break;
-    case 0x66:		// LD H, (HL)
-        cycles = 2;
-        data_8 = _address_read(HL);
-        set_H(data_8);
-        break;
-    case 0x67:		// LD H, A
-        cycles = 1;
-        set_H(get_A);
-        break;
-    case 0x68:		// LD L, B
-        cycles = 1;
-        set_L(get_B);
-        break;
-    case 0x69:		// LD L, C
-        cycles = 1;
-        set_L(get_C);
-        break;
-    case 0x6A:		// LD L, D
-        cycles = 1;
-        set_L(get_D);
-        break;
-    case 0x6B:		// LD L, E
-        cycles = 1;
-        set_L(get_E);
-        break;
-    case 0x6C:		// LD L, H
-        cycles = 1;
-        set_L(get_H);
-        break;
-    case 0x6D:		// LD L, L
-        cycles = 1;
-        break;
-    case 0x6E:		// LD L, (HL)
-        cycles = 1;
-        data_8 = _address_read(HL);
-        set_L(data_8);
-        break;
-    case 0x6F:		// LD L, A
-        cycles = 1;
-        set_L(get_A);
-        break;
-    case 0x70:		// LD (HL), B
-        cycles = 2;
-        _address_write(HL, get_B);
-        break;
-    case 0x71:		// LD (HL), C
-        cycles = 2;
-        _address_write(HL, get_C);
-        break;
-    case 0x72:		// LD (HL), D
-        cycles = 2;
-        _address_write(HL, get_D);
-        break;
-    case 0x73:		// LD (HL), E
-        cycles = 2;
-        _address_write(HL, get_E);
-        break;
-    case 0x74:		// LD (HL), H
-        cycles = 2;
-        _address_write(HL, get_H);
-        break;
-    case 0x75:		// LD (HL), L
-        cycles = 2;
-        _address_write(HL, get_L);
-        break;
-    case 0x76:		// HALT
-        cycles = 1;
-        fprintf(stdout, "Entering halt mode.\n");
-        break;
-    case 0x77:		// LD (HL), A
-        cycles = 2;
-        _address_write(HL, get_A);
-        break;
-    case 0x78:		// LD A, B
-        cycles = 1;
-        set_A(get_B);
-        break;
-    case 0x79:		// LD A, C
-        cycles = 1;
-        set_A(get_C);
-        break;
-    case 0x7A:		// LD A, D
-        cycles = 1;
-        set_A(get_D);
-        break;
-    case 0x7B:		// LD A, E
-        cycles = 1;
-        set_A(get_E);
-        break;
-    case 0x7C:		// LD A, H
-        cycles = 1;
-        set_A(get_H);
-        break;
-    case 0x7D:		// LD A, L
-        cycles = 1;
-        set_A(get_L);
-        break;
-    case 0x7E:		// LD A, (HL)
-        cycles = 1;
-        data_8 = _address_read(HL);
-        set_A(data_8);
-        break;
-    case 0x7F:		// LD A, A
-        cycles = 1;
-        break;
-    case 0x80:		// ADD A, B
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_B;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x81:		// ADD A, C
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x82:		// ADD A, D
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_D;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x83:		// ADD A, E
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_E;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x84:		// ADD A, H
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_H;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x85:		// ADD A, L
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_L;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x86:		// ADD A, (HL)
-        cycles = 2;
-        set_flag_N(0);
-        data_8 = get_A + _address_read(HL);
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x87:		// ADD A, A
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_A;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x88:		// ADC A, B
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_B + get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x89:		// ADC A, C
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_C + get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x8A:		// ADC A, D
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_D + get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x8B:		// ADC A, E
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_E + get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x8C:		// ADC A, H
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_H + get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x8D:		// ADC A, L
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_L + get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x8E:		// ADC A, (HL)
-        cycles = 2;
-        set_flag_N(0);
-        data_8 = get_A + _address_read(HL) + get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x8F:		// ADC A, A
-        cycles = 1;
-        set_flag_N(0);
-        data_8 = get_A + get_A + get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        set_A(data_8);
-        break;
-    case 0x90:		// SUB B
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_B;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x91:		// SUB C
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x92:		// SUB D
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_D;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x93:		// SUB E
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_E;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x94:		// SUB H
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_H;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x95:		// SUB L
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_L;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x96:		// SUB (HL)
-        cycles = 2;
-        set_flag_N(1);
-        data_8 = get_A - _address_read(HL);
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x97:		// SUB A
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = 0;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x98:		// SBC A, B
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_B - get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x99:		// SBC A, C
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_C - get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x9A:		// SBC A, D
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_D - get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x9B:		// SBC A, E
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_E - get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x9C:		// SBC A, H
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_H - get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x9D:		// SBC A, L
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_L - get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x9E:		// SBC A, (HL)
-        cycles = 2;
-        set_flag_N(1);
-        data_8 = get_A - _address_read(HL) - get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0x9F:		// SBC A, A
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = -get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        break;
-    case 0xA0:		// AND B
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(1);
-        set_flag_C(0);
-        set_A(get_A & get_B);
-        set_flag_Z(!get_A);
-        break;
-    case 0xA1:		// AND C
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(1);
-        set_flag_C(0);
-        set_A(get_A & get_C);
-        set_flag_Z(!get_A);
-        break;
-    case 0xA2:		// AND D
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(1);
-        set_flag_C(0);
-        set_A(get_A & get_D);
-        set_flag_Z(!get_A);
-        break;
-    case 0xA3:		// AND E
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(1);
-        set_flag_C(0);
-        set_A(get_A & get_E);
-        set_flag_Z(!get_A);
-        break;
-    case 0xA4:		// AND H
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(1);
-        set_flag_C(0);
-        set_A(get_A & get_H);
-        set_flag_Z(!get_A);
-        break;
-    case 0xA5:		// AND L
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(1);
-        set_flag_C(0);
-        set_A(get_A & get_L);
-        set_flag_Z(!get_A);
-        break;
-    case 0xA6:		// AND (HL)
-        cycles = 2;
-        set_flag_N(0);
-        set_flag_H(1);
-        set_flag_C(0);
-        set_A(get_A & _address_read(HL));
-        set_flag_Z(!get_A);
-        break;
-    case 0xA7:		// AND A
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(1);
-        set_flag_C(0);
-        set_flag_Z(!get_A);
-        break;
-    case 0xA8:		// XOR B
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A ^ get_B);
-        set_flag_Z(!get_A);
-        break;
-    case 0xA9:		// XOR C
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A ^ get_C);
-        set_flag_Z(!get_A);
-        break;
-    case 0xAA:		// XOR D
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A ^ get_D);
-        set_flag_Z(!get_A);
-        break;
-    case 0xAB:		// XOR E
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A ^ get_E);
-        set_flag_Z(!get_A);
-        break;
-    case 0xAC:		// XOR H
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A ^ get_H);
-        set_flag_Z(!get_A);
-        break;
-    case 0xAD:		// XOR L
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A ^ get_L);
-        set_flag_Z(!get_A);
-        break;
-    case 0xAE:		// XOR (HL)
-        cycles = 2;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A ^ _address_read(HL));
-        set_flag_Z(!get_A);
-        break;
-    case 0xAF:		// XOR A
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(0);
-        set_flag_Z(1);
-        break;
-    case 0xB0:		// OR B
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A | get_B);
-        set_flag_Z(!get_A);
-        break;
-    case 0xB1:		// OR C
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A | get_C);
-        set_flag_Z(!get_A);
-        break;
-    case 0xB2:		// OR D
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A | get_D);
-        set_flag_Z(!get_A);
-        break;
-    case 0xB3:		// OR E
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A | get_E);
-        set_flag_Z(!get_A);
-        break;
-    case 0xB4:		// OR H
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A | get_H);
-        set_flag_Z(!get_A);
-        break;
-    case 0xB5:		// OR L
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A | get_L);
-        set_flag_Z(!get_A);
-        break;
-    case 0xB6:		// OR (HL)
-        cycles = 2;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A | _address_read(HL));
-        set_flag_Z(!get_A);
-        break;
-    case 0xB7:		// OR A
-        cycles = 1;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_flag_Z(!get_A);
-        break;
-    case 0xB8:		// CP B
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_B;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        break;
-    case 0xB9:		// CP C
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        break;
-    case 0xBA:		// CP D
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_D;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        break;
-    case 0xBB:		// CP E
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_E;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        break;
-    case 0xBC:		// CP H
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_H;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        break;
-    case 0xBD:		// CP L
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = get_A - get_L;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        break;
-    case 0xBE:		// CP (HL)
-        cycles = 2;
-        set_flag_N(1);
-        data_8 = get_A - _address_read(HL);
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        break;
-    case 0xBF:		// CP A
-        cycles = 1;
-        set_flag_N(1);
-        data_8 = 0;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        break;
-    case 0xC0:		// RET NZ
-        if (get_flag_Z) {
-            cycles = 2;
-        } else {
-            cycles = 5;
-            PC = _address_read_16(SP);
-            SP += 2;
-        }
-        break;
-    case 0xC1:		// POP BC
-        cycles = 3;
-        BC = _address_read_16(SP);
-        SP += 2;
-        break;
-    case 0xC2:		// JP NZ, a16
-        if (get_flag_Z) {
-            cycles = 3;
-            PC += 2;
-        } else {
-            cycles = 4;
-            PC = _address_read_16(PC);
-        }
-        break;
-    case 0xC3:		// JP a16
-        cycles = 4;
-        data_16 = _address_read_16(PC);
-        PC = data_16;
-        break;
-    case 0xC4:		// CALL NZ, a16
-        if (get_flag_Z) {
-            cycles = 3;
-            PC += 2;
-        } else {
-            cycles = 6;
-            data_16 = _address_read_16(PC);
-            PC += 2;
-            SP -= 2;
-            _address_write_16(SP, PC);
-            PC = data_16;
-        }
-        break;
-    case 0xC5:		// PUSH BC
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, BC);
-        break;
-    case 0xC6:		// ADD A, d8
-        cycles = 2;
-        set_flag_N(0);
-        data_8 = get_A + _address_read(PC);
-        PC += 1;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        break;
-    case 0xC7:		// RST 00h
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, PC);
-        PC = 0;
-        break;
-    case 0xC8:		// RET Z
-        if (get_flag_Z) {
-            cycles = 5;
-            PC = _address_read_16(SP);
-            SP += 2;
-        } else {
-            cycles = 2;
-        }
-        break;
-    case 0xC9:		// RET
-        cycles = 4;
-        PC = _address_read_16(SP);
-        SP += 2;
-        break;
-    case 0xCA:		// JP Z, a16
-        if (get_flag_Z) {
-            cycles = 4;
-            PC = _address_read_16(PC);
-        } else {
-            cycles = 3;
-            PC += 2;
-        }
-        break;
-    case 0xCB:		// PREFIX CB
-        // CB needs 1 cycle itself
-        cycles = _cpu_execute_cb() + 1;
-        break;
-    case 0xCC:		// CALL Z, a16
-        if (get_flag_Z) {
-            cycles = 6;
-            data_16 = _address_read_16(PC);
-            PC += 2;
-            SP -= 2;
-            _address_write_16(SP, PC);
-            PC = data_16;
-        } else {
-            cycles = 3;
-            PC += 2;
-        }
-        break;
-    case 0xCD:		// CALL a16
-        cycles = 6;
-        data_16 = _address_read_16(PC);
-        PC += 2;
-        SP -= 2;    // might be right but it seems that the 0xFFFE is wasted
-        _address_write_16(SP, PC);
-        PC = data_16;
-        break;
-    case 0xCE:		// ADC A, d8
-        cycles = 2;
-        set_flag_N(0);
-        data_8 = get_A + _address_read(PC) + get_flag_C;
-        ++PC;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        break;
-    case 0xCF:		// RST 08H
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, PC);
-        PC = 8;
-        break;
-    case 0xD0:		// RET NC
-        if (get_flag_C) {
-            cycles = 2;
-        } else {
-            cycles = 5;
-            PC = _address_read_16(SP);
-            SP += 2;
-        }
-        break;
-    case 0xD1:		// POP DE
-        cycles = 3;
-        DE = _address_read_16(SP);
-        SP += 2;
-        break;
-    case 0xD2:		// JP NC, a16
-        if (get_flag_C) {
-            cycles = 3;
-            PC += 2;
-        } else {
-            cycles = 4;
-            PC = _address_read_16(PC);
-        }
-        break;
-    case 0xD4:		// CALL NC, a16
-        if (get_flag_C) {
-            cycles = 3;
-            PC += 2;
-        } else {
-            cycles = 6;
-            data_16 = _address_read_16(PC);
-            PC += 2;
-            SP -= 2;
-            _address_write_16(SP, PC);
-            PC = data_16;
-        }
-        break;
-    case 0xD5:		// PUSH DE
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, DE);
-        break;
-    case 0xD6:		// SUB d8
-        cycles = 2;
-        set_flag_N(1);
-        data_8 = get_A - _address_read(PC);
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        break;
-    case 0xD7:		// RST 10H
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, PC);
-        PC = 0x10;
-        break;
-    case 0xD8:		// RET C
-        if (get_flag_C) {
-            cycles = 5;
-            PC = _address_read_16(SP);
-            SP += 2;
-        } else {
-            cycles = 2;
-        }
-        break;
-    case 0xD9:		// RETI
-        cycles = 4;
-        PC = _address_read_16(SP);
-        SP += 2;
-        IME = 1;
-        break;
-    case 0xDA:		// JP C, a16
-        if (get_flag_C) {
-            cycles = 3;
-            PC += 2;
-        } else {
-            cycles = 4;
-            PC = _address_read_16(PC);
-        }
-        break;
-    case 0xDC:		// CALL C, a16
-        if (get_flag_C) {
-            cycles = 6;
-            data_16 = _address_read_16(PC);
-            PC += 2;
-            SP -= 2;
-            _address_write_16(SP, PC);
-            PC = data_16;
-        } else {
-            cycles = 3;
-            PC += 2;
-        }
-        break;
-    case 0xDE:		// SBC A, d8
-        cycles = 2;
-        set_flag_N(1);
-        data_8 = get_A + _address_read(PC) + get_flag_C;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) > (get_A & 0xF));
-        set_flag_C(data_8 > get_A);
-        set_A(data_8);
-        ++PC;
-        break;
-    case 0xDF:		// RST 18h
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, PC);
-        PC = 0x18;
-        break;
-    case 0xE0:		// LDH (a8), A
-        cycles = 3;
-        _address_write(0xFF00 | (uint16_t)_address_read(PC), get_A);
-        ++PC;
-        break;
-    case 0xE1:		// POP HL
-        cycles = 3;
-        HL = _address_read_16(SP);
-        SP += 2;
-        break;
-    case 0xE2:		// LD (C), A
-        cycles = 2;
-        _address_write((0xFF00 | (uint16_t)get_C), get_A);
-        break;
-    case 0xE5:		// PUSH HL
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, HL);
-        break;
-    case 0xE6:		// AND d8
-        cycles = 2;
-        set_flag_N(0);
-        set_flag_H(1);
-        set_flag_C(0);
-        set_A(get_A & _address_read(PC));
-        set_flag_Z(get_A);
-        break;
-    case 0xE7:		// RST 20h
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, PC);
-        PC = 0x20;
-    case 0xE8:		// ADD SP, r8
-        cycles = 4;
-        data_16 = SP + (uint16_t)_address_read(PC);
-        ++PC;
-        set_flag_Z(0);
-        set_flag_N(0);
-        set_flag_H((data_16 & 0xFFF) < (SP & 0xFFF));
-        set_flag_C(data_16 < SP);
-        SP = data_16;
-        break;
-    case 0xE9:		// JP (HL)
-        cycles = 1;
-        PC = _address_read_16(HL);
-        break;
-    case 0xEA:		// LD (a16), A
-        cycles = 4;
-        _address_write(_address_read_16(PC), get_A);
-        PC += 2;
-        break;
-    case 0xEE:		// XOR d8
-        cycles = 2;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A ^ _address_read(PC));
-        ++PC;
-        set_flag_Z(!get_A);
-    case 0xEF:		// RST 28h
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, PC);
-        PC = 0x28;
-        break;
-    case 0xF0:		// LDH A, (d8)
-        cycles = 3;
-        set_A(_address_read(0xFF00 + _address_read(PC)));
-        ++PC;
-        break;
-    case 0xF1:		// POP AF
-        cycles = 3;
-        AF = _address_read_16(SP);
-        SP += 2;
-        break;
-    case 0xF2:		// LD A, (C)
-        cycles = 2;
-        set_A(_address_read(0xFF00 + get_C));
-        break;
-    case 0xF3:		// DI
-        cycles = 1;
-        IME = 0;
-        break;
-    case 0xF5:		// PUSH AF
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, AF);
-        break;
-    case 0xF6:		// OR d8
-        cycles = 2;
-        set_flag_N(0);
-        set_flag_H(0);
-        set_flag_C(0);
-        set_A(get_A & _address_read(PC));
-        ++PC;
-        set_flag_Z(!get_A);
-        break;
-    case 0xF7:		// RST 30h
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, PC);
-        PC = 0x30;
-        break;
-    case 0xF8:		// LD HL, SP + r8
-        cycles = 3;
-        set_flag_Z(0);
-        set_flag_N(0);
-        HL = SP + _address_read(PC);
-        ++PC;
-        set_flag_H((HL & 0xFFF) < (SP & 0xFFF));
-        set_flag_C(HL < SP);
-        break;
-    case 0xF9:		// LD SP, HL
-        cycles = 2;
-        SP = HL;
-        break;
-    case 0xFA:		// LD A, (a16)
-        cycles = 4;
-        set_A(_address_read(_address_read(PC)));
-        ++PC;
-        break;
-    case 0xFB:		// EI
-        cycles = 1;
-        IME = 1;
-        break;
-    case 0xFE:		// CP d8
-        cycles = 2;
-        set_flag_N(1);
-        data_8 = get_A - _address_read(PC);
-        PC += 1;
-        set_flag_Z(!data_8);
-        set_flag_H((data_8 & 0xF) < (get_A & 0xF));
-        set_flag_C(data_8 < get_A);
-        break;
-    case 0xFF:		// RST 38h
-        cycles = 4;
-        SP -= 2;
-        _address_write_16(SP, PC);
-        PC = 0x38;
-        break;
-    default:
-        cycles = 0xFFFF;
-        fprintf(stderr, "Encounter illegal instruction.\n");
-        break;
-    }
-    return cycles;
-}
-
-int my_gb_cpu_construct(void)
-{
-    internal_ram = 0;
-    is_stopped = 0;
-
-
-    // bootstrap code(256Byte in gameboy) changes register to desired value
-#ifdef LOAD_BOOTSTRAP
-    AF = 0x0;
-    BC = 0x0;
-    DE = 0x0;
-    HL = 0x0;
-    SP = 0x0;
-    PC = 0x0;
-#else
-    // set these values means jump over the bootstrap code
-    AF = 0x01B0;
-    BC = 0x0013;
-    DE = 0x00D8;
-    HL = 0x014D;
-    SP = 0xFFFE;
-    PC = 0x0100;
-#endif
-    SB = 0;
-    SC = 0;
-    DIV = 0;
-    TIMA = 0;
-    TMA = 0;
-    TAC = 0;
-    IF = 0;
-    BOOT = 0;
-    IE = 0;
-
-    IME = 0;
-
-    return 0;
-}
-
-void my_gb_cpu_destruct(void)
-{
-    // Do nothing because no heap memory allocation
-}
-
-void my_gb_cpu_link_ram(uint8_t * _internal_ram)
-{
-    internal_ram = _internal_ram;
-}
-
-void my_gb_cpu_link_cart(void)
-{
-}
-
-uint32_t my_gb_cpu_run(uint32_t cycles_want)
-{
-    uint32_t cycles = 0;
-    // check interruption
-    // if interruption, interruption ^= interruption_type_will_do
-    for (;;) {
-        if (cycles >= cycles_want)
-            break;
-        cycles += _cpu_interruption();
-
-        if (cycles >= cycles_want)
-            break;
-        cycles += _cpu_execute();
-    }
-    // check timer overflow if yes mark interruption
-    return cycles - cycles_want;
-}
-
-void my_gb_cpu_on_interruption(enum INTERRUPTION_TYPE type)
-{
-    uint8_t _int = 0;
-    switch (type) {
-    case INT_VBLANK:
-        _int = INT_VBLANK_MASK;
-        break;
-    case INT_LCDC_STATUS:
-        _int = INT_LCDC_STATUS_MASK;
-        break;
-    case INT_TIMER_OVERFLOW:
-        _int = INT_TIMER_OVERFLOW_MASK;
-        break;
-    case INT_SERIAL_TRANSFER_COMPLETION:
-        _int = INT_SERIAL_TRANSFER_COMPLETION_MASK;
-        break;
-    case INT_BUTTON_PRESS:
-        _int = INT_BUTTON_PRESS_MASK;
-        break;
-    default:
-        break;
-    }
-    // We don't use IE to mask here because interruption type will be checked during interruption identify time.
-
-    /*
-        When more than 1 interrupts occur at the same
-    time only the interrupt with the highest priority
-    can be acknowledged. When an interrupt is used a
-    '0' should be stored in the IF register before the
-    IE register is set.
-    */
-    if (IF < _int) {
-        IF = _int;
-    }
-}
+#include"cpu.h"
+#include"../cart/cart.h"
+#include"ram.h"         // get offset of each ram chunk
+#include"input.h"       // get joypad IO registers
+#include"sound.h"       // get sound IO registers
+#include"screen.h"      // get screen IO registers
+#include"trace.h"
+#include"scheduler.h"
+#include"timer.h"       // get timer IO registers
+#include"../machine.h"
+
+#include<stdio.h>	    // for debug information output
+#include<string.h>
+#include<stdlib.h>
+#include<stddef.h>      // offsetof for the I/O register table
+#include<stdint.h>
+
+
+static const uint8_t internal_rom[256] = {
+    0x31, 0xfe, 0xff, 0xaf, 0x21, 0xff, 0x9f, 0x32, 0xcb, 0x7c, 0x20, 0xfb,
+    0x21, 0x26, 0xff, 0x0e, 0x11, 0x3e, 0x80, 0x32, 0xe2, 0x0c, 0x3e, 0xf3,
+    0xe2, 0x32, 0x3e, 0x77, 0x77, 0x3e, 0xfc, 0xe0, 0x47, 0x11, 0x04, 0x01,
+    0x21, 0x10, 0x80, 0x1a, 0xcd, 0x95, 0x00, 0xcd, 0x96, 0x00, 0x13, 0x7b,
+    0xfe, 0x34, 0x20, 0xf3, 0x11, 0xd8, 0x00, 0x06, 0x08, 0x1a, 0x13, 0x22,
+    0x23, 0x05, 0x20, 0xf9, 0x3e, 0x19, 0xea, 0x10, 0x99, 0x21, 0x2f, 0x99,
+    0x0e, 0x0c, 0x3d, 0x28, 0x08, 0x32, 0x0d, 0x20, 0xf9, 0x2e, 0x0f, 0x18,
+    0xf3, 0x67, 0x3e, 0x64, 0x57, 0xe0, 0x42, 0x3e, 0x91, 0xe0, 0x40, 0x04,
+    0x1e, 0x02, 0x0e, 0x0c, 0xf0, 0x44, 0xfe, 0x90, 0x20, 0xfa, 0x0d, 0x20,
+    0xf7, 0x1d, 0x20, 0xf2, 0x0e, 0x13, 0x24, 0x7c, 0x1e, 0x83, 0xfe, 0x62,
+    0x28, 0x06, 0x1e, 0xc1, 0xfe, 0x64, 0x20, 0x06, 0x7b, 0xe2, 0x0c, 0x3e,
+    0x87, 0xe2, 0xf0, 0x42, 0x90, 0xe0, 0x42, 0x15, 0x20, 0xd2, 0x05, 0x20,
+    0x4f, 0x16, 0x20, 0x18, 0xcb, 0x4f, 0x06, 0x04, 0xc5, 0xcb, 0x11, 0x17,
+    0xc1, 0xcb, 0x11, 0x17, 0x05, 0x20, 0xf5, 0x22, 0x23, 0x22, 0x23, 0xc9,
+    0xce, 0xed, 0x66, 0x66, 0xcc, 0x0d, 0x00, 0x0b, 0x03, 0x73, 0x00, 0x83,
+    0x00, 0x0c, 0x00, 0x0d, 0x00, 0x08, 0x11, 0x1f, 0x88, 0x89, 0x00, 0x0e,
+    0xdc, 0xcc, 0x6e, 0xe6, 0xdd, 0xdd, 0xd9, 0x99, 0xbb, 0xbb, 0x67, 0x63,
+    0x6e, 0x0e, 0xec, 0xcc, 0xdd, 0xdc, 0x99, 0x9f, 0xbb, 0xb9, 0x33, 0x3e,
+    0x3c, 0x42, 0xb9, 0xa5, 0xb9, 0xa5, 0x42, 0x3c, 0x21, 0x04, 0x01, 0x11,
+    0xa8, 0x00, 0x1a, 0x13, 0xbe, 0x20, 0xfe, 0x23, 0x7d, 0xfe, 0x34, 0x20,
+    0xf5, 0x06, 0x19, 0x78, 0x86, 0x23, 0x05, 0x20, 0xfb, 0x86, 0x20, 0xfe,
+    0x3e, 0x01, 0xe0, 0x50
+};
+
+/*
+ * Lazy flags.
+ * Most flags are overwritten before anything reads them, so instead of
+ * computing Z N H C, ALU instructions record what they did and the flags
+ * are only written to F when N or H is needed, F is written partially,
+ * or AF is read as a whole. While op is FLAG_OP_NONE, F is up to date.
+ * result keeps the carry in bit 8 so that Z and C are cheap to read,
+ * INC and DEC copy the previous carry there as they leave C untouched.
+ * Define MY_GB_EAGER_FLAGS to compute flags immediately, for cross checking.
+ * FLAG_OP is in cpu.h, native blocks record flags too.
+ */
+
+// Tables below are expanded by the preprocessor, so they are constant data
+// built at compile time. REPEAT_N(m, x, n) is m(x, n) ... m(x, n + N - 1).
+#define REPEAT_4(m, x, n) m(x, (n)) m(x, (n) + 1) m(x, (n) + 2) m(x, (n) + 3)
+#define REPEAT_16(m, x, n) REPEAT_4(m, x, n) REPEAT_4(m, x, (n) + 4) REPEAT_4(m, x, (n) + 8) REPEAT_4(m, x, (n) + 12)
+#define REPEAT_64(m, x, n) REPEAT_16(m, x, n) REPEAT_16(m, x, (n) + 16) REPEAT_16(m, x, (n) + 32) REPEAT_16(m, x, (n) + 48)
+#define REPEAT_256(m, x, n) REPEAT_64(m, x, n) REPEAT_64(m, x, (n) + 64) REPEAT_64(m, x, (n) + 128) REPEAT_64(m, x, (n) + 192)
+#define REPEAT_1024(m, x, n) REPEAT_256(m, x, n) REPEAT_256(m, x, (n) + 256) REPEAT_256(m, x, (n) + 512) REPEAT_256(m, x, (n) + 768)
+
+/*
+ * F of every recorded op, indexed by FLAG_INDEX: bit 0-8 are the result
+ * with its carry, bit 9 is the carry out of bit 3 (a ^ b ^ result), which
+ * is the half carry of ADD and SUB. INC and DEC find H in the result and
+ * the other ops ignore bit 9.
+ */
+#define FLAG_INDEX(a, b, result) ((((a) ^ (b) ^ (result)) & 0x10) << 5 | ((result) & 0x1FF))
+#define FLAGS_ENTRY(op, i) (uint8_t)( \
+    (((i) & 0xFF) ? 0x00 : 0x80) | (((i) >> 4) & 0x10) | \
+    ((op) == FLAG_OP_ADD ? ((i) >> 4) & 0x20 : \
+     (op) == FLAG_OP_SUB ? 0x40 | (((i) >> 4) & 0x20) : \
+     (op) == FLAG_OP_AND ? 0x20 : \
+     (op) == FLAG_OP_INC ? (((i) & 0xF) ? 0x00 : 0x20) : \
+     (op) == FLAG_OP_DEC ? 0x40 | ((((i) & 0xF) == 0xF) ? 0x20 : 0x00) : 0x00)),
+
+static const uint8_t flags_table[FLAG_OP_NUM][1024] = {
+    { REPEAT_1024(FLAGS_ENTRY, FLAG_OP_NONE, 0) },
+    { REPEAT_1024(FLAGS_ENTRY, FLAG_OP_ADD, 0) },
+    { REPEAT_1024(FLAGS_ENTRY, FLAG_OP_SUB, 0) },
+    { REPEAT_1024(FLAGS_ENTRY, FLAG_OP_AND, 0) },
+    { REPEAT_1024(FLAGS_ENTRY, FLAG_OP_OR, 0) },
+    { REPEAT_1024(FLAGS_ENTRY, FLAG_OP_INC, 0) },
+    { REPEAT_1024(FLAGS_ENTRY, FLAG_OP_DEC, 0) },
+};
+#undef FLAGS_ENTRY
+
+/*
+ * AF after DAA, indexed by A | N << 8 | H << 9 | C << 10.
+ * After a subtraction the adjustment only depends on H and C, after an
+ * addition also on A being out of BCD range.
+ */
+#define DAA_N(i) (((i) >> 8) & 0x1)
+#define DAA_H(i) (((i) >> 9) & 0x1)
+#define DAA_C(i) ((((i) >> 10) & 0x1) || (!DAA_N(i) && ((i) & 0xFF) > 0x99))
+#define DAA_A(i) (uint8_t)(DAA_N(i) ? \
+    ((i) & 0xFF) - (DAA_H(i) ? 0x06 : 0x00) - (DAA_C(i) ? 0x60 : 0x00) : \
+    ((i) & 0xFF) + (DAA_C(i) ? 0x60 : 0x00) + ((DAA_H(i) || ((i) & 0x0F) > 0x09) ? 0x06 : 0x00))
+#define DAA_ENTRY(x, i) (uint16_t)(DAA_A(i) << 8 | (DAA_A(i) ? 0x00 : 0x80) | DAA_N(i) << 6 | DAA_C(i) << 4),
+
+static const uint16_t daa_table[0x800] = {
+    REPEAT_1024(DAA_ENTRY, 0, 0)
+    REPEAT_1024(DAA_ENTRY, 0, 0x400)
+};
+#undef DAA_ENTRY
+#undef DAA_A
+#undef DAA_C
+#undef DAA_H
+#undef DAA_N
+
+static inline uint8_t _flags_compute(uint8_t op, uint8_t a, uint8_t b, uint16_t result)
+{
+    return flags_table[op][FLAG_INDEX(a, b, result)];
+}
+
+#ifdef MY_GB_EAGER_FLAGS
+#define flags_record(_op, _a, _b, _result) \
+    do { gb->cpu.AF = (gb->cpu.AF & (uint16_t)0xFF00) | _flags_compute((_op), (_a), (_b), (_result)); } while(0)
+#else
+#define flags_record(_op, _a, _b, _result) \
+    do { gb->cpu.flags.op = (_op); gb->cpu.flags.a = (_a); gb->cpu.flags.b = (_b); gb->cpu.flags.result = (_result); } while(0)
+
+static inline void _flags_materialize(struct gb_machine *gb)
+{
+    if (gb->cpu.flags.op != FLAG_OP_NONE) {
+        gb->cpu.AF = (gb->cpu.AF & (uint16_t)0xFF00) | _flags_compute(gb->cpu.flags.op, gb->cpu.flags.a, gb->cpu.flags.b, gb->cpu.flags.result);
+        gb->cpu.flags.op = FLAG_OP_NONE;
+    }
+}
+#endif
+
+// bit mask of the interruptions
+// The lower the bit, the higher the priority
+#define INT_VBLANK_MASK 0x1
+#define INT_LCDC_STATUS_MASK 0x2
+#define INT_TIMER_OVERFLOW_MASK 0x4
+#define INT_SERIAL_TRANSFER_COMPLETION_MASK 0x8
+#define INT_BUTTON_PRESS_MASK 0x10
+
+#define INT_VBLANK_ADDRESS 0x0040
+#define INT_LCDC_STATUS_ADDRESS 0x0048
+#define INT_TIMER_OVERFLOW_ADDRESS 0x0050
+#define INT_SERIAL_TRANSFER_COMPLETION_ADDRESS 0x0058
+#define INT_BUTTON_PRESS_ADDRESS 0x0060
+#define INT_MASK 0x1F
+
+// two wait cycles, PC pushed in two cycles, then the jump
+#define INT_DISPATCH_CYCLES 5
+
+// 8 bits shifted out at 8192Hz
+#define SERIAL_TRANSFER_CYCLES 1024
+
+// OAM DMA moves 160 bytes, one per machine cycle
+#define DMA_CYCLES 160
+#define DMA_LENGTH 0xA0
+
+// Currently we ensure only valid bits of the result can be 0 or 1,
+// invalid bit can only be 0.
+// Maybe we can do something to get rid of these duplicate defensive measure,
+// to squeeze the last drop of cpu performance.
+#define get_A ((uint8_t)(gb->cpu.AF >> 8))
+#define get_B ((uint8_t)(gb->cpu.BC >> 8))
+#define get_C ((uint8_t)(gb->cpu.BC & (uint16_t)0x00FF))
+#define get_D ((uint8_t)(gb->cpu.DE >> 8))
+#define get_E ((uint8_t)(gb->cpu.DE & (uint16_t)0x00FF))
+#define get_H ((uint8_t)(gb->cpu.HL >> 8))
+#define get_L ((uint8_t)(gb->cpu.HL & (uint16_t)0x00FF))
+#ifdef MY_GB_EAGER_FLAGS
+#define get_AF gb->cpu.AF
+#define get_flag_Z (((uint8_t)gb->cpu.AF >> 7) & (uint8_t)0x1)
+#define get_flag_N (((uint8_t)gb->cpu.AF >> 6) & (uint8_t)0x1)
+#define get_flag_H (((uint8_t)gb->cpu.AF >> 5) & (uint8_t)0x1)
+#define get_flag_C (((uint8_t)gb->cpu.AF >> 4) & (uint8_t)0x1)
+#else
+// Z and C can be read from the last result, N and H need the flags materialized
+#define get_AF (_flags_materialize(gb), gb->cpu.AF)
+#define get_flag_Z (gb->cpu.flags.op ? (uint8_t)!(uint8_t)gb->cpu.flags.result : (((uint8_t)gb->cpu.AF >> 7) & (uint8_t)0x1))
+#define get_flag_N (_flags_materialize(gb), (((uint8_t)gb->cpu.AF >> 6) & (uint8_t)0x1))
+#define get_flag_H (_flags_materialize(gb), (((uint8_t)gb->cpu.AF >> 5) & (uint8_t)0x1))
+#define get_flag_C (gb->cpu.flags.op ? (uint8_t)((gb->cpu.flags.result >> 8) & 0x1) : (((uint8_t)gb->cpu.AF >> 4) & (uint8_t)0x1))
+#endif
+
+#define set_A(a) do { gb->cpu.AF = (gb->cpu.AF & (uint16_t)0x00FF) | ((uint16_t)(a) << 8); } while(0)
+#define set_B(b) do { gb->cpu.BC = (gb->cpu.BC & (uint16_t)0x00FF) | ((uint16_t)(b) << 8); } while(0)
+#define set_C(c) do { gb->cpu.BC = (gb->cpu.BC & (uint16_t)0xFF00) | ((uint16_t)(c) & (uint16_t)0x00FF); } while(0)
+#define set_D(d) do { gb->cpu.DE = (gb->cpu.DE & (uint16_t)0x00FF) | ((uint16_t)(d) << 8); } while(0)
+#define set_E(e) do { gb->cpu.DE = (gb->cpu.DE & (uint16_t)0xFF00) | ((uint16_t)(e) & (uint16_t)0x00FF); } while(0)
+#define set_H(h) do { gb->cpu.HL = (gb->cpu.HL & (uint16_t)0x00FF) | ((uint16_t)(h) << 8); } while(0)
+#define set_L(l) do { gb->cpu.HL = (gb->cpu.HL & (uint16_t)0xFF00) | ((uint16_t)(l) & (uint16_t)0x00FF); } while(0)
+#ifdef MY_GB_EAGER_FLAGS
+#define set_flag_Z(b) do { gb->cpu.AF = (gb->cpu.AF & ~((uint16_t)0x1 << 7)) | (((uint16_t)(b) & (uint16_t)0x1) << 7); } while(0)
+#define set_flag_N(b) do { gb->cpu.AF = (gb->cpu.AF & ~((uint16_t)0x1 << 6)) | (((uint16_t)(b) & (uint16_t)0x1) << 6); } while(0)
+#define set_flag_H(b) do { gb->cpu.AF = (gb->cpu.AF & ~((uint16_t)0x1 << 5)) | (((uint16_t)(b) & (uint16_t)0x1) << 5); } while(0)
+#define set_flag_C(b) do { gb->cpu.AF = (gb->cpu.AF & ~((uint16_t)0x1 << 4)) | (((uint16_t)(b) & (uint16_t)0x1) << 4); } while(0)
+#define set_flags(z, n, h, c) do { gb->cpu.AF = (gb->cpu.AF & (uint16_t)0xFF00) | (((uint16_t)(z) & (uint16_t)0x1) << 7) | (((uint16_t)(n) & (uint16_t)0x1) << 6) | (((uint16_t)(h) & (uint16_t)0x1) << 5) | (((uint16_t)(c) & (uint16_t)0x1) << 4); } while(0)
+#define set_AF(af) do { gb->cpu.AF = (af); } while(0)
+#else
+#define set_flag_Z(b) do { _flags_materialize(gb); gb->cpu.AF = (gb->cpu.AF & ~((uint16_t)0x1 << 7)) | (((uint16_t)(b) & (uint16_t)0x1) << 7); } while(0)
+#define set_flag_N(b) do { _flags_materialize(gb); gb->cpu.AF = (gb->cpu.AF & ~((uint16_t)0x1 << 6)) | (((uint16_t)(b) & (uint16_t)0x1) << 6); } while(0)
+#define set_flag_H(b) do { _flags_materialize(gb); gb->cpu.AF = (gb->cpu.AF & ~((uint16_t)0x1 << 5)) | (((uint16_t)(b) & (uint16_t)0x1) << 5); } while(0)
+#define set_flag_C(b) do { _flags_materialize(gb); gb->cpu.AF = (gb->cpu.AF & ~((uint16_t)0x1 << 4)) | (((uint16_t)(b) & (uint16_t)0x1) << 4); } while(0)
+#define set_flags(z, n, h, c) do { uint8_t _f = ((((z) & 0x1) << 7) | (((n) & 0x1) << 6) | (((h) & 0x1) << 5) | (((c) & 0x1) << 4)); gb->cpu.flags.op = FLAG_OP_NONE; gb->cpu.AF = (gb->cpu.AF & (uint16_t)0xFF00) | _f; } while(0)
+#define set_AF(af) do { gb->cpu.flags.op = FLAG_OP_NONE; gb->cpu.AF = (af); } while(0)
+#endif
+
+
+
+// Called whenever IME, IE or IF changes.
+static inline void _interrupt_update(struct gb_machine *gb)
+{
+    gb->cpu.interrupt_pending = gb->cpu.IME && (gb->cpu.IE & gb->cpu.IF & INT_MASK);
+}
+
+// Unmap writes of pages holding cached code, see code_page.
+static void _memory_map_code(struct gb_machine *gb)
+{
+    for (uint32_t page = 0xA0; page < 0x100; ++page) {
+        if (gb->cpu.code_page[page])
+            gb->cpu.page_write[page] = NULL;
+    }
+}
+
+// Writes of tile data go through _address_write_slow,
+// which tells the screen the decoded tile is stale.
+static void _memory_map_vram(struct gb_machine *gb)
+{
+    if (gb->cpu.dma_active)
+        return;
+    for (uint32_t page = 0x80; page < 0xA0; ++page) {
+        uint8_t *host = gb->cpu.internal_ram + RAM_OFFSET_VRAM + (page - 0x80) * 0x100;
+        gb->cpu.page_read[page] = gb->cpu.vram_locked ? NULL : host;
+        gb->cpu.page_write[page] = page < (TILE_DATA_END >> 8) ? NULL : host;
+    }
+}
+
+// Cart banks change when MBC registers are written,
+// and boot rom is unmapped when BOOT register is written.
+static void _memory_map_cart(struct gb_machine *gb)
+{
+    if (gb->cpu.dma_active)
+        return;
+    my_gb_cart_map(gb, gb->cpu.page_read, gb->cpu.page_write);
+    if (!gb->cpu.BOOT)
+        gb->cpu.page_read[0x00] = (uint8_t *)internal_rom;  // read pages are never written
+    _memory_map_code(gb);
+}
+
+static void _memory_map(struct gb_machine *gb)
+{
+    for (uint32_t page = 0; page < 0x100; ++page) {
+        gb->cpu.page_read[page] = NULL;
+        gb->cpu.page_write[page] = NULL;
+    }
+
+    _memory_map_cart(gb);
+
+    if (!gb->cpu.internal_ram || gb->cpu.dma_active)
+        return;
+
+    _memory_map_vram(gb);
+    for (uint32_t page = 0xC0; page < 0xE0; ++page) {
+        uint8_t *host = gb->cpu.internal_ram + RAM_OFFSET_INTERNAL_RAM + (page - 0xC0) * 0x100;
+        gb->cpu.page_read[page] = host;
+        gb->cpu.page_write[page] = host;
+    }
+    // echo of internal RAM, 0xFE00 page is not echoed because OAM is there
+    for (uint32_t page = 0xE0; page < 0xFE; ++page) {
+        uint8_t *host = gb->cpu.internal_ram + RAM_OFFSET_INTERNAL_RAM + (page - 0xE0) * 0x100;
+        gb->cpu.page_read[page] = host;
+        gb->cpu.page_write[page] = host;
+    }
+    // 0xFE00 (OAM and unused area) and 0xFF00 (I/O registers, HRAM and IE)
+    // pages are left to handlers.
+    _memory_map_code(gb);
+}
+
+// Echo RAM shares the code and generation of internal RAM.
+static inline uint8_t _code_page_canonical(uint8_t page)
+{
+    return (page >= 0xE0 && page < 0xFE) ? page - 0x20 : page;
+}
+
+// Pages of one region share their bank and the way writes are caught,
+// an operand may cross from one to the next: ROM bank 0, switchable ROM
+// bank, cart RAM, internal RAM with its echo.
+static inline uint32_t _code_page_follows(uint8_t page)
+{
+    uint32_t next = page + 1;
+    return next != 0x40 && next != 0x80 && next != 0xA0 && next != 0xC0 && next < 0xFE;
+}
+
+// Writes of HRAM only hit code between code_hram_begin and code_hram_end.
+static inline uint32_t _code_written(struct gb_machine *gb, uint16_t address)
+{
+    if (!gb->cpu.code_page[address >> 8])
+        return 0;
+    if (address < 0xFF00)
+        return 1;
+    return (address & 0xFF) >= gb->cpu.code_hram_begin && (address & 0xFF) < gb->cpu.code_hram_end;
+}
+
+static void _code_page_written(struct gb_machine *gb, uint8_t page)
+{
+    page = _code_page_canonical(page);
+    ++gb->cpu.code_generation[page];
+    // the executing block may be on the page
+    gb->cpu.block = NULL;
+    gb->cpu.code_page[page] = 0;
+    if (page >= 0xC0 && page < 0xDE)
+        gb->cpu.code_page[page + 0x20] = 0;
+    // HRAM page is never mapped
+    if (page < 0xFE)
+        _memory_map(gb);
+    else
+        gb->cpu.code_hram_begin = gb->cpu.code_hram_end = 0;
+}
+
+// Catch writes to page, holding code of a block which was just decoded.
+static void _code_page_mark(struct gb_machine *gb, uint8_t page)
+{
+    gb->cpu.code_page[page] = 1;
+    gb->cpu.page_write[page] = NULL;
+    if (page >= 0xC0 && page < 0xDE) {
+        gb->cpu.code_page[page + 0x20] = 1;
+        gb->cpu.page_write[page + 0x20] = NULL;
+    }
+}
+
+/*
+ * I/O registers (0xFF00-0xFF7F), indexed by the low 7 bits of the address.
+ * A plain register is a byte of the machine at offset: reads OR in the
+ * unused bits, which read as 1, and writes only change the writable bits,
+ * the others are read only or driven by the hardware.
+ * Registers with side effects have handlers instead, which see the whole
+ * byte written or return the whole byte read (unused bits are still ORed in).
+ * Entries left out (offset 0 is the scheduler, never a register) are unused
+ * addresses: they read 0xFF and ignore writes.
+ */
+struct io_register {
+    uint32_t offset;
+    uint8_t unused;
+    uint8_t writable;
+    uint8_t (*read)(struct gb_machine *gb, uint16_t address);
+    void (*write)(struct gb_machine *gb, uint16_t address, uint8_t data);
+};
+
+static void _io_write_SC(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    gb->cpu.SC = data;
+    // only internal clock transfers complete, there is no link partner
+    if ((gb->cpu.SC & 0x81) == 0x81)
+        my_gb_scheduler_schedule(gb, EVENT_SERIAL, gb->scheduler.clock + SERIAL_TRANSFER_CYCLES);
+}
+
+static void _io_write_BOOT(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    gb->cpu.BOOT = data;
+    _memory_map_cart(gb);
+    gb->cpu.block = NULL;
+    MY_GB_TRACE(TRACE_BOOT_FINISHED, gb->cpu.PC,
+        get_AF == 0x01B0 &&
+        gb->cpu.BC == 0x0013 &&
+        gb->cpu.DE == 0x00D8 &&
+        gb->cpu.HL == 0x014D &&
+        gb->cpu.SP == 0xFFFE &&
+        gb->cpu.PC == 0x0100);
+}
+
+static void _io_write_IF(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    gb->cpu.IF = data & INT_MASK;
+    _interrupt_update(gb);
+}
+
+static uint8_t _address_read_slow(struct gb_machine *gb, uint16_t address);
+
+/*
+ * OAM DMA copies the whole source page at once when DMA is written, then
+ * keeps the bus for DMA_CYCLES: every page is unmapped and accesses below
+ * HRAM read 0xFF and are dropped until EVENT_DMA, so the HRAM wait loop of
+ * games runs as on hardware while the copy itself costs a memcpy.
+ */
+static void _io_write_DMA(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    uint8_t *oam = gb->cpu.internal_ram + RAM_OFFSET_OAM;
+    // sources above internal RAM see its echo
+    uint8_t page = data >= 0xE0 ? data - 0x20 : data;
+    uint8_t *host;
+
+    gb->screen.DMA = data;
+    // a new transfer restarts the running one
+    if (gb->cpu.dma_active) {
+        gb->cpu.dma_active = 0;
+        _memory_map(gb);
+    }
+
+    host = gb->cpu.page_read[page];
+    if (host) {
+        memcpy(oam, host, DMA_LENGTH);
+    } else {
+        for (uint32_t i = 0; i < DMA_LENGTH; ++i)
+            oam[i] = _address_read_slow(gb, (uint16_t)((page << 8) | i));
+    }
+
+    gb->cpu.dma_active = 1;
+    _memory_map(gb);
+    my_gb_scheduler_schedule(gb, EVENT_DMA, gb->scheduler.clock + DMA_CYCLES);
+}
+
+static void _dma_finish(struct gb_machine *gb, uint64_t deadline)
+{
+    gb->cpu.dma_active = 0;
+    _memory_map(gb);
+}
+
+#define IO(field, unused, writable) { (uint32_t)offsetof(struct gb_machine, field), unused, writable, NULL, NULL }
+#define IO_HANDLER(field, unused, read, write) { (uint32_t)offsetof(struct gb_machine, field), unused, 0xFF, read, write }
+
+static const struct io_register io_registers[0x80] = {
+    [0x00] = IO(input.P1, 0x00, 0xFF),
+    [0x01] = IO(cpu.SB, 0x00, 0xFF),
+    [0x02] = IO_HANDLER(cpu.SC, 0x7E, NULL, _io_write_SC),
+    [0x04] = IO_HANDLER(timer, 0x00, my_gb_timer_read, my_gb_timer_write),
+    [0x05] = IO_HANDLER(timer, 0x00, my_gb_timer_read, my_gb_timer_write),
+    [0x06] = IO_HANDLER(timer, 0x00, my_gb_timer_read, my_gb_timer_write),
+    [0x07] = IO_HANDLER(timer, 0x00, my_gb_timer_read, my_gb_timer_write),
+    [0x0F] = IO_HANDLER(cpu.IF, 0xE0, NULL, _io_write_IF),
+    [0x10] = IO(sound.NR10, 0x80, 0xFF),
+    [0x11] = IO(sound.NR11, 0x3F, 0xFF),
+    [0x12] = IO(sound.NR12, 0x00, 0xFF),
+    [0x13] = IO(sound.NR13, 0xFF, 0xFF),
+    [0x14] = IO(sound.NR14, 0xBF, 0xFF),
+    [0x16] = IO(sound.NR21, 0x3F, 0xFF),
+    [0x17] = IO(sound.NR22, 0x00, 0xFF),
+    [0x18] = IO(sound.NR23, 0xFF, 0xFF),
+    [0x19] = IO(sound.NR24, 0xBF, 0xFF),
+    [0x1A] = IO(sound.NR30, 0x7F, 0xFF),
+    [0x1B] = IO(sound.NR31, 0xFF, 0xFF),
+    [0x1C] = IO(sound.NR32, 0x9F, 0xFF),
+    [0x1D] = IO(sound.NR33, 0xFF, 0xFF),
+    [0x1E] = IO(sound.NR34, 0xBF, 0xFF),
+    [0x20] = IO(sound.NR41, 0xFF, 0xFF),
+    [0x21] = IO(sound.NR42, 0x00, 0xFF),
+    [0x22] = IO(sound.NR43, 0x00, 0xFF),
+    [0x23] = IO(sound.NR44, 0xBF, 0xFF),
+    [0x24] = IO(sound.NR50, 0x00, 0xFF),
+    [0x25] = IO(sound.NR51, 0x00, 0xFF),
+    [0x26] = IO(sound.NR52, 0x70, 0x80),    // channel flags are read only
+    [0x30] = IO(sound.W[0x0], 0x00, 0xFF),
+    [0x31] = IO(sound.W[0x1], 0x00, 0xFF),
+    [0x32] = IO(sound.W[0x2], 0x00, 0xFF),
+    [0x33] = IO(sound.W[0x3], 0x00, 0xFF),
+    [0x34] = IO(sound.W[0x4], 0x00, 0xFF),
+    [0x35] = IO(sound.W[0x5], 0x00, 0xFF),
+    [0x36] = IO(sound.W[0x6], 0x00, 0xFF),
+    [0x37] = IO(sound.W[0x7], 0x00, 0xFF),
+    [0x38] = IO(sound.W[0x8], 0x00, 0xFF),
+    [0x39] = IO(sound.W[0x9], 0x00, 0xFF),
+    [0x3A] = IO(sound.W[0xA], 0x00, 0xFF),
+    [0x3B] = IO(sound.W[0xB], 0x00, 0xFF),
+    [0x3C] = IO(sound.W[0xC], 0x00, 0xFF),
+    [0x3D] = IO(sound.W[0xD], 0x00, 0xFF),
+    [0x3E] = IO(sound.W[0xE], 0x00, 0xFF),
+    [0x3F] = IO(sound.W[0xF], 0x00, 0xFF),
+    [0x40] = IO(screen.LCDC, 0x00, 0xFF),
+    [0x41] = IO(screen.STAT, 0x80, 0x78),   // mode and coincidence are read only
+    [0x42] = IO(screen.SCY, 0x00, 0xFF),
+    [0x43] = IO(screen.SCX, 0x00, 0xFF),
+    [0x44] = IO(screen.LY, 0x00, 0x00),
+    [0x45] = IO(screen.LYC, 0x00, 0xFF),
+    [0x46] = IO_HANDLER(screen.DMA, 0x00, NULL, _io_write_DMA),
+    [0x47] = IO_HANDLER(screen.BGP, 0x00, NULL, my_gb_screen_palette_write),
+    [0x48] = IO_HANDLER(screen.OBP0, 0x00, NULL, my_gb_screen_palette_write),
+    [0x49] = IO_HANDLER(screen.OBP1, 0x00, NULL, my_gb_screen_palette_write),
+    [0x4A] = IO(screen.WY, 0x00, 0xFF),
+    [0x4B] = IO(screen.WX, 0x00, 0xFF),
+    [0x50] = IO_HANDLER(cpu.BOOT, 0x00, NULL, _io_write_BOOT),
+};
+
+#undef IO
+#undef IO_HANDLER
+
+static uint8_t _io_read(struct gb_machine *gb, uint16_t address)
+{
+    const struct io_register *reg = &io_registers[address & 0x7F];
+    // unused registers read as 0xFF
+    if (reg->offset == 0)
+        return 0xFF;
+    if (reg->read)
+        return reg->read(gb, address) | reg->unused;
+    return *((uint8_t *)gb + reg->offset) | reg->unused;
+}
+
+static void _io_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    const struct io_register *reg = &io_registers[address & 0x7F];
+    // and ignore writes, games probe some of them(CGB speed switch) all along
+    if (reg->offset == 0)
+        return;
+    if (reg->write) {
+        reg->write(gb, address, data);
+    } else {
+        uint8_t *storage = (uint8_t *)gb + reg->offset;
+        *storage = (*storage & ~reg->writable) | (data & reg->writable);
+    }
+}
+
+static uint8_t _address_read_slow(struct gb_machine *gb, uint16_t address)
+{
+    // return 0xFF when invalid
+    uint8_t read_result;
+
+    // only HRAM and I/O can be reached while OAM DMA owns the bus
+    if (gb->cpu.dma_active && address < 0xFF00)
+        return 0xFF;
+
+    if (address <= 0x00FF) {
+        //|------------------------------------------------------
+        //| (0x0000-0x00FF) internal ROM / non-switchable ROM BANK
+        //|------------------------------------------------------
+        if (gb->cpu.BOOT) {	// if bootstrap have been executed
+            read_result = my_gb_cart_address_read(gb, address);
+        } else {
+            read_result = internal_rom[address];
+        }
+    } else if (address <= 0x3FFF) {
+        //|------------------------------------------------------
+        //| (0x00FF-0x3FFF) non-switchable ROM BANK
+        //|------------------------------------------------------
+        read_result = my_gb_cart_address_read(gb, address);
+    } else if (address <= 0x7FFF) {
+        //|------------------------------------------------------
+        //| (0x4000-0x7FFF) switchable ROM BANK
+        //|------------------------------------------------------
+        read_result = my_gb_cart_address_read(gb, address);
+    } else if (address <= 0x9FFF) {
+        //|------------------------------------------------------
+        //| (0x8000-0x9FFF)	Video RAM BANK
+        //|------------------------------------------------------
+        uint8_t lcd_state = gb->screen.STAT & 0x3;
+        if (lcd_state == 3) {
+            fprintf(stderr, "LCD state: %d and VRAM cannot be accessed.\n", lcd_state);
+            read_result = 0xFF;
+        } else {
+            read_result = gb->cpu.internal_ram[address - 0x8000 + RAM_OFFSET_VRAM];
+        }
+    } else if (address <= 0xBFFF) {
+        //|------------------------------------------------------
+        //| (0xA000-0xBFFF)	switchable Cartridge RAM BANK
+        //|------------------------------------------------------
+        read_result = my_gb_cart_address_read(gb, address);
+    } else if (address <= 0xDFFF) {
+        //|------------------------------------------------------
+        //| (0xC000-0xDFFF) Game Boy internal RAM BANK
+        //|------------------------------------------------------
+        read_result = gb->cpu.internal_ram[address - 0xC000 + RAM_OFFSET_INTERNAL_RAM];
+    } else if (address <= 0xFDFF) {
+        //|------------------------------------------------------
+        //| (0xE000-0xFDFF) echo of Game Boy internal RAM BANK
+        //|------------------------------------------------------
+        read_result = gb->cpu.internal_ram[address - 0xE000 + RAM_OFFSET_INTERNAL_RAM];
+    } else if (address <= 0xFE9F) {
+        //|------------------------------------------------------
+        //| (0xFE00-0xFE9F) Object Attribute Memory(Sprite information table)
+        //|------------------------------------------------------
+        read_result = gb->cpu.internal_ram[address - 0xFE00 + RAM_OFFSET_OAM];
+    } else if (address <= 0xFEFF) {
+        //|------------------------------------------------------
+        //| (0xFEA0-0xFEFF) Unused memory
+        //|------------------------------------------------------
+        fprintf(stderr, "Access to unused memory(%16X) was denied.\n", address);
+        read_result = 0xFF;
+    } else if (address <= 0xFF7F) {
+        //|------------------------------------------------------
+        //| (0xFF00-0xFF7F) Game Boy I/O registers
+        //|------------------------------------------------------
+        read_result = _io_read(gb, address);
+    } else if (address <= 0xFFFE) {
+        //|------------------------------------------------------
+        //| (0xFF80-0xFFFE) Internal RAM(Heap RAM) in Game Boy(often used as stack)
+        //|------------------------------------------------------
+        read_result = gb->cpu.internal_ram[address - 0xFF80 + RAM_OFFSET_HRAM];
+    } else { //if (address <= 0xFFFF) {
+        //|------------------------------------------------------
+        //| (0xFFFF-0xFFFF) Interrupt enable flag
+        //|------------------------------------------------------
+        read_result = gb->cpu.IE;
+    }
+    return read_result;
+}
+
+static inline uint8_t _address_read(struct gb_machine *gb, uint16_t address)
+{
+    uint8_t *page = gb->cpu.page_read[address >> 8];
+    if (page)
+        return page[address & 0xFF];
+    return _address_read_slow(gb, address);
+}
+
+static uint16_t _address_read_16(struct gb_machine *gb, uint16_t address)
+{
+    uint16_t data = (uint16_t)_address_read(gb, address);
+    data |= ((uint16_t)_address_read(gb, address + 1)) << 8;
+    return data;
+}
+
+static void _address_write_slow(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    if (gb->cpu.dma_active && address < 0xFF00)
+        return;
+    if (_code_written(gb, address))
+        _code_page_written(gb, address >> 8);
+    // check deadline and interruptions again before the next op
+    gb->cpu.op_stop = gb->cpu.op_next;
+
+    if (address <= 0x7FFF) {
+        //|------------------------------------------------------
+        //| (0x0000-0x3FFF) non-switchable ROM BANK
+        //|------------------------------------------------------
+        //|------------------------------------------------------
+        //| (0x4000-0x7FFF) switchable ROM BANK
+        //|------------------------------------------------------
+        // Writing to ROM area means writing MBC registers,
+        // banks may be switched so refresh the mapping.
+        my_gb_cart_address_write(gb, address, data);
+        _memory_map_cart(gb);
+        // the rest of the block may be in another bank now
+        gb->cpu.block = NULL;
+    } else if (address <= 0x9FFF) {
+        //|------------------------------------------------------
+        //| (0x8000-0x9FFF)	Video RAM BANK
+        //|------------------------------------------------------
+        gb->cpu.internal_ram[address - 0x8000 + RAM_OFFSET_VRAM] = data;
+        my_gb_screen_tile_written(gb, address, 1);
+    } else if (address <= 0xBFFF) {
+        //|------------------------------------------------------
+        //| (0xA000-0xBFFF)	switchable Cartridge RAM BANK
+        //|------------------------------------------------------
+        my_gb_cart_address_write(gb, address, data);
+    } else if (address <= 0xDFFF) {
+        //|------------------------------------------------------
+        //| (0xC000-0xDFFF) Game Boy internal RAM BANK
+        //|------------------------------------------------------
+        gb->cpu.internal_ram[address - 0xC000 + RAM_OFFSET_INTERNAL_RAM] = data;
+    } else if (address <= 0xFDFF) {
+        //|------------------------------------------------------
+        //| (0xE000-0xFDFF) echo of Game Boy internal RAM BANK
+        //|------------------------------------------------------
+        gb->cpu.internal_ram[address - 0xE000 + RAM_OFFSET_INTERNAL_RAM] = data;
+    } else if (address <= 0xFE9F) {
+        //|------------------------------------------------------
+        //| (0xFE00-0xFE9F) Object Attribute Memory(Sprite information table)
+        //|------------------------------------------------------
+        gb->cpu.internal_ram[address - 0xFE00 + RAM_OFFSET_OAM] = data;
+    } else if (address <= 0xFEFF) {
+        //|------------------------------------------------------
+        //| (0xFEA0-0xFEFF) Unused memory
+        //|------------------------------------------------------
+        fprintf(stderr, "Failed to write to unused memory(%16X).\n", address);
+    } else if (address <= 0xFF7F) {
+        //|------------------------------------------------------
+        //| (0xFF00-0xFF7F) Game Boy I/O registers
+        //|------------------------------------------------------
+        _io_write(gb, address, data);
+    } else if (address <= 0xFFFE) {
+        //|------------------------------------------------------
+        //| (0xFF80-0xFFFE) Internal RAM in Game Boy(often used as stack)
+        //|------------------------------------------------------
+        gb->cpu.internal_ram[address - 0xFF80 + RAM_OFFSET_HRAM] = data;
+    } else /*if (address <= 0xFFFF)*/ {
+        //|------------------------------------------------------
+        //| (0xFFFF-0xFFFF) Interrupt enable flag
+        //|------------------------------------------------------
+        gb->cpu.IE = data;
+        _interrupt_update(gb);
+    }
+}
+
+static inline void _address_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    uint8_t *page = gb->cpu.page_write[address >> 8];
+    if (page)
+        page[address & 0xFF] = data;
+    else
+        _address_write_slow(gb, address, data);
+}
+
+static void _address_write_16(struct gb_machine *gb, uint16_t address, uint16_t data_16)
+{
+    // consider situation that write a word across two memory bank into consideration
+    // so split data_16 to write
+    _address_write(gb, address, (uint8_t)data_16);
+    _address_write(gb, address + 1, (uint8_t)(data_16 >> 8));
+}
+
+/*
+ * Machine cycles taken by each instruction.
+ * Conditional instructions are listed with the cost of the not taken path,
+ * their handlers return the extra cycles of the taken path.
+ * JR r8 shares the handler of JR cc, so it is listed like them.
+ * Unused opcodes are given 1 cycle so that a bad jump still makes progress.
+ */
+static const uint8_t cycles_table[0x100] = {
+/*  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF */
+    1, 3, 2, 2, 1, 1, 2, 1, 5, 2, 2, 2, 1, 1, 2, 1,     // 0x
+    1, 3, 2, 2, 1, 1, 2, 1, 2, 2, 2, 2, 1, 1, 2, 1,     // 1x
+    2, 3, 2, 2, 1, 1, 2, 1, 2, 2, 2, 2, 1, 1, 2, 1,     // 2x
+    2, 3, 2, 2, 3, 3, 3, 1, 2, 2, 2, 2, 1, 1, 2, 1,     // 3x
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // 4x
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // 5x
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // 6x
+    2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 1, 1, 1, 1, 2, 1,     // 7x
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // 8x
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // 9x
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // Ax
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // Bx
+    2, 3, 3, 4, 3, 4, 2, 4, 2, 4, 3, 1, 3, 6, 2, 4,     // Cx
+    2, 3, 3, 1, 3, 4, 2, 4, 2, 4, 3, 1, 3, 1, 2, 4,     // Dx
+    3, 3, 2, 1, 1, 4, 2, 4, 4, 1, 4, 1, 1, 1, 2, 4,     // Ex
+    3, 3, 2, 1, 1, 4, 2, 4, 3, 2, 4, 1, 1, 1, 2, 4,     // Fx
+};
+
+/*
+ * Machine cycles taken by prefix CB instructions,
+ * not including the cycle already counted for the prefix itself.
+ */
+static const uint8_t cycles_table_cb[0x100] = {
+/*  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF */
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // 0x RLC RRC
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // 1x RL RR
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // 2x SLA SRA
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // 3x SWAP SRL
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // 4x BIT
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // 5x BIT
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // 6x BIT
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     // 7x BIT
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // 8x RES
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // 9x RES
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // Ax RES
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // Bx RES
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // Cx SET
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // Dx SET
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // Ex SET
+    1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 3, 1,     // Fx SET
+};
+
+/*
+ * Bytes taken by each instruction, including its operand.
+ */
+static const uint8_t length_table[0x100] = {
+/*  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF */
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1,     // 0x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,     // 1x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,     // 2x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,     // 3x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 4x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 5x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 6x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 7x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 8x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 9x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // Ax
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // Bx
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1,     // Cx
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1,     // Dx
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,     // Ex
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,     // Fx
+};
+
+// Instructions which may leave the straight line end the block.
+static inline uint32_t _block_ends(uint8_t opcode)
+{
+    switch (opcode) {
+    case 0x10: case 0x76:                                   // STOP HALT
+    case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:  // JR
+    case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA:  // JP
+    case 0xE9:                                              // JP (HL)
+    case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:  // CALL
+    case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8:  // RET
+    case 0xD9:                                              // RETI
+    case 0xC7: case 0xCF: case 0xD7: case 0xDF:             // RST
+    case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+    case 0xF3: case 0xFB:                                   // DI EI
+    case 0xD3: case 0xDB: case 0xDD: case 0xE3: case 0xE4:  // illegal
+    case 0xEB: case 0xEC: case 0xED: case 0xF4: case 0xFC: case 0xFD:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// Code is cached in ROM, cart RAM, internal RAM and HRAM,
+// not in VRAM, OAM or I/O registers.
+static inline uint32_t _code_cacheable(struct gb_machine *gb, uint16_t pc)
+{
+    uint8_t page = pc >> 8;
+    if (page < 0x80)
+        return 1;
+    if (page == 0xFF)
+        return pc >= 0xFF80;
+    return page >= 0xA0 && page < 0xFE && gb->cpu.page_read[page];
+}
+
+// Bank mapped at pc, boot rom is told apart by 0xFFFF.
+static inline uint16_t _code_bank(struct gb_machine *gb, uint16_t pc)
+{
+    if (pc < 0x0100 && !gb->cpu.BOOT)
+        return 0xFFFF;
+    if (pc < 0x4000)
+        return (uint16_t)gb->cart.rom_bank_0;
+    if (pc < 0x8000)
+        return (uint16_t)gb->cart.rom_bank;
+    if (pc >= 0xA000 && pc < 0xC000)
+        return (uint16_t)gb->cart.ram_bank;
+    return 0;
+}
+
+/*
+ * Code is read through the host pointer of its page, taken once per block,
+ * so fetching is a plain load. base is the address of the page, bytes past
+ * its end(an operand crossing the page) and unmapped pages(I/O, OAM,
+ * locked VRAM) go through _address_read.
+ */
+static inline uint8_t _code_fetch(struct gb_machine *gb, const uint8_t *host, uint16_t base, uint16_t address)
+{
+    uint16_t offset = address - base;
+    if (host && offset < 0x100)
+        return host[offset];
+    return _address_read(gb, address);
+}
+
+/*
+ * Decode at most max_ops instructions from pc, staying inside its page
+ * but for the operand of the last op, which may run into the next page.
+ * Return 0 when that page is in another region, then the block cannot be
+ * cached since writes there(or a bank switch) would not drop it.
+ */
+static uint32_t _block_decode(struct gb_machine *gb, struct gb_block *block, uint16_t pc, uint32_t max_ops)
+{
+    uint8_t page = pc >> 8;
+    const uint8_t *host = gb->cpu.page_read[page];
+    uint16_t base = pc & 0xFF00;
+    uint32_t cacheable = 1;
+    block->pc = pc;
+    block->page = _code_page_canonical(page);
+    block->generation = gb->cpu.code_generation[block->page];
+    block->page_last = block->page;
+    block->count = 0;
+    block->entries = 0;
+    block->native = NULL;
+    for (;;) {
+        struct gb_micro_op *op = &block->ops[block->count];
+        uint8_t opcode = _code_fetch(gb, host, base, pc);
+        uint8_t length = length_table[opcode];
+        if ((pc & 0xFF) + length > 0x100) {
+            if (_code_page_follows(page)) {
+                block->page_last = _code_page_canonical(page + 1);
+            } else if (block->count) {
+                break;
+            } else {
+                cacheable = 0;
+            }
+        }
+        op->pc = pc;
+        op->opcode = opcode;
+        op->length = length;
+        op->operand = 0;
+        if (length > 1)
+            op->operand = _code_fetch(gb, host, base, pc + 1);
+        if (length > 2)
+            op->operand |= (uint16_t)_code_fetch(gb, host, base, pc + 2) << 8;
+        op->cycles = cycles_table[opcode];
+        if (opcode == 0xCB)
+            op->cycles += cycles_table_cb[op->operand];
+        ++block->count;
+        pc += length;
+        if (_block_ends(opcode) || block->count == max_ops || (pc >> 8) != page)
+            break;
+    }
+    block->generation_last = gb->cpu.code_generation[block->page_last];
+    block->ops[block->count - 1].cycles_to_last = 0;
+    for (int i = block->count - 2; i >= 0; --i)
+        block->ops[i].cycles_to_last = block->ops[i + 1].cycles_to_last + block->ops[i].cycles;
+    return cacheable;
+}
+
+// Find the block starting at PC, decoding it when missing.
+static struct gb_block *_block_lookup(struct gb_machine *gb)
+{
+    uint16_t pc = gb->cpu.PC;
+    uint8_t page = pc >> 8;
+    uint16_t bank;
+    struct gb_block *block;
+
+    if (!_code_cacheable(gb, pc)) {
+        block = &gb->cpu.block_scratch;
+        _block_decode(gb, block, pc, 1);
+        return block;
+    }
+
+    bank = _code_bank(gb, pc);
+    block = &gb->cpu.blocks[(pc ^ (bank << 6)) & (BLOCK_CACHE_SIZE - 1)];
+    if (block->count && block->pc == pc && block->bank == bank
+        && block->generation == gb->cpu.code_generation[block->page]
+        && block->generation_last == gb->cpu.code_generation[block->page_last])
+        return block;
+
+    if (!_block_decode(gb, block, pc, BLOCK_MAX_OPS)) {
+        gb->cpu.block_scratch = *block;
+        block->count = 0;
+        return &gb->cpu.block_scratch;
+    }
+    block->bank = bank;
+    if (page >= 0xA0) {
+        // writes to RAM holding code go through _address_write_slow
+        _code_page_mark(gb, block->page);
+        _code_page_mark(gb, block->page_last);
+        if (page == 0xFF) {
+            const struct gb_micro_op *last = &block->ops[block->count - 1];
+            uint32_t end = (last->pc & 0xFF) + last->length;
+            if (gb->cpu.code_hram_begin == gb->cpu.code_hram_end) {
+                gb->cpu.code_hram_begin = pc & 0xFF;
+                gb->cpu.code_hram_end = end;
+            } else {
+                if ((uint32_t)(pc & 0xFF) < gb->cpu.code_hram_begin)
+                    gb->cpu.code_hram_begin = pc & 0xFF;
+                if (end > gb->cpu.code_hram_end)
+                    gb->cpu.code_hram_end = end;
+            }
+        }
+    }
+    return block;
+}
+
+// Called between ops after deadline and interruptions are checked.
+// Carry on in the current block unless PC left it, or look the next one up,
+// then let ops run unchecked as far as the deadline allows.
+static void _block_enter(struct gb_machine *gb)
+{
+    struct gb_block *block = gb->cpu.block;
+    const struct gb_micro_op *op = gb->cpu.op_next;
+    if (!block || op == block->ops + block->count || op->pc != gb->cpu.PC) {
+        block = _block_lookup(gb);
+        op = block->ops;
+        gb->cpu.block = block;
+        gb->cpu.op_next = op;
+    }
+    if (gb->scheduler.clock + op->cycles_to_last < gb->scheduler.deadline)
+        gb->cpu.op_stop = block->ops + block->count;
+    else
+        gb->cpu.op_stop = op + 1;
+}
+
+// Operands are decoded with the instruction, PC already points past it.
+static inline uint8_t _fetch_8(struct gb_machine *gb)
+{
+    return (uint8_t)gb->cpu.operand;
+}
+
+static inline uint16_t _fetch_16(struct gb_machine *gb)
+{
+    return gb->cpu.operand;
+}
+
+static inline void _push_16(struct gb_machine *gb, uint16_t data_16)
+{
+    gb->cpu.SP -= 2;
+    _address_write_16(gb, gb->cpu.SP, data_16);
+}
+
+static inline uint16_t _pop_16(struct gb_machine *gb)
+{
+    uint16_t data_16 = _address_read_16(gb, gb->cpu.SP);
+    gb->cpu.SP += 2;
+    return data_16;
+}
+
+/*
+ * Operand helpers for the regular parts of the opcode table.
+ * Opcodes encode an 8 bit operand in 3 bits:
+ *   0: B, 1: C, 2: D, 3: E, 4: H, 5: L, 6: (HL), 7: A
+ * a 16 bit operand in 2 bits:
+ *   0: BC, 1: DE, 2: HL, 3: SP (AF for PUSH and POP)
+ * and a condition in 2 bits:
+ *   0: NZ, 1: Z, 2: NC, 3: C
+ * Handlers always pass constant indexes, so these switches are folded away after inlining.
+ */
+static inline uint8_t _reg_read(struct gb_machine *gb, uint8_t index)
+{
+    switch (index) {
+    case 0:
+        return get_B;
+    case 1:
+        return get_C;
+    case 2:
+        return get_D;
+    case 3:
+        return get_E;
+    case 4:
+        return get_H;
+    case 5:
+        return get_L;
+    case 6:
+        return _address_read(gb, gb->cpu.HL);
+    default:
+        return get_A;
+    }
+}
+
+static inline void _reg_write(struct gb_machine *gb, uint8_t index, uint8_t data_8)
+{
+    switch (index) {
+    case 0:
+        set_B(data_8);
+        break;
+    case 1:
+        set_C(data_8);
+        break;
+    case 2:
+        set_D(data_8);
+        break;
+    case 3:
+        set_E(data_8);
+        break;
+    case 4:
+        set_H(data_8);
+        break;
+    case 5:
+        set_L(data_8);
+        break;
+    case 6:
+        _address_write(gb, gb->cpu.HL, data_8);
+        break;
+    default:
+        set_A(data_8);
+        break;
+    }
+}
+
+static inline uint16_t *_reg_16(struct gb_machine *gb, uint8_t index)
+{
+    switch (index) {
+    case 0:
+        return &gb->cpu.BC;
+    case 1:
+        return &gb->cpu.DE;
+    case 2:
+        return &gb->cpu.HL;
+    default:
+        return &gb->cpu.SP;
+    }
+}
+
+static inline uint32_t _condition(struct gb_machine *gb, uint8_t index)
+{
+    switch (index) {
+    case 0:
+        return !get_flag_Z;
+    case 1:
+        return get_flag_Z;
+    case 2:
+        return !get_flag_C;
+    default:
+        return get_flag_C;
+    }
+}
+
+// ADD ADC SUB SBC AND XOR OR CP, selected by bit 3-5 of the opcode
+static inline void _alu(struct gb_machine *gb, uint8_t op, uint8_t data_8)
+{
+    uint8_t a = get_A;
+    uint16_t result;
+
+    switch (op) {
+    case 0:		// ADD
+        result = (uint16_t)a + data_8;
+        set_A(result);
+        flags_record(FLAG_OP_ADD, a, data_8, result);
+        break;
+    case 1:		// ADC
+        result = (uint16_t)a + data_8 + get_flag_C;
+        set_A(result);
+        flags_record(FLAG_OP_ADD, a, data_8, result);
+        break;
+    case 2:		// SUB
+        result = (uint16_t)a - data_8;
+        set_A(result);
+        flags_record(FLAG_OP_SUB, a, data_8, result);
+        break;
+    case 3:		// SBC
+        result = (uint16_t)a - data_8 - get_flag_C;
+        set_A(result);
+        flags_record(FLAG_OP_SUB, a, data_8, result);
+        break;
+    case 4:		// AND
+        a &= data_8;
+        set_A(a);
+        flags_record(FLAG_OP_AND, 0, 0, a);
+        break;
+    case 5:		// XOR
+        a ^= data_8;
+        set_A(a);
+        flags_record(FLAG_OP_OR, 0, 0, a);
+        break;
+    case 6:		// OR
+        a |= data_8;
+        set_A(a);
+        flags_record(FLAG_OP_OR, 0, 0, a);
+        break;
+    default:	// CP
+        result = (uint16_t)a - data_8;
+        flags_record(FLAG_OP_SUB, a, data_8, result);
+        break;
+    }
+}
+
+// the carry is kept in bit 8 of the recorded result
+static inline uint32_t _inc_r(struct gb_machine *gb, uint8_t index)
+{
+    // read before flags_record overwrites the recorded op
+    uint16_t carry = (uint16_t)get_flag_C << 8;
+    uint8_t data_8 = _reg_read(gb, index) + 1;
+    _reg_write(gb, index, data_8);
+    flags_record(FLAG_OP_INC, 0, 0, data_8 | carry);
+    return 0;
+}
+
+static inline uint32_t _dec_r(struct gb_machine *gb, uint8_t index)
+{
+    // read before flags_record overwrites the recorded op
+    uint16_t carry = (uint16_t)get_flag_C << 8;
+    uint8_t data_8 = _reg_read(gb, index) - 1;
+    _reg_write(gb, index, data_8);
+    flags_record(FLAG_OP_DEC, 0, 0, data_8 | carry);
+    return 0;
+}
+
+static inline uint32_t _add_hl(struct gb_machine *gb, uint16_t data_16)
+{
+    uint32_t result = (uint32_t)gb->cpu.HL + data_16;
+    set_flag_N(0);
+    set_flag_H(((gb->cpu.HL & 0xFFF) + (data_16 & 0xFFF)) > 0xFFF);
+    set_flag_C(result > 0xFFFF);
+    gb->cpu.HL = (uint16_t)result;
+    return 0;
+}
+
+// SP + r8 used by ADD SP, r8 and LD HL, SP + r8
+// flags come from the unsigned addition of the low byte
+static inline uint16_t _sp_offset(struct gb_machine *gb)
+{
+    uint8_t data_8 = _fetch_8(gb);
+    set_flags(0, 0, ((gb->cpu.SP & 0xF) + (data_8 & 0xF)) > 0xF, ((gb->cpu.SP & 0xFF) + data_8) > 0xFF);
+    return gb->cpu.SP + (int8_t)data_8;
+}
+
+/*
+ * Polling loops like "ldh a,(44h); cp 90h; jr nz" of the boot rom only
+ * read registers changed by scheduler events(LY, STAT, IF). Such a loop
+ * cannot see another value before the next deadline, so the whole
+ * iterations up to it are skipped.
+ * The loop must load A from one of those registers, then only set flags
+ * (CP d8, AND d8, AND A, OR A, BIT n,A) before jumping back. It has no
+ * stores and every iteration leaves the same registers.
+ * Return cycles of one iteration, 0 when the loop is not idle.
+ */
+#define IDLE_LOOP_MAX_LENGTH 16
+
+static uint32_t _idle_loop_cycles(struct gb_machine *gb, uint16_t head, uint16_t jr_address)
+{
+    uint16_t address = head;
+    uint16_t polled;
+    uint32_t cycles;
+    const uint8_t *host = gb->cpu.page_read[head >> 8];
+    uint16_t base = head & 0xFF00;
+    uint8_t command = _code_fetch(gb, host, base, address);
+
+    if (head >= jr_address || jr_address - head > IDLE_LOOP_MAX_LENGTH)
+        return 0;
+    switch (command) {
+    case 0xF0:  // LDH A, (a8)
+        polled = 0xFF00 | _code_fetch(gb, host, base, address + 1);
+        break;
+    case 0xF2:  // LD A, (C)
+        polled = 0xFF00 | get_C;
+        break;
+    case 0xFA:  // LD A, (a16)
+        polled = _code_fetch(gb, host, base, address + 1);
+        polled |= (uint16_t)_code_fetch(gb, host, base, address + 2) << 8;
+        break;
+    default:
+        return 0;
+    }
+    if (polled != 0xFF44 && polled != 0xFF41 && polled != 0xFF0F)
+        return 0;
+    cycles = cycles_table[command];
+    address += command == 0xF0 ? 2 : command == 0xF2 ? 1 : 3;
+
+    while (address < jr_address) {
+        command = _code_fetch(gb, host, base, address);
+        switch (command) {
+        case 0xA7:  // AND A
+        case 0xB7:  // OR A
+            address += 1;
+            break;
+        case 0xE6:  // AND d8
+        case 0xFE:  // CP d8
+            address += 2;
+            break;
+        case 0xCB:  // BIT n, A
+            if ((_code_fetch(gb, host, base, address + 1) & 0xC7) != 0x47)
+                return 0;
+            cycles += cycles_table_cb[0x47];
+            address += 2;
+            break;
+        default:
+            return 0;
+        }
+        cycles += cycles_table[command];
+    }
+    if (address != jr_address)
+        return 0;
+    // taken JR
+    return cycles + cycles_table[_code_fetch(gb, host, base, jr_address)] + 1;
+}
+
+// Return cycles of the idle iterations skipped before the next deadline.
+static uint32_t _idle_loop_skip(struct gb_machine *gb, uint16_t head, uint16_t jr_address, uint32_t cycles_pending)
+{
+    uint64_t clock = gb->scheduler.clock + cycles_pending;
+    uint32_t cycles;
+    // a pending interruption is taken before the next iteration
+    if (gb->cpu.interrupt_pending)
+        return 0;
+    if (gb->scheduler.deadline <= clock)
+        return 0;
+    cycles = _idle_loop_cycles(gb, head, jr_address);
+    // an event between the load and the jump makes the branch stale
+    if (cycles == 0 || clock - cycles < gb->cpu.run_begin)
+        return 0;
+    return (uint32_t)((gb->scheduler.deadline - clock) / cycles * cycles);
+}
+
+/*
+ * Fill and copy loops like "ld (hl-),a; bit 7,h; jr nz" of the boot rom or
+ * "ld a,(de); ld (hl+),a; inc de; dec bc; ld a,b; or c; jr nz" are run as
+ * memset and memcpy when their first iteration takes the JR back. The
+ * iterations that fit before the deadline are done at once but the last
+ * one, which is left to the interpreter so leaving the loop is as usual.
+ * The loop must be
+ *   [LD A,(DE) | LD A,d8 | XOR A]  LD (HL+),A | LD (HL-),A  [INC DE]
+ *   DEC B/C/D/E | DEC BC; LD A,B; OR C | BIT 7,H  JR NZ
+ * and both ranges must be in mapped pages, so I/O registers, OAM, pages
+ * holding code and the bus during OAM DMA are left to the interpreter.
+ */
+enum COPY_LOOP_COUNTER {
+    COPY_LOOP_DEC_R,
+    COPY_LOOP_DEC_BC,
+    COPY_LOOP_BIT_H,
+};
+
+struct copy_loop {
+    uint32_t copy;          // source is (DE), or fill with A
+    uint32_t reload;        // A is loaded with the fill value in the loop
+    uint8_t value;          // fill value loaded by LD A,d8 or XOR A
+    int32_t step;           // HL+ or HL-
+    enum COPY_LOOP_COUNTER counter;
+    uint8_t counter_index;  // register of DEC r, _reg_read index
+    uint32_t cycles;        // one iteration with JR taken
+};
+
+#define COPY_LOOP_MAX_LENGTH 8
+
+static uint32_t _copy_loop_match(struct gb_machine *gb, uint16_t head, uint16_t jr_address, struct copy_loop *loop)
+{
+    uint16_t address = head;
+    const uint8_t *host = gb->cpu.page_read[head >> 8];
+    uint16_t base = head & 0xFF00;
+    uint8_t command;
+
+    if (head >= jr_address || jr_address - head > COPY_LOOP_MAX_LENGTH)
+        return 0;
+    loop->copy = 0;
+    loop->reload = 0;
+    loop->value = 0;
+    loop->counter_index = 0;
+    loop->cycles = cycles_table[0x20] + 1;
+
+    command = _code_fetch(gb, host, base, address);
+    if (command == 0x1A || command == 0x3E || command == 0xAF) {
+        loop->copy = command == 0x1A;
+        loop->reload = !loop->copy;
+        if (command == 0x3E)
+            loop->value = _code_fetch(gb, host, base, address + 1);
+        loop->cycles += cycles_table[command];
+        address += length_table[command];
+        command = _code_fetch(gb, host, base, address);
+    }
+    if (command != 0x22 && command != 0x32)
+        return 0;
+    loop->step = command == 0x22 ? 1 : -1;
+    loop->cycles += cycles_table[command];
+    command = _code_fetch(gb, host, base, ++address);
+    if (loop->copy) {
+        // only ascending copies, the source moves up with INC DE
+        if (command != 0x13 || loop->step != 1)
+            return 0;
+        loop->cycles += cycles_table[command];
+        command = _code_fetch(gb, host, base, ++address);
+    }
+
+    switch (command) {
+    case 0x15: case 0x1D:   // DEC D, DEC E
+        if (loop->copy)
+            return 0;
+        // fall through
+    case 0x05: case 0x0D:   // DEC B, DEC C
+        loop->counter = COPY_LOOP_DEC_R;
+        loop->counter_index = command >> 3;
+        loop->cycles += cycles_table[command];
+        address += 1;
+        break;
+    case 0x0B:              // DEC BC; LD A,B; OR C
+        if (_code_fetch(gb, host, base, address + 1) != 0x78 || _code_fetch(gb, host, base, address + 2) != 0xB1)
+            return 0;
+        // A is overwritten, a fill has to load it again
+        if (!loop->copy && !loop->reload)
+            return 0;
+        loop->counter = COPY_LOOP_DEC_BC;
+        loop->cycles += cycles_table[0x0B] + cycles_table[0x78] + cycles_table[0xB1];
+        address += 3;
+        break;
+    case 0xCB:              // BIT 7,H
+        if (_code_fetch(gb, host, base, address + 1) != 0x7C || loop->step != -1)
+            return 0;
+        loop->counter = COPY_LOOP_BIT_H;
+        loop->cycles += cycles_table[0xCB] + cycles_table_cb[0x7C];
+        address += 2;
+        break;
+    default:
+        return 0;
+    }
+    return address == jr_address && _code_fetch(gb, host, base, jr_address) == 0x20;
+}
+
+// Host page the loop writes to, tile data is written directly
+// and the screen is told once after the loop.
+static inline uint8_t *_copy_loop_page_write(struct gb_machine *gb, uint32_t page)
+{
+    if (gb->cpu.page_write[page] || page < 0x80 || page >= (TILE_DATA_END >> 8) || gb->cpu.dma_active)
+        return gb->cpu.page_write[page];
+    return gb->cpu.internal_ram + RAM_OFFSET_VRAM + (page - 0x80) * 0x100;
+}
+
+// Every page of length bytes from address is mapped for reads,
+// or can be written by the loop when write is set.
+static inline uint32_t _copy_loop_mapped(struct gb_machine *gb, uint32_t write, uint16_t address, uint32_t length)
+{
+    uint32_t last = (uint32_t)address + length - 1;
+    if (last > 0xFFFF)
+        return 0;
+    for (uint32_t page = address >> 8; page <= last >> 8; ++page) {
+        if (!(write ? _copy_loop_page_write(gb, page) : gb->cpu.page_read[page]))
+            return 0;
+    }
+    return 1;
+}
+
+static void _copy_loop_fill(struct gb_machine *gb, uint16_t address, uint32_t length, uint8_t value)
+{
+    while (length) {
+        uint32_t chunk = 0x100 - (address & 0xFF);
+        if (chunk > length)
+            chunk = length;
+        memset(_copy_loop_page_write(gb, address >> 8) + (address & 0xFF), value, chunk);
+        address += (uint16_t)chunk;
+        length -= chunk;
+    }
+}
+
+static void _copy_loop_copy(struct gb_machine *gb, uint16_t to, uint16_t from, uint32_t length)
+{
+    while (length) {
+        uint32_t chunk = 0x100 - (to & 0xFF);
+        uint8_t *dst;
+        const uint8_t *src;
+        if (chunk > 0x100 - (uint32_t)(from & 0xFF))
+            chunk = 0x100 - (from & 0xFF);
+        if (chunk > length)
+            chunk = length;
+        dst = _copy_loop_page_write(gb, to >> 8) + (to & 0xFF);
+        src = gb->cpu.page_read[from >> 8] + (from & 0xFF);
+        if (src < dst && dst < src + chunk) {
+            // the loop reads bytes it has just written
+            for (uint32_t i = 0; i < chunk; ++i)
+                dst[i] = src[i];
+        } else {
+            memmove(dst, src, chunk);
+        }
+        to += (uint16_t)chunk;
+        from += (uint16_t)chunk;
+        length -= chunk;
+    }
+}
+
+// Return cycles of the iterations done at once.
+static uint32_t _copy_loop_skip(struct gb_machine *gb, uint16_t head, uint16_t jr_address, uint32_t cycles_pending)
+{
+    uint64_t clock = gb->scheduler.clock + cycles_pending;
+    struct copy_loop loop;
+    uint32_t remaining;
+    uint32_t count;
+    uint16_t to;
+
+    if (gb->cpu.interrupt_pending || gb->scheduler.deadline <= clock)
+        return 0;
+    if (!_copy_loop_match(gb, head, jr_address, &loop))
+        return 0;
+
+    // iterations left, the JR just taken says there is at least one
+    switch (loop.counter) {
+    case COPY_LOOP_DEC_R:
+        remaining = _reg_read(gb, loop.counter_index);
+        break;
+    case COPY_LOOP_DEC_BC:
+        remaining = gb->cpu.BC;
+        break;
+    default:
+        remaining = gb->cpu.HL - 0x7FFF;
+        break;
+    }
+    count = remaining - 1;
+    if ((gb->scheduler.deadline - clock) / loop.cycles < count)
+        count = (uint32_t)((gb->scheduler.deadline - clock) / loop.cycles);
+    if (count == 0)
+        return 0;
+
+    to = loop.step == 1 ? gb->cpu.HL : gb->cpu.HL - (uint16_t)(count - 1);
+    if ((uint32_t)gb->cpu.HL + loop.step * (int32_t)(count - 1) > 0xFFFF
+        || !_copy_loop_mapped(gb, 1, to, count)
+        || (loop.copy && !_copy_loop_mapped(gb, 0, gb->cpu.DE, count)))
+        return 0;
+
+    if (loop.copy) {
+        _copy_loop_copy(gb, to, gb->cpu.DE, count);
+        gb->cpu.DE += (uint16_t)count;
+        set_A(_copy_loop_page_write(gb, (uint16_t)(to + count - 1) >> 8)[(to + count - 1) & 0xFF]);
+    } else {
+        // A of a reloading loop is the counter by now with DEC BC
+        _copy_loop_fill(gb, to, count, loop.reload ? loop.value : get_A);
+    }
+    my_gb_screen_tile_written(gb, to, count);
+    gb->cpu.HL += (uint16_t)(loop.step * (int32_t)count);
+
+    // run the counter of the last iteration done, for its flags
+    switch (loop.counter) {
+    case COPY_LOOP_DEC_R:
+        _reg_write(gb, loop.counter_index, (uint8_t)(remaining - count + 1));
+        _dec_r(gb, loop.counter_index);
+        break;
+    case COPY_LOOP_DEC_BC:
+        gb->cpu.BC -= (uint16_t)count;
+        set_A(get_B);
+        _alu(gb, 6, get_C);
+        break;
+    default:
+        // H keeps bit 7 set, BIT leaves the same flags
+        break;
+    }
+    return count * loop.cycles;
+}
+
+static inline uint32_t _jr(struct gb_machine *gb, uint8_t condition)
+{
+    int8_t offset = (int8_t)_fetch_8(gb);
+    if (!condition)
+        return 0;
+    gb->cpu.PC += offset;
+    if (offset < 0) {
+        uint16_t jr_address = gb->cpu.PC - offset - 2;
+        uint32_t cycles = _idle_loop_skip(gb, gb->cpu.PC, jr_address, 1);
+        if (cycles == 0)
+            cycles = _copy_loop_skip(gb, gb->cpu.PC, jr_address, 1);
+        return 1 + cycles;
+    }
+    return 1;
+}
+
+static inline uint32_t _jp(struct gb_machine *gb, uint8_t condition)
+{
+    uint16_t data_16 = _fetch_16(gb);
+    if (!condition)
+        return 0;
+    gb->cpu.PC = data_16;
+    return 1;
+}
+
+static inline uint32_t _call(struct gb_machine *gb, uint8_t condition)
+{
+    uint16_t data_16 = _fetch_16(gb);
+    if (!condition)
+        return 0;
+    _push_16(gb, gb->cpu.PC);
+    gb->cpu.PC = data_16;
+    return 3;
+}
+
+static inline uint32_t _ret(struct gb_machine *gb, uint8_t condition)
+{
+    if (!condition)
+        return 0;
+    gb->cpu.PC = _pop_16(gb);
+    return 3;
+}
+
+static inline uint32_t _rst(struct gb_machine *gb, uint16_t address)
+{
+    _push_16(gb, gb->cpu.PC);
+    gb->cpu.PC = address;
+    return 0;
+}
+
+/*
+ * Prefix CB instructions.
+ * Bit 6-7 of opcode select rotate/shift group, BIT, RES or SET,
+ * bit 3-5 select the rotate/shift operation or the bit number,
+ * bit 0-2 select the operand.
+ */
+static inline uint32_t _cb(struct gb_machine *gb, uint8_t op)
+{
+    uint8_t index = op & 0x7;
+    uint8_t bit = (op >> 3) & 0x7;
+    uint8_t data_8 = _reg_read(gb, index);
+    uint8_t carry;
+
+    switch (op >> 6) {
+    case 0:
+        switch (bit) {
+        case 0:		// RLC
+            carry = data_8 >> 7;
+            data_8 = (data_8 << 1) | carry;
+            break;
+        case 1:		// RRC
+            carry = data_8 & 0x1;
+            data_8 = (data_8 >> 1) | (carry << 7);
+            break;
+        case 2:		// RL
+            carry = data_8 >> 7;
+            data_8 = (data_8 << 1) | get_flag_C;
+            break;
+        case 3:		// RR
+            carry = data_8 & 0x1;
+            data_8 = (data_8 >> 1) | (get_flag_C << 7);
+            break;
+        case 4:		// SLA
+            carry = data_8 >> 7;
+            data_8 <<= 1;
+            break;
+        case 5:		// SRA
+            carry = data_8 & 0x1;
+            data_8 = (data_8 >> 1) | (data_8 & 0x80);
+            break;
+        case 6:		// SWAP
+            carry = 0;
+            data_8 = (data_8 << 4) | (data_8 >> 4);
+            break;
+        default:	// SRL
+            carry = data_8 & 0x1;
+            data_8 >>= 1;
+            break;
+        }
+        set_flags(!data_8, 0, 0, carry);
+        _reg_write(gb, index, data_8);
+        break;
+    case 1:		// BIT
+        set_flag_Z(!((data_8 >> bit) & 0x1));
+        set_flag_N(0);
+        set_flag_H(1);
+        break;
+    case 2:		// RES
+        _reg_write(gb, index, data_8 & ~(0x1 << bit));
+        break;
+    default:	// SET
+        _reg_write(gb, index, data_8 | (0x1 << bit));
+        break;
+    }
+    return 0;
+}
+
+static uint32_t _illegal(struct gb_machine *gb)
+{
+    fprintf(stderr, "Encounter illegal instruction.\n");
+    return 0;
+}
+
+/*
+ * Handlers of every opcode.
+ * Each returns the cycles it takes beyond cycles_table,
+ * which is only non-zero for taken conditional branches.
+ */
+/*
+ * Every source of interruption(screen, timer, serial, joypad) is either
+ * a scheduler event or happens between runs, so nothing can wake a
+ * sleeping cpu before the deadline. Skip the clock straight to it,
+ * the returned cycles are added by the dispatch loop which then stops.
+ */
+static inline uint32_t _cpu_sleep(struct gb_machine *gb)
+{
+    if (gb->scheduler.deadline <= gb->scheduler.clock)
+        return 0;
+    return (uint32_t)(gb->scheduler.deadline - gb->scheduler.clock);
+}
+
+// Return 1 when the cpu is awake.
+// HALT ends on an enabled interruption even if IME is reset.
+static inline uint32_t _cpu_wake(struct gb_machine *gb)
+{
+    if (gb->cpu.is_stopped) {
+        if (!(gb->cpu.IF & INT_BUTTON_PRESS_MASK))
+            return 0;
+        gb->cpu.is_stopped = 0;
+    }
+    if (gb->cpu.is_halted) {
+        if (!(gb->cpu.IE & gb->cpu.IF))
+            return 0;
+        gb->cpu.is_halted = 0;
+    }
+    return 1;
+}
+
+static inline uint32_t _op_00(struct gb_machine *gb)		// NOP
+{
+    return 0;
+}
+
+static inline uint32_t _op_01(struct gb_machine *gb)		// LD BC, d16
+{
+    gb->cpu.BC = _fetch_16(gb);
+    return 0;
+}
+
+static inline uint32_t _op_02(struct gb_machine *gb)		// LD (BC), A
+{
+    _address_write(gb, gb->cpu.BC, get_A);
+    return 0;
+}
+
+static inline uint32_t _op_03(struct gb_machine *gb)		// INC BC
+{
+    ++gb->cpu.BC;
+    return 0;
+}
+
+static inline uint32_t _op_04(struct gb_machine *gb)		// INC B
+{
+    return _inc_r(gb, 0);
+}
+
+static inline uint32_t _op_05(struct gb_machine *gb)		// DEC B
+{
+    return _dec_r(gb, 0);
+}
+
+static inline uint32_t _op_06(struct gb_machine *gb)		// LD B, d8
+{
+    set_B(_fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_07(struct gb_machine *gb)		// RLCA
+{
+    uint8_t data_8 = get_A >> 7;
+    set_A((get_A << 1) | data_8);
+    set_flags(0, 0, 0, data_8);
+    return 0;
+}
+
+static inline uint32_t _op_08(struct gb_machine *gb)		// LD (a16), SP
+{
+    _address_write_16(gb, _fetch_16(gb), gb->cpu.SP);
+    return 0;
+}
+
+static inline uint32_t _op_09(struct gb_machine *gb)		// ADD HL, BC
+{
+    return _add_hl(gb, gb->cpu.BC);
+}
+
+static inline uint32_t _op_0A(struct gb_machine *gb)		// LD A, (BC)
+{
+    set_A(_address_read(gb, gb->cpu.BC));
+    return 0;
+}
+
+static inline uint32_t _op_0B(struct gb_machine *gb)		// DEC BC
+{
+    --gb->cpu.BC;
+    return 0;
+}
+
+static inline uint32_t _op_0C(struct gb_machine *gb)		// INC C
+{
+    return _inc_r(gb, 1);
+}
+
+static inline uint32_t _op_0D(struct gb_machine *gb)		// DEC C
+{
+    return _dec_r(gb, 1);
+}
+
+static inline uint32_t _op_0E(struct gb_machine *gb)		// LD C, d8
+{
+    set_C(_fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_0F(struct gb_machine *gb)		// RRCA
+{
+    uint8_t data_8 = get_A & 0x1;
+    set_A((get_A >> 1) | (data_8 << 7));
+    set_flags(0, 0, 0, data_8);
+    return 0;
+}
+
+static inline uint32_t _op_10(struct gb_machine *gb)		// STOP 0
+{
+    uint8_t data_8 = _fetch_8(gb);
+    MY_GB_TRACE(TRACE_STOP, gb->cpu.PC - 2, data_8);
+    gb->cpu.is_stopped = 1;
+    return _cpu_sleep(gb);
+}
+
+static inline uint32_t _op_11(struct gb_machine *gb)		// LD DE, d16
+{
+    gb->cpu.DE = _fetch_16(gb);
+    return 0;
+}
+
+static inline uint32_t _op_12(struct gb_machine *gb)		// LD (DE), A
+{
+    _address_write(gb, gb->cpu.DE, get_A);
+    return 0;
+}
+
+static inline uint32_t _op_13(struct gb_machine *gb)		// INC DE
+{
+    ++gb->cpu.DE;
+    return 0;
+}
+
+static inline uint32_t _op_14(struct gb_machine *gb)		// INC D
+{
+    return _inc_r(gb, 2);
+}
+
+static inline uint32_t _op_15(struct gb_machine *gb)		// DEC D
+{
+    return _dec_r(gb, 2);
+}
+
+static inline uint32_t _op_16(struct gb_machine *gb)		// LD D, d8
+{
+    set_D(_fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_17(struct gb_machine *gb)		// RLA
+{
+    uint8_t data_8 = get_A >> 7;
+    set_A((get_A << 1) | get_flag_C);
+    set_flags(0, 0, 0, data_8);
+    return 0;
+}
+
+static inline uint32_t _op_18(struct gb_machine *gb)		// JR r8
+{
+    return _jr(gb, 1);
+}
+
+static inline uint32_t _op_19(struct gb_machine *gb)		// ADD HL, DE
+{
+    return _add_hl(gb, gb->cpu.DE);
+}
+
+static inline uint32_t _op_1A(struct gb_machine *gb)		// LD A, (DE)
+{
+    set_A(_address_read(gb, gb->cpu.DE));
+    return 0;
+}
+
+static inline uint32_t _op_1B(struct gb_machine *gb)		// DEC DE
+{
+    --gb->cpu.DE;
+    return 0;
+}
+
+static inline uint32_t _op_1C(struct gb_machine *gb)		// INC E
+{
+    return _inc_r(gb, 3);
+}
+
+static inline uint32_t _op_1D(struct gb_machine *gb)		// DEC E
+{
+    return _dec_r(gb, 3);
+}
+
+static inline uint32_t _op_1E(struct gb_machine *gb)		// LD E, d8
+{
+    set_E(_fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_1F(struct gb_machine *gb)		// RRA
+{
+    uint8_t data_8 = get_A & 0x1;
+    set_A((get_A >> 1) | (get_flag_C << 7));
+    set_flags(0, 0, 0, data_8);
+    return 0;
+}
+
+static inline uint32_t _op_20(struct gb_machine *gb)		// JR NZ, r8
+{
+    return _jr(gb, _condition(gb, 0));
+}
+
+static inline uint32_t _op_21(struct gb_machine *gb)		// LD HL, d16
+{
+    gb->cpu.HL = _fetch_16(gb);
+    return 0;
+}
+
+static inline uint32_t _op_22(struct gb_machine *gb)		// LD (HL+), A
+{
+    _address_write(gb, gb->cpu.HL, get_A);
+    ++gb->cpu.HL;
+    return 0;
+}
+
+static inline uint32_t _op_23(struct gb_machine *gb)		// INC HL
+{
+    ++gb->cpu.HL;
+    return 0;
+}
+
+static inline uint32_t _op_24(struct gb_machine *gb)		// INC H
+{
+    return _inc_r(gb, 4);
+}
+
+static inline uint32_t _op_25(struct gb_machine *gb)		// DEC H
+{
+    return _dec_r(gb, 4);
+}
+
+static inline uint32_t _op_26(struct gb_machine *gb)		// LD H, d8
+{
+    set_H(_fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_27(struct gb_machine *gb)		// DAA
+{
+    set_AF(daa_table[get_A | get_flag_N << 8 | get_flag_H << 9 | get_flag_C << 10]);
+    return 0;
+}
+
+static inline uint32_t _op_28(struct gb_machine *gb)		// JR Z, r8
+{
+    return _jr(gb, _condition(gb, 1));
+}
+
+static inline uint32_t _op_29(struct gb_machine *gb)		// ADD HL, HL
+{
+    return _add_hl(gb, gb->cpu.HL);
+}
+
+static inline uint32_t _op_2A(struct gb_machine *gb)		// LD A, (HL+)
+{
+    set_A(_address_read(gb, gb->cpu.HL));
+    ++gb->cpu.HL;
+    return 0;
+}
+
+static inline uint32_t _op_2B(struct gb_machine *gb)		// DEC HL
+{
+    --gb->cpu.HL;
+    return 0;
+}
+
+static inline uint32_t _op_2C(struct gb_machine *gb)		// INC L
+{
+    return _inc_r(gb, 5);
+}
+
+static inline uint32_t _op_2D(struct gb_machine *gb)		// DEC L
+{
+    return _dec_r(gb, 5);
+}
+
+static inline uint32_t _op_2E(struct gb_machine *gb)		// LD L, d8
+{
+    set_L(_fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_2F(struct gb_machine *gb)		// CPL
+{
+    set_A(~get_A);
+    set_flag_N(1);
+    set_flag_H(1);
+    return 0;
+}
+
+static inline uint32_t _op_30(struct gb_machine *gb)		// JR NC, r8
+{
+    return _jr(gb, _condition(gb, 2));
+}
+
+static inline uint32_t _op_31(struct gb_machine *gb)		// LD SP, d16
+{
+    gb->cpu.SP = _fetch_16(gb);
+    return 0;
+}
+
+static inline uint32_t _op_32(struct gb_machine *gb)		// LD (HL-), A
+{
+    _address_write(gb, gb->cpu.HL, get_A);
+    --gb->cpu.HL;
+    return 0;
+}
+
+static inline uint32_t _op_33(struct gb_machine *gb)		// INC SP
+{
+    ++gb->cpu.SP;
+    return 0;
+}
+
+static inline uint32_t _op_34(struct gb_machine *gb)		// INC (HL)
+{
+    return _inc_r(gb, 6);
+}
+
+static inline uint32_t _op_35(struct gb_machine *gb)		// DEC (HL)
+{
+    return _dec_r(gb, 6);
+}
+
+static inline uint32_t _op_36(struct gb_machine *gb)		// LD (HL), d8
+{
+    _address_write(gb, gb->cpu.HL, _fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_37(struct gb_machine *gb)		// SCF
+{
+    set_flag_N(0);
+    set_flag_H(0);
+    set_flag_C(1);
+    return 0;
+}
+
+static inline uint32_t _op_38(struct gb_machine *gb)		// JR C, r8
+{
+    return _jr(gb, _condition(gb, 3));
+}
+
+static inline uint32_t _op_39(struct gb_machine *gb)		// ADD HL, SP
+{
+    return _add_hl(gb, gb->cpu.SP);
+}
+
+static inline uint32_t _op_3A(struct gb_machine *gb)		// LD A, (HL-)
+{
+    set_A(_address_read(gb, gb->cpu.HL));
+    --gb->cpu.HL;
+    return 0;
+}
+
+static inline uint32_t _op_3B(struct gb_machine *gb)		// DEC SP
+{
+    --gb->cpu.SP;
+    return 0;
+}
+
+static inline uint32_t _op_3C(struct gb_machine *gb)		// INC A
+{
+    return _inc_r(gb, 7);
+}
+
+static inline uint32_t _op_3D(struct gb_machine *gb)		// DEC A
+{
+    return _dec_r(gb, 7);
+}
+
+static inline uint32_t _op_3E(struct gb_machine *gb)		// LD A, d8
+{
+    set_A(_fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_3F(struct gb_machine *gb)		// CCF
+{
+    set_flag_N(0);
+    set_flag_H(0);
+    set_flag_C(!get_flag_C);
+    return 0;
+}
+
+// 0x40 - 0x7F LD r, r' (except 0x76 HALT)
+#define OP_LD_R_R(n) \
+static inline uint32_t _op_##n(struct gb_machine *gb) \
+{ \
+    _reg_write(gb, (0x##n >> 3) & 0x7, _reg_read(gb, 0x##n & 0x7)); \
+    return 0; \
+}
+OP_LD_R_R(40) OP_LD_R_R(41) OP_LD_R_R(42) OP_LD_R_R(43) OP_LD_R_R(44) OP_LD_R_R(45) OP_LD_R_R(46) OP_LD_R_R(47)
+OP_LD_R_R(48) OP_LD_R_R(49) OP_LD_R_R(4A) OP_LD_R_R(4B) OP_LD_R_R(4C) OP_LD_R_R(4D) OP_LD_R_R(4E) OP_LD_R_R(4F)
+OP_LD_R_R(50) OP_LD_R_R(51) OP_LD_R_R(52) OP_LD_R_R(53) OP_LD_R_R(54) OP_LD_R_R(55) OP_LD_R_R(56) OP_LD_R_R(57)
+OP_LD_R_R(58) OP_LD_R_R(59) OP_LD_R_R(5A) OP_LD_R_R(5B) OP_LD_R_R(5C) OP_LD_R_R(5D) OP_LD_R_R(5E) OP_LD_R_R(5F)
+OP_LD_R_R(60) OP_LD_R_R(61) OP_LD_R_R(62) OP_LD_R_R(63) OP_LD_R_R(64) OP_LD_R_R(65) OP_LD_R_R(66) OP_LD_R_R(67)
+OP_LD_R_R(68) OP_LD_R_R(69) OP_LD_R_R(6A) OP_LD_R_R(6B) OP_LD_R_R(6C) OP_LD_R_R(6D) OP_LD_R_R(6E) OP_LD_R_R(6F)
+OP_LD_R_R(70) OP_LD_R_R(71) OP_LD_R_R(72) OP_LD_R_R(73) OP_LD_R_R(74) OP_LD_R_R(75)              OP_LD_R_R(77)
+OP_LD_R_R(78) OP_LD_R_R(79) OP_LD_R_R(7A) OP_LD_R_R(7B) OP_LD_R_R(7C) OP_LD_R_R(7D) OP_LD_R_R(7E) OP_LD_R_R(7F)
+#undef OP_LD_R_R
+
+static inline uint32_t _op_76(struct gb_machine *gb)		// HALT
+{
+    MY_GB_TRACE(TRACE_HALT, gb->cpu.PC - 1, 0x76);
+    // an enabled interruption already pending ends HALT at once
+    if (gb->cpu.IE & gb->cpu.IF)
+        return 0;
+    gb->cpu.is_halted = 1;
+    return _cpu_sleep(gb);
+}
+
+// 0x80 - 0xBF ADD ADC SUB SBC AND XOR OR CP with register operand
+#define OP_ALU_R(n) \
+static inline uint32_t _op_##n(struct gb_machine *gb) \
+{ \
+    _alu(gb, (0x##n >> 3) & 0x7, _reg_read(gb, 0x##n & 0x7)); \
+    return 0; \
+}
+OP_ALU_R(80) OP_ALU_R(81) OP_ALU_R(82) OP_ALU_R(83) OP_ALU_R(84) OP_ALU_R(85) OP_ALU_R(86) OP_ALU_R(87)
+OP_ALU_R(88) OP_ALU_R(89) OP_ALU_R(8A) OP_ALU_R(8B) OP_ALU_R(8C) OP_ALU_R(8D) OP_ALU_R(8E) OP_ALU_R(8F)
+OP_ALU_R(90) OP_ALU_R(91) OP_ALU_R(92) OP_ALU_R(93) OP_ALU_R(94) OP_ALU_R(95) OP_ALU_R(96) OP_ALU_R(97)
+OP_ALU_R(98) OP_ALU_R(99) OP_ALU_R(9A) OP_ALU_R(9B) OP_ALU_R(9C) OP_ALU_R(9D) OP_ALU_R(9E) OP_ALU_R(9F)
+OP_ALU_R(A0) OP_ALU_R(A1) OP_ALU_R(A2) OP_ALU_R(A3) OP_ALU_R(A4) OP_ALU_R(A5) OP_ALU_R(A6) OP_ALU_R(A7)
+OP_ALU_R(A8) OP_ALU_R(A9) OP_ALU_R(AA) OP_ALU_R(AB) OP_ALU_R(AC) OP_ALU_R(AD) OP_ALU_R(AE) OP_ALU_R(AF)
+OP_ALU_R(B0) OP_ALU_R(B1) OP_ALU_R(B2) OP_ALU_R(B3) OP_ALU_R(B4) OP_ALU_R(B5) OP_ALU_R(B6) OP_ALU_R(B7)
+OP_ALU_R(B8) OP_ALU_R(B9) OP_ALU_R(BA) OP_ALU_R(BB) OP_ALU_R(BC) OP_ALU_R(BD) OP_ALU_R(BE) OP_ALU_R(BF)
+#undef OP_ALU_R
+
+static inline uint32_t _op_C0(struct gb_machine *gb)		// RET NZ
+{
+    return _ret(gb, _condition(gb, 0));
+}
+
+static inline uint32_t _op_C1(struct gb_machine *gb)		// POP BC
+{
+    gb->cpu.BC = _pop_16(gb);
+    return 0;
+}
+
+static inline uint32_t _op_C2(struct gb_machine *gb)		// JP NZ, a16
+{
+    return _jp(gb, _condition(gb, 0));
+}
+
+static inline uint32_t _op_C3(struct gb_machine *gb)		// JP a16
+{
+    gb->cpu.PC = _fetch_16(gb);
+    return 0;
+}
+
+static inline uint32_t _op_C4(struct gb_machine *gb)		// CALL NZ, a16
+{
+    return _call(gb, _condition(gb, 0));
+}
+
+static inline uint32_t _op_C5(struct gb_machine *gb)		// PUSH BC
+{
+    _push_16(gb, gb->cpu.BC);
+    return 0;
+}
+
+static inline uint32_t _op_C6(struct gb_machine *gb)		// ADD A, d8
+{
+    _alu(gb, 0, _fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_C7(struct gb_machine *gb)		// RST 00H
+{
+    return _rst(gb, 0x00);
+}
+
+static inline uint32_t _op_C8(struct gb_machine *gb)		// RET Z
+{
+    return _ret(gb, _condition(gb, 1));
+}
+
+static inline uint32_t _op_C9(struct gb_machine *gb)		// RET
+{
+    gb->cpu.PC = _pop_16(gb);
+    return 0;
+}
+
+static inline uint32_t _op_CA(struct gb_machine *gb)		// JP Z, a16
+{
+    return _jp(gb, _condition(gb, 1));
+}
+
+// 0xCB is dispatched through the prefix CB table, see below
+
+static inline uint32_t _op_CC(struct gb_machine *gb)		// CALL Z, a16
+{
+    return _call(gb, _condition(gb, 1));
+}
+
+static inline uint32_t _op_CD(struct gb_machine *gb)		// CALL a16
+{
+    _call(gb, 1);
+    return 0;
+}
+
+static inline uint32_t _op_CE(struct gb_machine *gb)		// ADC A, d8
+{
+    _alu(gb, 1, _fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_CF(struct gb_machine *gb)		// RST 08H
+{
+    return _rst(gb, 0x08);
+}
+
+static inline uint32_t _op_D0(struct gb_machine *gb)		// RET NC
+{
+    return _ret(gb, _condition(gb, 2));
+}
+
+static inline uint32_t _op_D1(struct gb_machine *gb)		// POP DE
+{
+    gb->cpu.DE = _pop_16(gb);
+    return 0;
+}
+
+static inline uint32_t _op_D2(struct gb_machine *gb)		// JP NC, a16
+{
+    return _jp(gb, _condition(gb, 2));
+}
+
+static inline uint32_t _op_D4(struct gb_machine *gb)		// CALL NC, a16
+{
+    return _call(gb, _condition(gb, 2));
+}
+
+static inline uint32_t _op_D5(struct gb_machine *gb)		// PUSH DE
+{
+    _push_16(gb, gb->cpu.DE);
+    return 0;
+}
+
+static inline uint32_t _op_D6(struct gb_machine *gb)		// SUB d8
+{
+    _alu(gb, 2, _fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_D7(struct gb_machine *gb)		// RST 10H
+{
+    return _rst(gb, 0x10);
+}
+
+static inline uint32_t _op_D8(struct gb_machine *gb)		// RET C
+{
+    return _ret(gb, _condition(gb, 3));
+}
+
+static inline uint32_t _op_D9(struct gb_machine *gb)		// RETI
+{
+    gb->cpu.PC = _pop_16(gb);
+    gb->cpu.IME = 1;
+    _interrupt_update(gb);
+    return 0;
+}
+
+static inline uint32_t _op_DA(struct gb_machine *gb)		// JP C, a16
+{
+    return _jp(gb, _condition(gb, 3));
+}
+
+static inline uint32_t _op_DC(struct gb_machine *gb)		// CALL C, a16
+{
+    return _call(gb, _condition(gb, 3));
+}
+
+static inline uint32_t _op_DE(struct gb_machine *gb)		// SBC A, d8
+{
+    _alu(gb, 3, _fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_DF(struct gb_machine *gb)		// RST 18H
+{
+    return _rst(gb, 0x18);
+}
+
+static inline uint32_t _op_E0(struct gb_machine *gb)		// LDH (a8), A
+{
+    _address_write(gb, 0xFF00 | _fetch_8(gb), get_A);
+    return 0;
+}
+
+static inline uint32_t _op_E1(struct gb_machine *gb)		// POP HL
+{
+    gb->cpu.HL = _pop_16(gb);
+    return 0;
+}
+
+static inline uint32_t _op_E2(struct gb_machine *gb)		// LD (C), A
+{
+    _address_write(gb, 0xFF00 | get_C, get_A);
+    return 0;
+}
+
+static inline uint32_t _op_E5(struct gb_machine *gb)		// PUSH HL
+{
+    _push_16(gb, gb->cpu.HL);
+    return 0;
+}
+
+static inline uint32_t _op_E6(struct gb_machine *gb)		// AND d8
+{
+    _alu(gb, 4, _fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_E7(struct gb_machine *gb)		// RST 20H
+{
+    return _rst(gb, 0x20);
+}
+
+static inline uint32_t _op_E8(struct gb_machine *gb)		// ADD SP, r8
+{
+    gb->cpu.SP = _sp_offset(gb);
+    return 0;
+}
+
+static inline uint32_t _op_E9(struct gb_machine *gb)		// JP (HL)
+{
+    gb->cpu.PC = gb->cpu.HL;
+    return 0;
+}
+
+static inline uint32_t _op_EA(struct gb_machine *gb)		// LD (a16), A
+{
+    _address_write(gb, _fetch_16(gb), get_A);
+    return 0;
+}
+
+static inline uint32_t _op_EE(struct gb_machine *gb)		// XOR d8
+{
+    _alu(gb, 5, _fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_EF(struct gb_machine *gb)		// RST 28H
+{
+    return _rst(gb, 0x28);
+}
+
+static inline uint32_t _op_F0(struct gb_machine *gb)		// LDH A, (a8)
+{
+    set_A(_address_read(gb, 0xFF00 | _fetch_8(gb)));
+    return 0;
+}
+
+static inline uint32_t _op_F1(struct gb_machine *gb)		// POP AF
+{
+    set_AF(_pop_16(gb) & 0xFFF0);
+    return 0;
+}
+
+static inline uint32_t _op_F2(struct gb_machine *gb)		// LD A, (C)
+{
+    set_A(_address_read(gb, 0xFF00 | get_C));
+    return 0;
+}
+
+static inline uint32_t _op_F3(struct gb_machine *gb)		// DI
+{
+    gb->cpu.IME = 0;
+    gb->cpu.interrupt_pending = 0;
+    return 0;
+}
+
+static inline uint32_t _op_F5(struct gb_machine *gb)		// PUSH AF
+{
+    _push_16(gb, get_AF);
+    return 0;
+}
+
+static inline uint32_t _op_F6(struct gb_machine *gb)		// OR d8
+{
+    _alu(gb, 6, _fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_F7(struct gb_machine *gb)		// RST 30H
+{
+    return _rst(gb, 0x30);
+}
+
+static inline uint32_t _op_F8(struct gb_machine *gb)		// LD HL, SP + r8
+{
+    gb->cpu.HL = _sp_offset(gb);
+    return 0;
+}
+
+static inline uint32_t _op_F9(struct gb_machine *gb)		// LD SP, HL
+{
+    gb->cpu.SP = gb->cpu.HL;
+    return 0;
+}
+
+static inline uint32_t _op_FA(struct gb_machine *gb)		// LD A, (a16)
+{
+    set_A(_address_read(gb, _fetch_16(gb)));
+    return 0;
+}
+
+static inline uint32_t _op_FB(struct gb_machine *gb)		// EI
+{
+    gb->cpu.IME = 1;
+    _interrupt_update(gb);
+    return 0;
+}
+
+static inline uint32_t _op_FE(struct gb_machine *gb)		// CP d8
+{
+    _alu(gb, 7, _fetch_8(gb));
+    return 0;
+}
+
+static inline uint32_t _op_FF(struct gb_machine *gb)		// RST 38H
+{
+    return _rst(gb, 0x38);
+}
+
+// opcodes not used by the SM83
+#define OP_ILLEGAL(n) \
+static inline uint32_t _op_##n(struct gb_machine *gb) \
+{ \
+    return _illegal(gb); \
+}
+OP_ILLEGAL(D3) OP_ILLEGAL(DB) OP_ILLEGAL(DD) OP_ILLEGAL(E3) OP_ILLEGAL(E4) OP_ILLEGAL(EB)
+OP_ILLEGAL(EC) OP_ILLEGAL(ED) OP_ILLEGAL(F4) OP_ILLEGAL(FC) OP_ILLEGAL(FD)
+#undef OP_ILLEGAL
+
+/*
+ * X-macro enumerating every opcode as a two digit hex token,
+ * used to build the dispatch tables without writing 256 entries by hand.
+ */
+#define OPCODE_ROW(X, h) \
+    X(h##0) X(h##1) X(h##2) X(h##3) X(h##4) X(h##5) X(h##6) X(h##7) \
+    X(h##8) X(h##9) X(h##A) X(h##B) X(h##C) X(h##D) X(h##E) X(h##F)
+#define OPCODE_LIST(X) \
+    OPCODE_ROW(X, 0) OPCODE_ROW(X, 1) OPCODE_ROW(X, 2) OPCODE_ROW(X, 3) \
+    OPCODE_ROW(X, 4) OPCODE_ROW(X, 5) OPCODE_ROW(X, 6) OPCODE_ROW(X, 7) \
+    OPCODE_ROW(X, 8) OPCODE_ROW(X, 9) OPCODE_ROW(X, A) OPCODE_ROW(X, B) \
+    OPCODE_ROW(X, C) OPCODE_ROW(X, D) OPCODE_ROW(X, E) OPCODE_ROW(X, F)
+
+// prefix CB handlers, _cb() is folded for each constant opcode
+#define OP_CB(n) \
+static uint32_t _op_cb_##n(struct gb_machine *gb) \
+{ \
+    return _cb(gb, 0x##n); \
+}
+OPCODE_LIST(OP_CB)
+#undef OP_CB
+
+#define OP_CB_ENTRY(n) _op_cb_##n,
+static uint32_t (*const cb_table[0x100])(struct gb_machine *gb) = {
+    OPCODE_LIST(OP_CB_ENTRY)
+};
+#undef OP_CB_ENTRY
+
+static inline uint32_t _op_CB(struct gb_machine *gb)		// PREFIX CB
+{
+    // cycles_table_cb is summed at decode
+    uint8_t command = _fetch_8(gb);
+    return cb_table[command](gb);
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include<intrin.h>
+#endif
+
+// Index of the lowest set bit, bits must not be 0.
+static inline uint32_t _lowest_bit(uint32_t bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t)__builtin_ctz(bits);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return (uint32_t)index;
+#else
+    uint32_t index = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+// Called between blocks when interrupt_pending is set.
+static uint32_t _cpu_interruption(struct gb_machine *gb)
+{
+    /*
+     * 1. Take the pending interruption with the lowest bit, which has
+     *    the highest priority, and acknowledge only that bit of IF
+     * 2. Reset IME to disable all interruptions
+     * 3. Push current PC to the stack
+     * 4. Jump to address corresponding to current interruption type
+     */
+    uint32_t bit = _lowest_bit(gb->cpu.IE & gb->cpu.IF & INT_MASK);
+
+    gb->cpu.IF &= ~(1u << bit);
+    gb->cpu.IME = 0;
+    gb->cpu.interrupt_pending = 0;
+
+    // push PC to the stack
+    gb->cpu.SP -= 2;
+    _address_write_16(gb, gb->cpu.SP, gb->cpu.PC);
+
+    // vectors are 8 bytes apart from INT_VBLANK_ADDRESS
+    gb->cpu.PC = INT_VBLANK_ADDRESS + bit * 8;
+    MY_GB_TRACE(TRACE_INTERRUPTION, gb->cpu.PC, 1u << bit);
+    return INT_DISPATCH_CYCLES;
+}
+
+#ifdef MY_GB_TRACE_ENABLED
+// report the milestones of the boot rom
+static void _trace_boot(struct gb_machine *gb, uint16_t pc, uint8_t command)
+{
+    switch (pc) {
+    case 0x34:
+        MY_GB_TRACE(TRACE_BOOT_LOGO_HALF_LOADED, pc, command);
+        break;
+    case 0x40:
+        MY_GB_TRACE(TRACE_BOOT_LOGO_LOADED, pc, command);
+        break;
+    case 0x80:
+        MY_GB_TRACE(TRACE_BOOT_INIT_SOUND, pc, command);
+        break;
+    case 0xF1:
+        MY_GB_TRACE(TRACE_BOOT_LOGO_VALID, pc, command);
+        break;
+    }
+}
+#endif
+
+// The fetch is expanded in every handler of the dispatch loop,
+// compilers stop inlining it there because the run function is huge.
+#if defined(__GNUC__) || defined(__clang__)
+#define MY_GB_ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define MY_GB_ALWAYS_INLINE __forceinline
+#else
+#define MY_GB_ALWAYS_INLINE inline
+#endif
+
+// Take the next op of the current block, _block_enter made sure there is one.
+static MY_GB_ALWAYS_INLINE const struct gb_micro_op *_cpu_fetch(struct gb_machine *gb)
+{
+    const struct gb_micro_op *op = gb->cpu.op_next++;
+#ifdef MY_GB_TRACE_ENABLED
+    if (!gb->cpu.BOOT)
+        _trace_boot(gb, gb->cpu.PC, op->opcode);
+#endif
+    gb->cpu.PC += op->length;
+    gb->cpu.operand = op->operand;
+    return op;
+}
+
+/*
+ * Dispatch engine, chosen at build time.
+ * GCC and Clang get a direct threaded interpreter using computed goto,
+ * every handler ends with its own indirect jump so the branch predictor
+ * can learn opcode pairs. Other compilers index a function pointer table.
+ * Define MY_GB_NO_COMPUTED_GOTO to force the portable engine.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(MY_GB_NO_COMPUTED_GOTO)
+#define MY_GB_COMPUTED_GOTO
+#endif
+
+// native blocks and my_gb_cpu_step call the handlers of the table too
+#define OP_ENTRY(n) _op_##n,
+static const my_gb_op_handler op_table[0x100] = {
+    OPCODE_LIST(OP_ENTRY)
+};
+#undef OP_ENTRY
+
+#ifdef MY_GB_JIT
+// Drop every native block when the arena is full.
+static void _block_native_reset(struct gb_machine *gb)
+{
+    my_gb_jit_reset(gb);
+    for (uint32_t i = 0; i < BLOCK_CACHE_SIZE; ++i)
+        gb->cpu.blocks[i].native = NULL;
+}
+#endif
+
+// Called after _block_enter, runs the whole block as native code when it is
+// hot and fits before the deadline, then leaves op_next == op_stop
+// so the dispatch loop checks deadline and interruptions again.
+static inline void _block_native(struct gb_machine *gb)
+{
+#ifdef MY_GB_JIT
+    struct gb_block *block = gb->cpu.block;
+    uint32_t ops_done;
+
+    if (!gb->cpu.jit_enabled || gb->cpu.op_next != block->ops
+        || gb->cpu.op_stop != block->ops + block->count)
+        return;
+    if (block->native == NULL) {
+        // boot rom is left to the interpreter which traces it
+        if (block == &gb->cpu.block_scratch || block->bank == 0xFFFF
+            || ++block->entries < JIT_HOT_ENTRIES)
+            return;
+        block->native = my_gb_jit_compile(gb, block, op_table);
+        if (block->native == NULL) {
+            _block_native_reset(gb);
+            block->native = my_gb_jit_compile(gb, block, op_table);
+            if (block->native == NULL)
+                return;
+        }
+    }
+    // _address_write_slow sets op_stop to op_next, that is NULL
+    gb->cpu.op_next = NULL;
+    gb->cpu.op_stop = block->ops;
+    ops_done = block->native(gb);
+    gb->cpu.op_next = block->ops + ops_done;
+    gb->cpu.op_stop = gb->cpu.op_next;
+#endif
+}
+
+static void _serial_complete(struct gb_machine *gb, uint64_t deadline)
+{
+    gb->cpu.SB = 0xFF;
+    gb->cpu.SC &= ~0x80;
+    my_gb_cpu_on_interruption(gb, INT_SERIAL_TRANSFER_COMPLETION);
+}
+
+int my_gb_cpu_construct(struct gb_machine *gb)
+{
+    gb->cpu.internal_ram = 0;
+    gb->cpu.is_halted = 0;
+    gb->cpu.is_stopped = 0;
+    gb->cpu.run_begin = 0;
+    gb->cpu.flags.op = FLAG_OP_NONE;
+    gb->cpu.vram_locked = 0;
+    memset(gb->cpu.blocks, 0, sizeof(gb->cpu.blocks));
+    memset(gb->cpu.code_page, 0, sizeof(gb->cpu.code_page));
+    memset(gb->cpu.code_generation, 0, sizeof(gb->cpu.code_generation));
+    gb->cpu.code_hram_begin = 0;
+    gb->cpu.code_hram_end = 0;
+    gb->cpu.block = NULL;
+    gb->cpu.op_next = NULL;
+    gb->cpu.op_stop = NULL;
+    gb->cpu.jit_enabled = 0;
+    gb->cpu.jit.arena = NULL;
+    gb->cpu.jit.used = 0;
+
+
+    // bootstrap code(256Byte in gameboy) changes register to desired value,
+    // my_gb_cpu_skip_boot jumps over it
+    gb->cpu.AF = 0x0;
+    gb->cpu.BC = 0x0;
+    gb->cpu.DE = 0x0;
+    gb->cpu.HL = 0x0;
+    gb->cpu.SP = 0x0;
+    gb->cpu.PC = 0x0;
+    gb->cpu.SB = 0;
+    gb->cpu.SC = 0;
+    gb->cpu.IF = 0;
+    gb->cpu.BOOT = 0;
+    gb->cpu.IE = 0;
+
+    gb->cpu.IME = 0;
+    gb->cpu.interrupt_pending = 0;
+    gb->cpu.dma_active = 0;
+
+    _memory_map(gb);
+    my_gb_scheduler_register(gb, EVENT_SERIAL, _serial_complete);
+    my_gb_scheduler_register(gb, EVENT_DMA, _dma_finish);
+
+    return 0;
+}
+
+void my_gb_cpu_destruct(struct gb_machine *gb)
+{
+    my_gb_jit_destruct(gb);
+}
+
+void my_gb_cpu_link_ram(struct gb_machine *gb, uint8_t * _internal_ram)
+{
+    gb->cpu.internal_ram = _internal_ram;
+    _memory_map(gb);
+}
+
+void my_gb_cpu_link_cart(struct gb_machine *gb)
+{
+    _memory_map(gb);
+}
+
+void my_gb_cpu_skip_boot(struct gb_machine *gb)
+{
+    // I/O registers left by the boot rom, written as the boot rom does
+    static const struct {
+        uint16_t address;
+        uint8_t data;
+    } io[] = {
+        { 0xFF26, 0x80 },   // NR52, sound on
+        { 0xFF11, 0x80 },   // NR11
+        { 0xFF12, 0xF3 },   // NR12
+        { 0xFF25, 0xF3 },   // NR51
+        { 0xFF24, 0x77 },   // NR50
+        { 0xFF47, 0xFC },   // BGP
+        { 0xFF40, 0x91 },   // LCDC, LCD and background on
+    };
+
+    // the boot rom clears VRAM before drawing the logo, which is skipped
+    memset(gb->cpu.internal_ram + RAM_OFFSET_VRAM, 0, 8 * 1024);
+    my_gb_screen_tile_written(gb, 0x8000, TILE_DATA_END - 0x8000);
+    for (uint32_t i = 0; i < sizeof(io) / sizeof(io[0]); ++i)
+        _address_write(gb, io[i].address, io[i].data);
+
+    set_AF(0x01B0);
+    gb->cpu.BC = 0x0013;
+    gb->cpu.DE = 0x00D8;
+    gb->cpu.HL = 0x014D;
+    gb->cpu.SP = 0xFFFE;
+    gb->cpu.PC = 0x0100;
+    // unmap the boot rom, the cart is now seen at 0x0000
+    _address_write(gb, 0xFF50, 0x01);
+}
+
+void my_gb_cpu_lock_vram(struct gb_machine *gb, uint32_t locked)
+{
+    if (gb->cpu.vram_locked == locked)
+        return;
+    gb->cpu.vram_locked = locked;
+    if (gb->cpu.internal_ram)
+        _memory_map_vram(gb);
+}
+
+int my_gb_cpu_set_jit(struct gb_machine *gb, uint32_t enabled)
+{
+    if (enabled && my_gb_jit_construct(gb) == -1)
+        return -1;
+    gb->cpu.jit_enabled = enabled;
+    return 0;
+}
+
+uint32_t my_gb_cpu_run(struct gb_machine *gb)
+{
+    uint64_t clock_begin = gb->scheduler.clock;
+    const struct gb_micro_op *op;
+    gb->cpu.run_begin = clock_begin;
+    // events may have raised interruptions, check before the first op
+    gb->cpu.op_stop = gb->cpu.op_next;
+    if ((gb->cpu.is_halted || gb->cpu.is_stopped) && !_cpu_wake(gb)) {
+        gb->scheduler.clock += _cpu_sleep(gb);
+        return (uint32_t)(gb->scheduler.clock - clock_begin);
+    }
+#ifdef MY_GB_COMPUTED_GOTO
+#define OP_LABEL(n) &&label_##n,
+    static void *const labels[0x100] = {
+        OPCODE_LIST(OP_LABEL)
+    };
+#undef OP_LABEL
+
+#define DISPATCH() \
+    do { \
+        if (gb->cpu.op_next == gb->cpu.op_stop) \
+            goto next_block; \
+        op = _cpu_fetch(gb); \
+        gb->scheduler.clock += op->cycles; \
+        goto *labels[op->opcode]; \
+    } while (0)
+
+next_block:
+    // shared by the handlers, keeps their dispatch short
+    while (gb->cpu.op_next == gb->cpu.op_stop) {
+        if (gb->scheduler.clock >= gb->scheduler.deadline)
+            goto done;
+        if (gb->cpu.interrupt_pending)
+            gb->scheduler.clock += _cpu_interruption(gb);
+        _block_enter(gb);
+        _block_native(gb);
+    }
+    DISPATCH();
+#define OP_LABEL(n) label_##n: gb->scheduler.clock += _op_##n(gb); DISPATCH();
+    OPCODE_LIST(OP_LABEL)
+#undef OP_LABEL
+#undef DISPATCH
+#else
+    for (;;) {
+        while (gb->cpu.op_next == gb->cpu.op_stop) {
+            if (gb->scheduler.clock >= gb->scheduler.deadline)
+                goto done;
+            if (gb->cpu.interrupt_pending)
+                gb->scheduler.clock += _cpu_interruption(gb);
+            _block_enter(gb);
+            _block_native(gb);
+        }
+        op = _cpu_fetch(gb);
+        gb->scheduler.clock += op->cycles + op_table[op->opcode](gb);
+    }
+#endif
+done:
+    return (uint32_t)(gb->scheduler.clock - clock_begin);
+}
+
+uint32_t my_gb_cpu_step(struct gb_machine *gb)
+{
+    struct gb_block *block = &gb->cpu.block_scratch;
+    const struct gb_micro_op *op;
+    uint32_t cycles;
+
+    _block_decode(gb, block, gb->cpu.PC, 1);
+    gb->cpu.block = block;
+    gb->cpu.op_next = block->ops;
+    gb->cpu.op_stop = block->ops + 1;
+    op = _cpu_fetch(gb);
+    cycles = op->cycles + op_table[op->opcode](gb);
+    gb->scheduler.clock += cycles;
+    // leave F readable from AF
+    gb->cpu.AF = get_AF;
+    return cycles;
+}
+
+void my_gb_cpu_on_interruption(struct gb_machine *gb, enum INTERRUPTION_TYPE type)
+{
+    // IF is a bit set in the order of INTERRUPTION_TYPE, requests pile up
+    // until dispatched one by one in priority order. IE is checked then.
+    gb->cpu.IF |= (uint8_t)(1u << type);
+    _interrupt_update(gb);
+}
@@ -1,35 +1,269 @@
-#pragma once;
-#ifndef _MY_GB_CPU_H_
-#define _MY_GB_CPU_H_
-
-#include"../cart/cart.h"
-#include<stdint.h>
-
-#define LOAD_BOOTSTRAP
-
-enum INTERRUPTION_TYPE {
-	INT_VBLANK,
-	INT_LCDC_STATUS,
-	INT_TIMER_OVERFLOW,
-	INT_SERIAL_TRANSFER_COMPLETION,
-	INT_BUTTON_PRESS,
-};
-
-int my_gb_cpu_construct(void);
-
-void my_gb_cpu_destruct(void);
-
-void my_gb_cpu_link_ram(uint8_t* _internal_ram);
-
-void my_gb_cpu_link_cart(void);
-
-// currently not implemented
-// process only one instruction
-// return number of machine cycles
-uint32_t my_gb_cpu_run(uint32_t cycles_want);
-
-// currently not implemented
-// need to check IME(interrupt master enable)
-void my_gb_cpu_on_interruption(enum INTERRUPTION_TYPE type);
-
-#endif
+#pragma once;
+#ifndef _MY_GB_CPU_H_
+#define _MY_GB_CPU_H_
+
+#include<stdint.h>
+#include"jit.h"
+
+struct gb_machine;
+
+enum INTERRUPTION_TYPE {
+	INT_VBLANK,
+	INT_LCDC_STATUS,
+	INT_TIMER_OVERFLOW,
+	INT_SERIAL_TRANSFER_COMPLETION,
+	INT_BUTTON_PRESS,
+};
+
+// IO registers
+
+/*
+(ATTENTION: NO LINK PARTNER, TRANSFERS ALWAYS RECEIVE $FF)
+FF01
+   Name     - SB
+   Contents - Serial transfer data (R/W)
+
+              8 Bits of data to be read/written
+
+(ATTENTION: NO LINK PARTNER, EXTERNAL CLOCK TRANSFERS NEVER END)
+FF02
+   Name     - SC
+   Contents - SIO control  (R/W)
+
+              Bit 7 - Transfer Start Flag
+                      0: Non transfer
+                      1: Start transfer
+
+              Bit 0 - Shift Clock
+                      0: External Clock (500KHz Max.)
+                      1: Internal Clock (8192Hz)
+
+               Transfer is initiated by setting the
+              Transfer Start Flag. This bit may be read
+              and is automatically set to 0 at the end of
+              Transfer.
+
+               Transmitting and receiving serial data is
+              done simultaneously. The received data is
+              automatically stored in SB.
+
+FF0F
+   Name     - IF
+   Contents - Interrupt Flag (R/W)
+
+              Bit 4: Transition from High to Low of Pin number P10-P13
+              Bit 3: Serial I/O transfer complete
+              Bit 2: Timer Overflow
+              Bit 1: LCDC (see STAT)
+              Bit 0: V-Blank
+
+   The priority and jump address for the above 5 interrupts are:
+
+    Interrupt        Priority        Start Address
+
+    V-Blank             1              $0040
+    LCDC Status         2              $0048 - Modes 0, 1, 2
+                                               LYC=LY coincide (selectable)
+    Timer Overflow      3              $0050
+    Serial Transfer     4              $0058 - when transfer is complete
+    Hi-Lo of P10-P13    5              $0060
+
+    * When more than 1 interrupts occur at the same time
+      only the interrupt with the highest priority can be
+      acknowledged. When an interrupt is used a '0' should
+      be stored in the IF register before the IE register
+      is set.
+
+FF50
+   NAME     - BOOT
+   Contents - Turn off boot rom (R?/W)
+
+FFFF
+   Name     - IE
+   Contents - Interrupt Enable (R/W)
+
+              Bit 4: Transition from High to Low of Pin
+                     number P10-P13.
+              Bit 3: Serial I/O transfer complete
+              Bit 2: Timer Overflow
+              Bit 1: LCDC (see STAT)
+              Bit 0: V-Blank
+
+              0: disable
+              1: enable
+
+*/
+
+/*
+ * Instructions are decoded once into micro ops carrying their resolved
+ * operand and cycles, and kept in basic blocks ending at the first jump,
+ * call, return, HALT, STOP, EI, DI or illegal opcode.
+ * Blocks are keyed by bank and PC. A block from RAM is dropped when one
+ * of the pages its bytes are on is written, see code_page and
+ * code_generation of gb_cpu.
+ * A block which ends before the next deadline runs without checking
+ * deadline and interruptions between its ops.
+ */
+#define BLOCK_MAX_OPS 16
+#define BLOCK_CACHE_SIZE 1024
+
+struct gb_micro_op {
+    uint16_t pc;
+    uint16_t operand;
+    uint8_t opcode;
+    uint8_t length;
+    uint8_t cycles;         // cycles_table(and cycles_table_cb) summed at decode
+    uint8_t cycles_to_last; // cycles from this op to the last op of the block
+};
+
+struct gb_block {
+    uint32_t generation;    // code_generation of page when decoded
+    uint32_t generation_last;   // and of page_last
+    uint16_t pc;
+    uint16_t bank;
+    uint8_t page;
+    uint8_t page_last;      // page of the last byte, the next one when an operand crosses
+    uint8_t count;
+    uint32_t entries;       // times entered from its first op, see JIT_HOT_ENTRIES
+    my_gb_native_block native;
+    struct gb_micro_op ops[BLOCK_MAX_OPS];
+};
+
+// operation recorded by lazy flags, see cpu.c
+enum FLAG_OP {
+    FLAG_OP_NONE,
+    FLAG_OP_ADD,    // ADD ADC
+    FLAG_OP_SUB,    // SUB SBC CP
+    FLAG_OP_AND,
+    FLAG_OP_OR,     // OR XOR
+    FLAG_OP_INC,
+    FLAG_OP_DEC,
+    FLAG_OP_NUM,
+};
+
+struct gb_cpu {
+    uint16_t AF;
+    uint16_t BC;
+    uint16_t DE;
+    uint16_t HL;
+    uint16_t SP;
+    uint16_t PC;
+
+    // last flag producing operation, see lazy flags in cpu.c
+    struct {
+        uint8_t op;
+        uint8_t a;
+        uint8_t b;
+        uint16_t result;
+    } flags;
+
+    uint8_t SB;
+    uint8_t SC;
+    uint8_t IF;
+    uint8_t BOOT;
+    uint8_t IE;
+
+    // Interrupt Master Enable flag
+    // This register is not mapped to gameboy address space
+    // 1. There are only two instruction we can add it
+    // 2. This is a boolean value so only the LSB is used.
+    uint8_t IME;
+    // IME && (IE & IF), kept up to date by every write of the three,
+    // so the cpu only looks for interruptions between blocks when set
+    uint8_t interrupt_pending;
+
+    // HALT waits for an enabled interruption, STOP for a button press.
+    // Sleeping cpu skips its clock to the next event instead of running.
+    uint32_t is_halted;
+    uint32_t is_stopped;
+
+    // clock at the start of the current run, events only happen between runs
+    uint64_t run_begin;
+
+    uint8_t *internal_ram;
+
+    /*
+     * Page tables of the cpu address space, one entry per 256 bytes page.
+     * A non-NULL entry points to the host memory backing the whole page,
+     * so access to plain RAM, VRAM and ROM banks is a single indexed load/store.
+     * A NULL entry means the page has side effects(I/O registers, MBC registers,
+     * disabled cart RAM, OAM and unused area...) and the access falls back to
+     * _address_read_slow and _address_write_slow.
+     */
+    uint8_t *page_read[0x100];
+    uint8_t *page_write[0x100];
+
+    // VRAM cannot be read by cpu while LCD is transferring pixels,
+    // its read pages are unmapped during that time.
+    uint32_t vram_locked;
+
+    // OAM DMA owns the bus, only HRAM and I/O can be accessed
+    // and every page is unmapped during that time.
+    uint32_t dma_active;
+
+    // operand of the executing instruction, returned by _fetch_8 and _fetch_16
+    uint16_t operand;
+
+    // Block being executed and its next op. Ops run unchecked until op_stop,
+    // which is the end of the block, the next op when the deadline is near,
+    // or op_next itself when a write to I/O may have scheduled an event or
+    // raised an interruption. block is NULL when its code may have changed.
+    struct gb_block *block;
+    const struct gb_micro_op *op_next;
+    const struct gb_micro_op *op_stop;
+    // holds a single op decoded where code is not cached(VRAM, OAM, I/O)
+    struct gb_block block_scratch;
+    struct gb_block blocks[BLOCK_CACHE_SIZE];
+
+    // Non-zero for RAM pages holding cached code. Their write pages are
+    // unmapped, so the first write goes to _address_write_slow which bumps
+    // code_generation and makes the blocks of the page stale.
+    uint8_t code_page[0x100];
+    uint32_t code_generation[0x100];
+    // HRAM shares page 0xFF with I/O registers and often the stack, only
+    // writes to offsets from code_hram_begin to code_hram_end(excluded)
+    // drop its blocks.
+    uint32_t code_hram_begin;
+    uint32_t code_hram_end;
+
+    // hot blocks run as native code when enabled, see jit.h
+    uint32_t jit_enabled;
+    struct gb_jit jit;
+};
+
+int my_gb_cpu_construct(struct gb_machine *gb);
+
+void my_gb_cpu_destruct(struct gb_machine *gb);
+
+void my_gb_cpu_link_ram(struct gb_machine *gb, uint8_t* _internal_ram);
+
+void my_gb_cpu_link_cart(struct gb_machine *gb);
+
+// Jump over the boot rom, leaving registers, I/O and memory map as it does
+// and PC at the cart entry 0x0100. Call after the machine is linked and
+// before it runs, the boot rom runs otherwise.
+void my_gb_cpu_skip_boot(struct gb_machine *gb);
+
+// Called by screen when entering and leaving pixel transfer,
+// cpu cannot read VRAM during that period.
+void my_gb_cpu_lock_vram(struct gb_machine *gb, uint32_t locked);
+
+// Turn the native code backend on or off,
+// return -1 when it is not available on this host.
+int my_gb_cpu_set_jit(struct gb_machine *gb, uint32_t enabled);
+
+// run until deadline of the scheduler
+// return number of machine cycles executed
+uint32_t my_gb_cpu_run(struct gb_machine *gb);
+
+// Run the single instruction at PC, bypassing the block cache and the
+// interruption check, for conformance tests and debuggers.
+// F is up to date in AF afterwards. Sleeping and loop skipping only reach
+// the deadline of the scheduler, keep it at the clock to step exactly.
+// return number of machine cycles executed
+uint32_t my_gb_cpu_step(struct gb_machine *gb);
+
+// Request interruption type in IF, it is serviced once IME and IE allow it.
+void my_gb_cpu_on_interruption(struct gb_machine *gb, enum INTERRUPTION_TYPE type);
+
+#endif
@@ -0,0 +1,743 @@
+#include<stddef.h>
+#include"jit.h"
+#include"../machine.h"
+
+#ifdef MY_GB_JIT
+#ifdef _WIN32
+#include<Windows.h>
+#else
+#include<sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+// Upper bound of the code of one block, an op and its slow path
+// take less than 256 bytes.
+#define JIT_BLOCK_MAX_BYTES (BLOCK_MAX_OPS * 256 + 128)
+
+#define OFFSET(member) ((int32_t)offsetof(struct gb_machine, member))
+
+// x86-64 registers used by the generated code
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBP 5
+#define R11 11
+#define R12 12
+#define R13 13
+#define R14 14
+#define R15 15
+
+/*
+ * Register pairs are kept in callee saved host registers for a block,
+ * zero extended to 32 bits. A pair is read from gb on its first use and
+ * written back when it changed, before each handler call and before
+ * leaving the block. A handler may change any pair, so they are read again
+ * after it.
+ */
+enum JIT_PAIR {
+    PAIR_BC,
+    PAIR_DE,
+    PAIR_HL,
+    PAIR_SP,
+    PAIR_AF,
+    PAIR_NUM,
+};
+
+static const uint8_t pair_host[PAIR_NUM] = { R12, R13, R14, RBP, R15 };
+
+struct emitter {
+    uint8_t *code;
+    uint32_t size;
+    // bit 1 << pair for pairs held in their host register
+    uint8_t loaded;
+    // and for the ones changed since read from gb
+    uint8_t dirty;
+};
+
+static void _emit_8(struct emitter *e, uint8_t data_8)
+{
+    e->code[e->size++] = data_8;
+}
+
+static void _emit_16(struct emitter *e, uint16_t data_16)
+{
+    _emit_8(e, (uint8_t)data_16);
+    _emit_8(e, (uint8_t)(data_16 >> 8));
+}
+
+static void _emit_32(struct emitter *e, uint32_t data_32)
+{
+    _emit_16(e, (uint16_t)data_32);
+    _emit_16(e, (uint16_t)(data_32 >> 16));
+}
+
+static void _emit_64(struct emitter *e, uint64_t data_64)
+{
+    _emit_32(e, (uint32_t)data_64);
+    _emit_32(e, (uint32_t)(data_64 >> 32));
+}
+
+// ModRM and displacement of [rbx + offset], rbx holds gb in the whole block.
+static void _emit_rbx(struct emitter *e, uint8_t reg, int32_t offset)
+{
+    _emit_8(e, 0x80 | ((reg & 0x7) << 3) | 0x3);
+    _emit_32(e, (uint32_t)offset);
+}
+
+// REX prefix, always emitted so that the low byte of rbp is bpl.
+static void _emit_rex(struct emitter *e, uint8_t reg, uint8_t rm)
+{
+    _emit_8(e, 0x40 | ((reg >> 3) << 2) | (rm >> 3));
+}
+
+// ModRM of two registers
+static void _emit_rr(struct emitter *e, uint8_t reg, uint8_t rm)
+{
+    _emit_8(e, 0xC0 | ((reg & 0x7) << 3) | (rm & 0x7));
+}
+
+static int32_t _pair_offset(enum JIT_PAIR pair)
+{
+    switch (pair) {
+    case PAIR_BC:
+        return OFFSET(cpu.BC);
+    case PAIR_DE:
+        return OFFSET(cpu.DE);
+    case PAIR_HL:
+        return OFFSET(cpu.HL);
+    case PAIR_SP:
+        return OFFSET(cpu.SP);
+    default:
+        return OFFSET(cpu.AF);
+    }
+}
+
+// Host register of pair, read from gb unless it is held already.
+static uint8_t _pair_use(struct emitter *e, enum JIT_PAIR pair)
+{
+    uint8_t host = pair_host[pair];
+    if (!(e->loaded & (1 << pair))) {
+        _emit_rex(e, host, 0);  // movzx host, word [rbx + pair]
+        _emit_8(e, 0x0F);
+        _emit_8(e, 0xB7);
+        _emit_rbx(e, host, _pair_offset(pair));
+        e->loaded |= 1 << pair;
+    }
+    return host;
+}
+
+// Write the pairs of mask back to gb.
+static void _emit_spill(struct emitter *e, uint8_t mask)
+{
+    for (uint32_t pair = 0; pair < PAIR_NUM; ++pair) {
+        if (!(mask & (1 << pair)))
+            continue;
+        _emit_8(e, 0x66);       // mov word [rbx + pair], host
+        _emit_rex(e, pair_host[pair], 0);
+        _emit_8(e, 0x89);
+        _emit_rbx(e, pair_host[pair], _pair_offset(pair));
+    }
+}
+
+// Pair of 8 bits register index(B C D E H L - A), and whether it is the high byte.
+static enum JIT_PAIR _reg_pair(uint8_t index)
+{
+    return index == 7 ? PAIR_AF : (enum JIT_PAIR)(index >> 1);
+}
+
+static uint32_t _reg_high(uint8_t index)
+{
+    return index == 7 || !(index & 0x1);
+}
+
+// dst(eax, ecx or edx) = 8 bits register, zero extended.
+static void _emit_reg_get(struct emitter *e, uint8_t dst, uint8_t index)
+{
+    uint8_t host = _pair_use(e, _reg_pair(index));
+    if (_reg_high(index)) {
+        _emit_rex(e, dst, host);    // mov dst, host
+        _emit_8(e, 0x8B);
+        _emit_rr(e, dst, host);
+        _emit_8(e, 0xC1);       // shr dst, 8
+        _emit_rr(e, 5, dst);
+        _emit_8(e, 0x08);
+    } else {
+        _emit_rex(e, dst, host);    // movzx dst, low byte of host
+        _emit_8(e, 0x0F);
+        _emit_8(e, 0xB6);
+        _emit_rr(e, dst, host);
+    }
+}
+
+// 8 bits register = src(al, cl or dl), r11 is scratch.
+static void _emit_reg_set(struct emitter *e, uint8_t index, uint8_t src)
+{
+    enum JIT_PAIR pair = _reg_pair(index);
+    uint8_t host = _pair_use(e, pair);
+    if (_reg_high(index)) {
+        _emit_rex(e, R11, src);     // movzx r11d, src
+        _emit_8(e, 0x0F);
+        _emit_8(e, 0xB6);
+        _emit_rr(e, R11, src);
+        _emit_rex(e, 0, R11);       // shl r11d, 8
+        _emit_8(e, 0xC1);
+        _emit_rr(e, 4, R11);
+        _emit_8(e, 0x08);
+        _emit_rex(e, host, host);   // movzx host, low byte of host
+        _emit_8(e, 0x0F);
+        _emit_8(e, 0xB6);
+        _emit_rr(e, host, host);
+        _emit_rex(e, R11, host);    // or host, r11d
+        _emit_8(e, 0x09);
+        _emit_rr(e, R11, host);
+    } else {
+        _emit_rex(e, src, host);    // mov low byte of host, src
+        _emit_8(e, 0x88);
+        _emit_rr(e, src, host);
+    }
+    e->dirty |= 1 << pair;
+}
+
+// INC rr, DEC rr
+static void _emit_pair_step(struct emitter *e, enum JIT_PAIR pair, uint32_t dec)
+{
+    uint8_t host = _pair_use(e, pair);
+    _emit_8(e, 0x66);           // inc(dec) host 16 bits
+    _emit_rex(e, 0, host);
+    _emit_8(e, 0xFF);
+    _emit_rr(e, dec ? 1 : 0, host);
+    e->dirty |= 1 << pair;
+}
+
+static void _emit_store_16(struct emitter *e, int32_t offset, uint16_t data_16)
+{
+    _emit_8(e, 0x66);           // mov word [rbx + offset], imm16
+    _emit_8(e, 0xC7);
+    _emit_rbx(e, 0, offset);
+    _emit_16(e, data_16);
+}
+
+static void _emit_clock_add(struct emitter *e, uint32_t cycles)
+{
+    if (cycles == 0)
+        return;
+    _emit_8(e, 0x48);           // add qword [rbx + clock], imm32
+    _emit_8(e, 0x81);
+    _emit_rbx(e, 0, OFFSET(scheduler.clock));
+    _emit_32(e, cycles);
+}
+
+static void _emit_return(struct emitter *e, uint32_t ops_done)
+{
+    _emit_8(e, 0xB8);           // mov eax, ops_done
+    _emit_32(e, ops_done);
+    _emit_8(e, 0x48);           // add rsp, 40
+    _emit_8(e, 0x83);
+    _emit_8(e, 0xC4);
+    _emit_8(e, 0x28);
+    _emit_8(e, 0x41);           // pop r15
+    _emit_8(e, 0x5F);
+    _emit_8(e, 0x41);           // pop r14
+    _emit_8(e, 0x5E);
+    _emit_8(e, 0x41);           // pop r13
+    _emit_8(e, 0x5D);
+    _emit_8(e, 0x41);           // pop r12
+    _emit_8(e, 0x5C);
+    _emit_8(e, 0x5D);           // pop rbp
+    _emit_8(e, 0x5B);           // pop rbx
+    _emit_8(e, 0xC3);           // ret
+}
+
+// Call handler the way the dispatch loop does,
+// its return value is the extra cycles of taken branches.
+static void _emit_handler(struct emitter *e, my_gb_op_handler handler)
+{
+    _emit_8(e, 0x48);           // mov rdi(rcx), rbx
+    _emit_8(e, 0x89);
+#ifdef _WIN32
+    _emit_8(e, 0xC0 | (3 << 3) | RCX);
+#else
+    _emit_8(e, 0xC0 | (3 << 3) | 7);
+#endif
+    _emit_8(e, 0x48);           // mov rax, handler
+    _emit_8(e, 0xB8);
+    _emit_64(e, (uint64_t)(uintptr_t)handler);
+    _emit_8(e, 0xFF);           // call rax
+    _emit_8(e, 0xD0);
+    _emit_8(e, 0x89);           // mov eax, eax
+    _emit_8(e, 0xC0);
+    _emit_8(e, 0x48);           // add [rbx + clock], rax
+    _emit_8(e, 0x01);
+    _emit_rbx(e, RAX, OFFSET(scheduler.clock));
+}
+
+// Run op through its handler with clock, PC, operand and registers as in the interpreter.
+static void _emit_op_handler(struct emitter *e, const struct gb_micro_op *op, uint32_t cycles_pending,
+    const my_gb_op_handler handlers[0x100])
+{
+    _emit_spill(e, e->dirty);
+    e->dirty = 0;
+    _emit_clock_add(e, cycles_pending + op->cycles);
+    _emit_store_16(e, OFFSET(cpu.PC), op->pc + op->length);
+    if (op->length > 1)
+        _emit_store_16(e, OFFSET(cpu.operand), op->operand);
+    _emit_handler(e, handlers[op->opcode]);
+    e->loaded = 0;
+}
+
+// Leave the block after ops_done ops when a write cleared op_stop,
+// registers are all written back after a handler.
+static void _emit_write_check(struct emitter *e, uint32_t ops_done)
+{
+    uint32_t patch;
+    _emit_8(e, 0x48);           // cmp qword [rbx + op_stop], 0
+    _emit_8(e, 0x83);
+    _emit_rbx(e, 7, OFFSET(cpu.op_stop));
+    _emit_8(e, 0x00);
+    _emit_8(e, 0x75);           // jne over the return
+    _emit_8(e, 0);
+    patch = e->size - 1;
+    _emit_return(e, ops_done);
+    e->code[patch] = (uint8_t)(e->size - (patch + 1));
+}
+
+// ecx = 16 bits register pair, an address
+static void _emit_address(struct emitter *e, enum JIT_PAIR pair)
+{
+    uint8_t host = _pair_use(e, pair);
+    _emit_rex(e, RCX, host);    // movzx ecx, host 16 bits
+    _emit_8(e, 0x0F);
+    _emit_8(e, 0xB7);
+    _emit_rr(e, RCX, host);
+}
+
+/*
+ * rdx = page table entry of the address in ecx, or of the constant address,
+ * then jump to the slow path of the op when the entry is NULL.
+ * Return the position of the jump to patch.
+ */
+static uint32_t _emit_page(struct emitter *e, int32_t table, int32_t constant)
+{
+    if (constant >= 0) {
+        _emit_8(e, 0x48);       // mov rdx, [rbx + table + page * 8]
+        _emit_8(e, 0x8B);
+        _emit_rbx(e, RDX, table + (constant >> 8) * 8);
+    } else {
+        _emit_8(e, 0x89);       // mov eax, ecx
+        _emit_8(e, 0xC8);
+        _emit_8(e, 0xC1);       // shr eax, 8
+        _emit_8(e, 0xE8);
+        _emit_8(e, 0x08);
+        _emit_8(e, 0x48);       // mov rdx, [rbx + rax * 8 + table]
+        _emit_8(e, 0x8B);
+        _emit_8(e, 0x94);
+        _emit_8(e, 0xC3);
+        _emit_32(e, (uint32_t)table);
+        _emit_8(e, 0x0F);       // movzx ecx, cl
+        _emit_8(e, 0xB6);
+        _emit_8(e, 0xC9);
+    }
+    _emit_8(e, 0x48);           // test rdx, rdx
+    _emit_8(e, 0x85);
+    _emit_8(e, 0xD2);
+    _emit_8(e, 0x0F);           // jz slow path
+    _emit_8(e, 0x84);
+    _emit_32(e, 0);
+    return e->size - 4;
+}
+
+// al = [rdx + rcx], or [rdx + constant offset in the page]
+static void _emit_page_read(struct emitter *e, int32_t constant)
+{
+    _emit_8(e, 0x8A);
+    if (constant >= 0) {
+        _emit_8(e, 0x82);       // mov al, [rdx + offset]
+        _emit_32(e, (uint32_t)(constant & 0xFF));
+    } else {
+        _emit_8(e, 0x04);       // mov al, [rdx + rcx]
+        _emit_8(e, 0x0A);
+    }
+}
+
+static void _emit_page_write(struct emitter *e, int32_t constant)
+{
+    _emit_8(e, 0x88);
+    if (constant >= 0) {
+        _emit_8(e, 0x82);       // mov [rdx + offset], al
+        _emit_32(e, (uint32_t)(constant & 0xFF));
+    } else {
+        _emit_8(e, 0x04);       // mov [rdx + rcx], al
+        _emit_8(e, 0x0A);
+    }
+}
+
+#ifndef MY_GB_EAGER_FLAGS
+static void _emit_store_8(struct emitter *e, int32_t offset, uint8_t data_8)
+{
+    _emit_8(e, 0xC6);           // mov byte [rbx + offset], imm8
+    _emit_rbx(e, 0, offset);
+    _emit_8(e, data_8);
+}
+
+static void _emit_flags_op(struct emitter *e, enum FLAG_OP op)
+{
+    _emit_store_8(e, OFFSET(cpu.flags.op), (uint8_t)op);
+}
+
+// flags.result = dx
+static void _emit_flags_result(struct emitter *e)
+{
+    _emit_8(e, 0x66);           // mov [rbx + result], dx
+    _emit_8(e, 0x89);
+    _emit_rbx(e, RDX, OFFSET(cpu.flags.result));
+}
+
+/*
+ * ADD SUB AND XOR OR CP of A and cl, recorded for lazy flags as _alu does.
+ * ADC and SBC read the carry and are left to the handlers.
+ */
+static void _emit_alu(struct emitter *e, uint8_t op)
+{
+    _emit_reg_get(e, RAX, 7);   // eax = A
+    if (op == 0 || op == 2 || op == 7) {
+        _emit_8(e, 0x89);       // mov edx, eax
+        _emit_8(e, 0xC2);
+        _emit_8(e, op == 0 ? 0x01 : 0x29);  // add(sub) edx, ecx
+        _emit_8(e, 0xCA);
+        if (op != 7)
+            _emit_reg_set(e, 7, RDX);   // A = dl
+        _emit_flags_op(e, op == 0 ? FLAG_OP_ADD : FLAG_OP_SUB);
+        _emit_8(e, 0x88);       // mov [rbx + flags.a], al
+        _emit_rbx(e, RAX, OFFSET(cpu.flags.a));
+        _emit_8(e, 0x88);       // mov [rbx + flags.b], cl
+        _emit_rbx(e, RCX, OFFSET(cpu.flags.b));
+    } else {
+        _emit_8(e, op == 4 ? 0x20 : op == 5 ? 0x30 : 0x08);    // and(xor, or) al, cl
+        _emit_8(e, 0xC8);
+        _emit_reg_set(e, 7, RAX);   // A = al
+        _emit_8(e, 0x0F);       // movzx edx, al
+        _emit_8(e, 0xB6);
+        _emit_8(e, 0xD0);
+        _emit_flags_op(e, op == 4 ? FLAG_OP_AND : FLAG_OP_OR);
+        _emit_store_8(e, OFFSET(cpu.flags.a), 0);
+        _emit_store_8(e, OFFSET(cpu.flags.b), 0);
+    }
+    _emit_flags_result(e);
+}
+
+// INC r, DEC r, the previous carry goes to bit 8 of the result as in _inc_r.
+static void _emit_inc_dec(struct emitter *e, uint8_t index, uint32_t dec)
+{
+    uint8_t af = _pair_use(e, PAIR_AF);
+    _emit_8(e, 0x0F);           // movzx edx, word [rbx + flags.result]
+    _emit_8(e, 0xB7);
+    _emit_rbx(e, RDX, OFFSET(cpu.flags.result));
+    _emit_8(e, 0xC1);           // shr edx, 8
+    _emit_8(e, 0xEA);
+    _emit_8(e, 0x08);
+    _emit_rex(e, RAX, af);      // movzx eax, F
+    _emit_8(e, 0x0F);
+    _emit_8(e, 0xB6);
+    _emit_rr(e, RAX, af);
+    _emit_8(e, 0xC1);           // shr eax, 4
+    _emit_8(e, 0xE8);
+    _emit_8(e, 0x04);
+    _emit_8(e, 0x80);           // cmp byte [rbx + flags.op], FLAG_OP_NONE
+    _emit_rbx(e, 7, OFFSET(cpu.flags.op));
+    _emit_8(e, FLAG_OP_NONE);
+    _emit_8(e, 0x0F);           // cmove edx, eax
+    _emit_8(e, 0x44);
+    _emit_8(e, 0xD0);
+    _emit_8(e, 0x83);           // and edx, 1
+    _emit_8(e, 0xE2);
+    _emit_8(e, 0x01);
+    _emit_8(e, 0xC1);           // shl edx, 8
+    _emit_8(e, 0xE2);
+    _emit_8(e, 0x08);
+    _emit_reg_get(e, RAX, index);
+    _emit_8(e, 0xFE);           // inc(dec) al
+    _emit_8(e, dec ? 0xC8 : 0xC0);
+    _emit_reg_set(e, index, RAX);
+    _emit_8(e, 0x08);           // or dl, al
+    _emit_8(e, 0xC2);
+    _emit_flags_op(e, dec ? FLAG_OP_DEC : FLAG_OP_INC);
+    _emit_store_8(e, OFFSET(cpu.flags.a), 0);
+    _emit_store_8(e, OFFSET(cpu.flags.b), 0);
+    _emit_flags_result(e);
+}
+#endif
+
+/*
+ * Ops with a memory access, the fast path goes through the page tables
+ * as _address_read and _address_write do. A NULL page jumps to a slow path
+ * at the end of the block, which runs the whole op through its handler
+ * and leaves the block, so the state is untouched before the check.
+ * Return 0 when the op is not one of them.
+ */
+static uint32_t _emit_memory_op(struct emitter *e, const struct gb_micro_op *op, uint32_t *patch)
+{
+    uint8_t opcode = op->opcode;
+    uint8_t dst = (opcode >> 3) & 0x7;
+    uint8_t src = opcode & 0x7;
+    int32_t read = OFFSET(cpu.page_read);
+    int32_t write = OFFSET(cpu.page_write);
+
+    if (opcode == 0x0A || opcode == 0x1A || opcode == 0x2A || opcode == 0x3A) {
+        // LD A, (BC) (DE) (HL+) (HL-)
+        _emit_address(e, opcode == 0x0A ? PAIR_BC : opcode == 0x1A ? PAIR_DE : PAIR_HL);
+        *patch = _emit_page(e, read, -1);
+        _emit_page_read(e, -1);
+        _emit_reg_set(e, 7, RAX);
+    } else if (opcode == 0x02 || opcode == 0x12 || opcode == 0x22 || opcode == 0x32) {
+        // LD (BC) (DE) (HL+) (HL-), A
+        _emit_address(e, opcode == 0x02 ? PAIR_BC : opcode == 0x12 ? PAIR_DE : PAIR_HL);
+        *patch = _emit_page(e, write, -1);
+        _emit_reg_get(e, RAX, 7);
+        _emit_page_write(e, -1);
+    } else if (opcode == 0xFA) {
+        // LD A, (a16)
+        *patch = _emit_page(e, read, op->operand);
+        _emit_page_read(e, op->operand);
+        _emit_reg_set(e, 7, RAX);
+    } else if (opcode == 0xEA) {
+        // LD (a16), A
+        *patch = _emit_page(e, write, op->operand);
+        _emit_reg_get(e, RAX, 7);
+        _emit_page_write(e, op->operand);
+    } else if (opcode >= 0x40 && opcode < 0x80 && opcode != 0x76 && src == 6) {
+        // LD r, (HL)
+        _emit_address(e, PAIR_HL);
+        *patch = _emit_page(e, read, -1);
+        _emit_page_read(e, -1);
+        _emit_reg_set(e, dst, RAX);
+    } else if (opcode >= 0x70 && opcode < 0x78 && opcode != 0x76) {
+        // LD (HL), r
+        _emit_address(e, PAIR_HL);
+        *patch = _emit_page(e, write, -1);
+        _emit_reg_get(e, RAX, src);
+        _emit_page_write(e, -1);
+    } else if (opcode == 0x36) {
+        // LD (HL), d8
+        _emit_address(e, PAIR_HL);
+        *patch = _emit_page(e, write, -1);
+        _emit_8(e, 0xB0);       // mov al, d8
+        _emit_8(e, (uint8_t)op->operand);
+        _emit_page_write(e, -1);
+#ifndef MY_GB_EAGER_FLAGS
+    } else if (opcode >= 0x80 && opcode < 0xC0 && src == 6 && dst != 1 && dst != 3) {
+        // ALU A, (HL)
+        _emit_address(e, PAIR_HL);
+        *patch = _emit_page(e, read, -1);
+        _emit_page_read(e, -1);
+        _emit_8(e, 0x0F);       // movzx ecx, al
+        _emit_8(e, 0xB6);
+        _emit_8(e, 0xC8);
+        _emit_alu(e, dst);
+#endif
+    } else {
+        return 0;
+    }
+
+    // HL+ and HL- step after the access
+    if (opcode == 0x22 || opcode == 0x2A || opcode == 0x32 || opcode == 0x3A)
+        _emit_pair_step(e, PAIR_HL, opcode & 0x10);
+    return 1;
+}
+
+// Ops touching registers only, return 0 when the op is not one of them.
+static uint32_t _emit_register_op(struct emitter *e, const struct gb_micro_op *op)
+{
+    uint8_t opcode = op->opcode;
+    uint8_t dst = (opcode >> 3) & 0x7;
+    uint8_t src = opcode & 0x7;
+
+    if (opcode == 0x00) {
+        // NOP
+    } else if ((opcode & 0xC7) == 0x06 && dst != 6) {
+        // LD r, d8
+        _emit_8(e, 0xB8);       // mov eax, d8
+        _emit_32(e, (uint8_t)op->operand);
+        _emit_reg_set(e, dst, RAX);
+    } else if ((opcode & 0xCF) == 0x01) {
+        // LD rr, d16
+        enum JIT_PAIR pair = (enum JIT_PAIR)(opcode >> 4);
+        _emit_rex(e, 0, pair_host[pair]);   // mov host, d16
+        _emit_8(e, 0xB8 | (pair_host[pair] & 0x7));
+        _emit_32(e, op->operand);
+        e->loaded |= 1 << pair;
+        e->dirty |= 1 << pair;
+    } else if ((opcode & 0xC7) == 0x03) {
+        // INC rr, DEC rr
+        _emit_pair_step(e, (enum JIT_PAIR)(opcode >> 4), opcode & 0x08);
+    } else if (opcode >= 0x40 && opcode < 0x80 && dst != 6 && src != 6) {
+        // LD r, r
+        if (dst != src) {
+            _emit_reg_get(e, RAX, src);
+            _emit_reg_set(e, dst, RAX);
+        }
+#ifndef MY_GB_EAGER_FLAGS
+    } else if ((opcode & 0xC6) == 0x04 && dst != 6) {
+        // INC r, DEC r
+        _emit_inc_dec(e, dst, opcode & 0x1);
+    } else if (opcode >= 0x80 && opcode < 0xC0 && dst != 1 && dst != 3) {
+        // ALU A, r
+        _emit_reg_get(e, RCX, src);
+        _emit_alu(e, dst);
+    } else if ((opcode & 0xC7) == 0xC6 && dst != 1 && dst != 3) {
+        // ALU A, d8
+        _emit_8(e, 0xB9);       // mov ecx, d8
+        _emit_32(e, (uint8_t)op->operand);
+        _emit_alu(e, dst);
+#endif
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+int my_gb_jit_construct(struct gb_machine *gb)
+{
+    if (gb->cpu.jit.arena)
+        return 0;
+#ifdef _WIN32
+    gb->cpu.jit.arena = (uint8_t *)VirtualAlloc(NULL, JIT_ARENA_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+    gb->cpu.jit.arena = (uint8_t *)mmap(NULL, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (gb->cpu.jit.arena == (uint8_t *)MAP_FAILED)
+        gb->cpu.jit.arena = NULL;
+#endif
+    gb->cpu.jit.used = 0;
+    return gb->cpu.jit.arena ? 0 : -1;
+}
+
+void my_gb_jit_destruct(struct gb_machine *gb)
+{
+    if (gb->cpu.jit.arena == NULL)
+        return;
+#ifdef _WIN32
+    VirtualFree(gb->cpu.jit.arena, 0, MEM_RELEASE);
+#else
+    munmap(gb->cpu.jit.arena, JIT_ARENA_SIZE);
+#endif
+    gb->cpu.jit.arena = NULL;
+}
+
+void my_gb_jit_reset(struct gb_machine *gb)
+{
+    gb->cpu.jit.used = 0;
+}
+
+my_gb_native_block my_gb_jit_compile(struct gb_machine *gb, const struct gb_block *block,
+    const my_gb_op_handler handlers[0x100])
+{
+    struct emitter e;
+    uint32_t cycles_pending = 0;
+    uint32_t pc_pending = 0;
+    uint16_t pc = 0;
+    // slow paths of the memory ops, emitted after the block
+    struct {
+        uint32_t patch;
+        uint32_t cycles_pending;
+        uint8_t dirty;
+    } slow[BLOCK_MAX_OPS];
+
+    if (gb->cpu.jit.arena == NULL || gb->cpu.jit.used + JIT_BLOCK_MAX_BYTES > JIT_ARENA_SIZE)
+        return NULL;
+    e.code = gb->cpu.jit.arena + gb->cpu.jit.used;
+    e.size = 0;
+    e.loaded = 0;
+    e.dirty = 0;
+
+    _emit_8(&e, 0x53);          // push rbx
+    _emit_8(&e, 0x55);          // push rbp
+    _emit_8(&e, 0x41);          // push r12
+    _emit_8(&e, 0x54);
+    _emit_8(&e, 0x41);          // push r13
+    _emit_8(&e, 0x55);
+    _emit_8(&e, 0x41);          // push r14
+    _emit_8(&e, 0x56);
+    _emit_8(&e, 0x41);          // push r15
+    _emit_8(&e, 0x57);
+    _emit_8(&e, 0x48);          // sub rsp, 40(shadow space of win64, keeps alignment)
+    _emit_8(&e, 0x83);
+    _emit_8(&e, 0xEC);
+    _emit_8(&e, 0x28);
+    _emit_8(&e, 0x48);          // mov rbx, rdi(rcx)
+    _emit_8(&e, 0x89);
+#ifdef _WIN32
+    _emit_8(&e, 0xC0 | (RCX << 3) | 3);
+#else
+    _emit_8(&e, 0xC0 | (7 << 3) | 3);
+#endif
+
+    for (uint32_t i = 0; i < block->count; ++i) {
+        const struct gb_micro_op *op = &block->ops[i];
+        // registers to write back on the slow path, as they were before the op
+        uint8_t dirty = e.dirty;
+
+        slow[i].patch = 0;
+        pc = op->pc + op->length;
+        pc_pending = 1;
+        if (op->opcode == 0xC3) {
+            // JP a16
+            pc = op->operand;
+        } else if (_emit_memory_op(&e, op, &slow[i].patch)) {
+            slow[i].cycles_pending = cycles_pending;
+            slow[i].dirty = dirty;
+        } else if (!_emit_register_op(&e, op)) {
+            _emit_op_handler(&e, op, cycles_pending, handlers);
+            cycles_pending = 0;
+            pc_pending = 0;
+            if (i + 1 < block->count)
+                _emit_write_check(&e, i + 1);
+            continue;
+        }
+        cycles_pending += op->cycles;
+    }
+    _emit_spill(&e, e.dirty);
+    _emit_clock_add(&e, cycles_pending);
+    if (pc_pending)
+        _emit_store_16(&e, OFFSET(cpu.PC), pc);
+    _emit_return(&e, block->count);
+
+    for (uint32_t i = 0; i < block->count; ++i) {
+        if (slow[i].patch == 0)
+            continue;
+        // jz rel32 is relative to the end of the jump
+        uint32_t relative = e.size - (slow[i].patch + 4);
+        for (uint32_t k = 0; k < 4; ++k)
+            e.code[slow[i].patch + k] = (uint8_t)(relative >> (k * 8));
+        e.dirty = slow[i].dirty;
+        _emit_op_handler(&e, &block->ops[i], slow[i].cycles_pending, handlers);
+        _emit_return(&e, i + 1);
+    }
+
+    gb->cpu.jit.used += (e.size + 15) & ~15u;
+    return (my_gb_native_block)(void *)e.code;
+}
+
+#else
+
+int my_gb_jit_construct(struct gb_machine *gb)
+{
+    return -1;
+}
+
+void my_gb_jit_destruct(struct gb_machine *gb)
+{
+}
+
+void my_gb_jit_reset(struct gb_machine *gb)
+{
+}
+
+my_gb_native_block my_gb_jit_compile(struct gb_machine *gb, const struct gb_block *block,
+    const my_gb_op_handler handlers[0x100])
+{
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+#ifndef _MY_GB_JIT_H_
+#define _MY_GB_JIT_H_
+
+#include<stdint.h>
+
+struct gb_machine;
+struct gb_block;
+
+/*
+ * Native code backend of the cpu, x86-64 hosts only.
+ * A block entered JIT_HOT_ENTRIES times is translated into a host function
+ * running its ops in a row: loads, ALU ops on A, INC/DEC and JP a16 are
+ * emitted inline, other ops call the handler of the interpreter with PC,
+ * operand and clock set up as the interpreter does.
+ * The register pairs live in host registers for the length of the block,
+ * they are written back to gb before each handler call and on every exit.
+ * The block returns early when a handler ran into _address_write_slow,
+ * which may have scheduled an event or written the code of the block.
+ * Native blocks are only entered when the whole block fits before the
+ * deadline, so the cycle budget is checked once per block by the cpu.
+ * Define MY_GB_NO_JIT to leave the backend out.
+ */
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(MY_GB_NO_JIT)
+#define MY_GB_JIT
+#endif
+
+#define JIT_ARENA_SIZE (1024 * 1024)
+#define JIT_HOT_ENTRIES 8
+
+// Runs a whole block, returns number of ops executed.
+typedef uint32_t (*my_gb_native_block)(struct gb_machine *gb);
+
+typedef uint32_t (*my_gb_op_handler)(struct gb_machine *gb);
+
+struct gb_jit {
+    uint8_t *arena;     // executable memory, NULL while the backend is off
+    uint32_t used;
+};
+
+// Allocate the executable arena, return -1 when the host cannot run native code.
+int my_gb_jit_construct(struct gb_machine *gb);
+
+void my_gb_jit_destruct(struct gb_machine *gb);
+
+// Forget every native block, the blocks of the cpu must drop their pointers too.
+void my_gb_jit_reset(struct gb_machine *gb);
+
+// Translate block calling handlers for the ops not emitted inline.
+// Return NULL when the arena is full.
+my_gb_native_block my_gb_jit_compile(struct gb_machine *gb, const struct gb_block *block,
+    const my_gb_op_handler handlers[0x100]);
+
+#endif
@@ -0,0 +1,147 @@
+#include"pixel.h"
+#include<string.h>
+
+#ifdef MY_GB_SIMD
+#include<immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include<intrin.h>
+#endif
+#endif
+
+// Bit 7 - i of plane goes to byte i, the multiply puts copies of plane
+// 9 bits apart so that each byte gets its bit on top, nothing carries.
+static inline uint64_t _spread(uint8_t plane)
+{
+    return (((uint64_t)plane * 0x8040201008040201ULL) & 0x8080808080808080ULL) >> 7;
+}
+
+static void _tile_line_scalar(uint8_t low, uint8_t high, uint8_t pixels[8], uint8_t flipped[8])
+{
+    uint64_t row = _spread(low) | _spread(high) << 1;
+    for (uint32_t i = 0; i < 8; ++i) {
+        uint8_t c = (uint8_t)(row >> (i * 8));
+        pixels[i] = c;
+        flipped[7 - i] = c;
+    }
+}
+
+static void _line_expand_scalar(uint32_t *line, const uint8_t *indexes, uint32_t length,
+    const uint32_t palette[4])
+{
+    for (uint32_t x = 0; x < length; ++x)
+        line[x] = palette[indexes[x]];
+}
+
+#ifdef MY_GB_SIMD
+// Kernels are built for their instruction set only, they run after a check of the cpu.
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET(features) __attribute__((target(features)))
+#define BSWAP_64(x) __builtin_bswap64(x)
+#else
+#define TARGET(features)
+#define BSWAP_64(x) _byteswap_uint64(x)
+#endif
+
+enum CPU_FEATURE {
+    CPU_SSSE3 = 0x1,
+    CPU_AVX2 = 0x2,
+    CPU_BMI2 = 0x4,
+};
+
+static uint32_t _cpu_features(void)
+{
+    uint32_t features = 0;
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3"))
+        features |= CPU_SSSE3;
+    // also checks the OS saves the ymm registers
+    if (__builtin_cpu_supports("avx2"))
+        features |= CPU_AVX2;
+    if (__builtin_cpu_supports("bmi2"))
+        features |= CPU_BMI2;
+#elif defined(_MSC_VER)
+    int info[4];
+    uint32_t avx;
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return 0;
+    __cpuid(info, 1);
+    if (info[2] & (1 << 9))
+        features |= CPU_SSSE3;
+    // AVX with OSXSAVE, and the OS saves xmm and ymm registers
+    avx = (info[2] & (1 << 28)) && (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    if (avx && (info[1] & (1 << 5)))
+        features |= CPU_AVX2;
+    if (info[1] & (1 << 8))
+        features |= CPU_BMI2;
+#endif
+    return features;
+}
+
+// pdep puts bit i of a plane into byte i, that is the x flipped line.
+// It is slow on AMD before Zen 3, but tiles are seldom decoded.
+TARGET("bmi2")
+static void _tile_line_bmi2(uint8_t low, uint8_t high, uint8_t pixels[8], uint8_t flipped[8])
+{
+    uint64_t row = _pdep_u64(low, 0x0101010101010101ULL) | _pdep_u64(high, 0x0202020202020202ULL);
+    memcpy(flipped, &row, 8);
+    row = BSWAP_64(row);
+    memcpy(pixels, &row, 8);
+}
+
+// 4 pixels a step: each index is copied to the 4 bytes of its pixel and
+// scaled to the offset of its color, which is then shuffled out of the palette.
+TARGET("ssse3")
+static void _line_expand_ssse3(uint32_t *line, const uint8_t *indexes, uint32_t length,
+    const uint32_t palette[4])
+{
+    const __m128i colors = _mm_loadu_si128((const __m128i *)palette);
+    const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+    const __m128i bytes = _mm_setr_epi8(0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3);
+    uint32_t x = 0;
+    for (; x + 4 <= length; x += 4) {
+        int32_t four;
+        __m128i offsets;
+        memcpy(&four, indexes + x, 4);
+        offsets = _mm_shuffle_epi8(_mm_cvtsi32_si128(four), spread);
+        // indexes are below 4, the shift does not cross bytes
+        offsets = _mm_or_si128(_mm_slli_epi32(offsets, 2), bytes);
+        _mm_storeu_si128((__m128i *)(line + x), _mm_shuffle_epi8(colors, offsets));
+    }
+    _line_expand_scalar(line + x, indexes + x, length - x, palette);
+}
+
+// 8 pixels a step, the indexes pick 32 bits colors directly.
+TARGET("avx2")
+static void _line_expand_avx2(uint32_t *line, const uint8_t *indexes, uint32_t length,
+    const uint32_t palette[4])
+{
+    // upper lane is never picked
+    const __m256i colors = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)palette));
+    uint32_t x = 0;
+    for (; x + 8 <= length; x += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(indexes + x)));
+        _mm256_storeu_si256((__m256i *)(line + x), _mm256_permutevar8x32_epi32(colors, index));
+    }
+    _line_expand_scalar(line + x, indexes + x, length - x, palette);
+}
+#endif
+
+void my_gb_pixel_select(struct gb_pixel_kernels *kernels, uint32_t simd)
+{
+    kernels->tile_line = _tile_line_scalar;
+    kernels->line_expand = _line_expand_scalar;
+#ifdef MY_GB_SIMD
+    if (simd) {
+        uint32_t features = _cpu_features();
+        if (features & CPU_BMI2)
+            kernels->tile_line = _tile_line_bmi2;
+        if (features & CPU_AVX2)
+            kernels->line_expand = _line_expand_avx2;
+        else if (features & CPU_SSSE3)
+            kernels->line_expand = _line_expand_ssse3;
+    }
+#endif
+}
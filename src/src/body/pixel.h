@@ -0,0 +1,36 @@
+#pragma once
+#ifndef _MY_GB_PIXEL_H_
+#define _MY_GB_PIXEL_H_
+
+#include<stdint.h>
+
+/*
+ * Innermost kernels of the screen, picked once for the host cpu.
+ * tile_line decodes the low and high bit planes of a tile line into
+ * 8 color indexes(0-3), leftmost pixel first, and the same indexes
+ * flipped on x.
+ * line_expand turns length color indexes into colors through a palette
+ * of 4 colors.
+ * x86-64 hosts decode with BMI2 pdep and expand with AVX2 or SSSE3
+ * shuffles when the cpu has them, every other host runs the scalar
+ * kernels, which spread the bits of a plane with one multiply.
+ * Define MY_GB_NO_SIMD to keep to the scalar kernels.
+ */
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(MY_GB_NO_SIMD)
+#define MY_GB_SIMD
+#endif
+
+typedef void (*my_gb_tile_line_kernel)(uint8_t low, uint8_t high, uint8_t pixels[8], uint8_t flipped[8]);
+
+typedef void (*my_gb_line_expand_kernel)(uint32_t *line, const uint8_t *indexes, uint32_t length,
+    const uint32_t palette[4]);
+
+struct gb_pixel_kernels {
+    my_gb_tile_line_kernel tile_line;
+    my_gb_line_expand_kernel line_expand;
+};
+
+// Pick the fastest kernels the host runs, the scalar ones when simd is 0.
+void my_gb_pixel_select(struct gb_pixel_kernels *kernels, uint32_t simd);
+
+#endif
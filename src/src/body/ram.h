@@ -1,19 +1,25 @@
-#pragma once
-#ifndef _MY_GB_RAM_H_
-#define _MY_GB_RAM_H_
-
-#include<stdint.h>
-
-#define RAM_OFFSET_VRAM (0)
-#define RAM_OFFSET_INTERNAL_RAM (8 * 1024)
-#define RAM_OFFSET_OAM (8 * 1024 + 8 * 1024)
-#define RAM_OFFSET_HRAM (8 * 1024 + 8 * 1024 + 0xA0)
-
-uint8_t* my_gb_ram_get(void);
-
-int my_gb_ram_construct(void);
-
-void my_gb_ram_destruct(void);
-
-#endif
-
+#pragma once
+#ifndef _MY_GB_RAM_H_
+#define _MY_GB_RAM_H_
+
+#include<stdint.h>
+
+#define RAM_OFFSET_VRAM (0)
+#define RAM_OFFSET_INTERNAL_RAM (8 * 1024)
+#define RAM_OFFSET_OAM (8 * 1024 + 8 * 1024)
+#define RAM_OFFSET_HRAM (8 * 1024 + 8 * 1024 + 0xA0)
+
+struct gb_machine;
+
+struct gb_ram {
+    uint8_t *ram;
+};
+
+uint8_t* my_gb_ram_get(struct gb_machine *gb);
+
+int my_gb_ram_construct(struct gb_machine *gb);
+
+void my_gb_ram_destruct(struct gb_machine *gb);
+
+#endif
+
@@ -0,0 +1,72 @@
+#include"scheduler.h"
+#include"cpu.h"
+#include"../machine.h"
+
+static void _deadline_update(struct gb_machine *gb)
+{
+    gb->scheduler.deadline_next = SCHEDULER_NEVER;
+    for (int i = 0; i < EVENT_NUM; ++i) {
+        if (gb->scheduler.deadlines[i] < gb->scheduler.deadline_next)
+            gb->scheduler.deadline_next = gb->scheduler.deadlines[i];
+    }
+    gb->scheduler.deadline = gb->scheduler.deadline_next < gb->scheduler.run_end ? gb->scheduler.deadline_next : gb->scheduler.run_end;
+}
+
+int my_gb_scheduler_construct(struct gb_machine *gb)
+{
+    gb->scheduler.clock = 0;
+    gb->scheduler.run_end = 0;
+    for (int i = 0; i < EVENT_NUM; ++i) {
+        gb->scheduler.deadlines[i] = SCHEDULER_NEVER;
+        gb->scheduler.handlers[i] = 0;
+    }
+    _deadline_update(gb);
+    return 0;
+}
+
+void my_gb_scheduler_destruct(struct gb_machine *gb)
+{
+}
+
+void my_gb_scheduler_register(struct gb_machine *gb, enum SCHEDULER_EVENT event, my_gb_event_handler handler)
+{
+    gb->scheduler.handlers[event] = handler;
+}
+
+void my_gb_scheduler_schedule(struct gb_machine *gb, enum SCHEDULER_EVENT event, uint64_t deadline)
+{
+    uint64_t deadline_old = gb->scheduler.deadlines[event];
+    gb->scheduler.deadlines[event] = deadline;
+    if (deadline < gb->scheduler.deadline_next) {
+        // may be called by cpu in the middle of a run, let it stop earlier
+        gb->scheduler.deadline_next = deadline;
+        if (deadline < gb->scheduler.deadline)
+            gb->scheduler.deadline = deadline;
+    } else if (deadline_old == gb->scheduler.deadline_next) {
+        _deadline_update(gb);
+    }
+}
+
+void my_gb_scheduler_run(struct gb_machine *gb, uint32_t cycles)
+{
+    // last run may overshoot its end by part of an instruction
+    gb->scheduler.run_end += cycles;
+    _deadline_update(gb);
+    while (gb->scheduler.clock < gb->scheduler.run_end) {
+        if (gb->scheduler.clock < gb->scheduler.deadline)
+            my_gb_cpu_run(gb);
+
+        // dispatch every event due, handlers may schedule again
+        while (gb->scheduler.deadline_next <= gb->scheduler.clock) {
+            for (int i = 0; i < EVENT_NUM; ++i) {
+                uint64_t deadline = gb->scheduler.deadlines[i];
+                if (deadline <= gb->scheduler.clock) {
+                    gb->scheduler.deadlines[i] = SCHEDULER_NEVER;
+                    if (gb->scheduler.handlers[i])
+                        gb->scheduler.handlers[i](gb, deadline);
+                }
+            }
+            _deadline_update(gb);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef _MY_GB_SCHEDULER_H_
+#define _MY_GB_SCHEDULER_H_
+
+#include<stdint.h>
+
+// Every subsystem owns at most one pending event.
+enum SCHEDULER_EVENT {
+    EVENT_SCREEN,       // screen mode change
+    EVENT_TIMER,        // TIMA overflow
+    EVENT_SOUND,        // frame sequencer tick
+    EVENT_SERIAL,       // serial transfer completion
+    EVENT_DMA,          // OAM DMA releases the bus
+    EVENT_NUM,
+};
+
+#define SCHEDULER_NEVER UINT64_MAX
+
+struct gb_machine;
+
+// Called with the cycle the event was scheduled at, which can be slightly
+// earlier than clock because the cpu finishes its last instruction.
+// Periodic events should reschedule from it to avoid drifting.
+typedef void (*my_gb_event_handler)(struct gb_machine *gb, uint64_t deadline);
+
+struct gb_scheduler {
+    // Machine cycles since power on, advanced by cpu as instructions retire.
+    uint64_t clock;
+    // Earliest pending event (or end of current run), cpu runs until reaching it.
+    uint64_t deadline;
+
+    uint64_t run_end;    // end of current my_gb_scheduler_run()
+    uint64_t deadline_next;
+    uint64_t deadlines[EVENT_NUM];
+    my_gb_event_handler handlers[EVENT_NUM];
+};
+
+int my_gb_scheduler_construct(struct gb_machine *gb);
+
+void my_gb_scheduler_destruct(struct gb_machine *gb);
+
+void my_gb_scheduler_register(struct gb_machine *gb, enum SCHEDULER_EVENT event, my_gb_event_handler handler);
+
+// Replace the pending deadline of the event, SCHEDULER_NEVER cancels it.
+void my_gb_scheduler_schedule(struct gb_machine *gb, enum SCHEDULER_EVENT event, uint64_t deadline);
+
+// Run the machine for cycles, dispatching every event coming due.
+void my_gb_scheduler_run(struct gb_machine *gb, uint32_t cycles);
+
+#endif
@@ -1,374 +1,409 @@
-#include"screen.h"
-#include"cpu.h"
-#include"ram.h"
-#include"../../dep/SCG/scg.h"
-#include<stdint.h>
-
-// scale between real window size and gameboy screen size
-#define SCALE_RATIO 2
-
-// virtual gameboy underlaying screen buffer size
-#define SCREEN_BUFFER_SQUARE_WIDTH 256
-
-#define TILE_SQUARE_WIDTH 8
-#define SIZEOF_TILE 16
-#define SIZEOF_TILE_LINE 2
-
-// virtual gameboy screen buffer size(not directly seen buffer) 
-// screen buffer which will be seen is scg_back_buffer 
-#define GAMEBOY_SCREEN_WIDTH 160
-#define GAMEBOY_SCREEN_HEIGHT 144
-
-#define OAM_SEARCH_CYCLES 20
-#define PIXEL_TRANSFER_CYCLES 43
-#define HBLANK_CYCLES 51
-// We split V blank period into 10 small parts
-// because LY need to be changed during it.
-#define VBLANK_CYCLES 114
-#define VBLANK_TIMES 10
-
-// My Debug LOL
-#define MDEBUG
-
-uint8_t LCDC;
-uint8_t STAT;
-uint8_t SCY;
-uint8_t SCX;
-uint8_t LY;
-uint8_t LYC;
-uint8_t DMA;
-uint8_t BGP;
-uint8_t OBP0;
-uint8_t OBP1;
-uint8_t WY;
-uint8_t WX;
-
-static uint8_t * ram;
-static uint32_t screen_buffer[SCREEN_BUFFER_SQUARE_WIDTH * SCREEN_BUFFER_SQUARE_WIDTH];
-enum SCREEN_STATE {
-    SCREEN_STATE_HBLANK,
-    SCREEN_STATE_VBLANK,
-    SCREEN_STATE_OAM_SEARCH,
-    SCREEN_STATE_PIXEL_TRANSFER,
-};
-static struct {
-    enum SCREEN_STATE state_next;
-    int cycles_remain;
-    // do a copy here in case they changes between pixel transfer and screen mapping
-    // we do this compensation because our screen is not implemented like GB screen and draw line by line
-    uint8_t SCX_pixel_transfer;            
-    uint8_t SCY_pixel_transfer;
-    uint8_t line_current;   // between 0 and 153
-} screen_context;
-
-int my_gb_screen_construct(WNDPROC callback)
-{
-    screen_context.state_next = SCREEN_STATE_OAM_SEARCH;
-    screen_context.cycles_remain = 0;
-    screen_context.line_current = 0;
-	if (scg_create_window(
-#ifdef MDEBUG
-        // When debug, show full screen buffer.
-		SCREEN_BUFFER_SQUARE_WIDTH * SCALE_RATIO,
-		SCREEN_BUFFER_SQUARE_WIDTH * SCALE_RATIO,
-#else
-		GAMEBOY_SCREEN_WIDTH * SCALE_RATIO,
-		GAMEBOY_SCREEN_HEIGHT * SCALE_RATIO,
-#endif
-		_T("My Game Boy"),
-		callback) == -1) {
-		return -1;
-	}
-	return 0;
-}
-
-void my_gb_screen_destruct(void)
-{
-	scg_close_window();
-}
-
-int my_gb_screen_link_ram(uint8_t* _ram)
-{
-	ram = _ram;
-	return 0;
-}
-
-void my_gb_cpu_link_screen(void)
-{
-	// pretend to link cpu
-    // we can use cpu functions directly
-}
-
-static inline uint32_t color_translate(uint16_t tile_line, uint8_t bit_index)
-{
-    // to get color of bit 2
-    //      |-|
-    // 11000|1|10 -> $C6 (low byte of tile line)
-    // 00000|0|00 -> $00 (high byte of tile line)
-    //      |-|
-    // so color is 0b01 = 1
-    uint16_t c = ((tile_line >> bit_index) & 0x1) | ((tile_line >> (bit_index + 7)) & 0x2);
-    switch (c) {
-    case 0x0:
-        return 0xE0F8CF;
-    case 0x1:
-        return 0x86C06C;
-    case 0x2:
-        return 0x306850;
-    case 0x3:
-        return 0x072821;
-    }
-    return 0;
-}
-
-/*
- * Gameboy lcdc mode changing sequence is like this:
- *   2233330000022333300000....111111
- * 2: OAM search        (20 clocks)
- * 3: pixel transfer    (43 clocks)
- * 0: H blank           (51 clocks)
- * 1: V blank           (10 lines 10 * 114 clocks)
- *
- *  Total clock count equals to 114 * 154 = 17556 clocks.
- *  So refresh rate is 1024 * 1024 / 17556 = 59.7275.
- */
-
-static void _oam_search(uint8_t line_current)
-{
-	// Change LCDC STAT mode to 2
-	STAT = (STAT & (~0x3)) | 0x2;
-
-	// Don't need really search for OAM
-
-	// If LY == LYC
-	if (screen_context.line_current == LYC) {
-		// Set bit 2(coincidence flag)
-		STAT |= 0x1 << 2;
-		// if STAT register bit 6(coincidence interruption enable) is set
-        // trying to cause interruption
-		if ((STAT << 1) >> 6)
-			my_gb_cpu_on_interruption(INT_LCDC_STATUS);
-	} else {
-		// Reset bit 2(coincidence flag)
-		STAT &= ~(0x1 << 2);
-	}
-
-	// If bit 5(enable OAM search interruption) is enabled
-	if ((STAT << 2) >> 5)
-		my_gb_cpu_on_interruption(INT_LCDC_STATUS);
-
-}
-
-static void _pixel_transfer(uint8_t line_current)
-{
-
-    screen_context.SCX_pixel_transfer = SCX;
-    screen_context.SCY_pixel_transfer = SCY;
-	// change lcdc mode to 3
-	STAT = (STAT & (~0x3)) | 0x3;
-
-	// draw a line by accessing V-RAM and OAM
-    uint16_t sprite_tile_data_pt;
-    uint16_t bg_wnd_tile_data_pt;
-    uint16_t bg_tile_map_pt;
-    uint16_t wnd_tile_map_pt;
-    uint16_t sprite_tile_map_pt;
-
-    // sprite map and tile data address is fixed
-    sprite_tile_data_pt = 0x8000;
-    sprite_tile_map_pt = 0xFE00;
-
-    // extract this bit because bit 4 will be used in determining offset
-    uint8_t lcdc_bit0 = (LCDC) & 0x1;
-    uint8_t lcdc_bit1 = (LCDC >> 1) & 0x1;
-    uint8_t lcdc_bit2 = (LCDC >> 2) & 0x1;
-    uint8_t lcdc_bit3 = (LCDC >> 3) & 0x1;
-    uint8_t lcdc_bit4 = (LCDC >> 4) & 0x1;
-    uint8_t lcdc_bit5 = (LCDC >> 5) & 0x1;
-    uint8_t lcdc_bit6 = (LCDC >> 6) & 0x1;
-
-	if (lcdc_bit4) {
-		bg_wnd_tile_data_pt = 0x8000;
-	} else {
-		bg_wnd_tile_data_pt = 0x9000;
-	}
-	if (lcdc_bit3) {
-        bg_tile_map_pt = 0x9C00;    // 0x9C00~0x9FFF
-    } else {
-        bg_tile_map_pt = 0x9800;    // 0x9800~0x9BFF
-    }
-	if (lcdc_bit6) {
-        wnd_tile_map_pt = 0x9C00;   // same with above
-    } else {
-        wnd_tile_map_pt = 0x9800;
-    }
-
-    // drawing below is drawing to mapped line of 256 * 256 gameboy virtual screen buffer 
-    // rather than drawing to 160 * 144 buffer
-    // draw background 
-    if (lcdc_bit0) {
-        uint8_t y_real = (screen_context.line_current + SCY);       // real y index in screen buffer
-        uint8_t y_tile = y_real / TILE_SQUARE_WIDTH;                // line of tile data 
-        uint8_t y_tile_offset = y_real % TILE_SQUARE_WIDTH;         // offset of tile data 
-        for (uint8_t x_tile = 0; x_tile < (SCREEN_BUFFER_SQUARE_WIDTH / TILE_SQUARE_WIDTH); ++x_tile) {
-            // draw a chunk
-            uint8_t tile_index = ram[bg_tile_map_pt - 0x8000 + RAM_OFFSET_VRAM + x_tile + y_tile * (SCREEN_BUFFER_SQUARE_WIDTH / TILE_SQUARE_WIDTH)];
-            uint16_t tile_address;
-            // With different background window tile data address,
-            // different addressing method are used.
-            tile_address = bg_wnd_tile_data_pt - 0x8000 + RAM_OFFSET_VRAM + y_tile_offset * SIZEOF_TILE_LINE;
-            if (lcdc_bit4 || tile_index <= 127)
-                tile_address += tile_index * SIZEOF_TILE;
-            else
-                tile_address -= tile_index * SIZEOF_TILE;
-            uint16_t line_data = ram[tile_address];
-            for (uint8_t px = 0; px < TILE_SQUARE_WIDTH; ++px) {
-                uint8_t x_real = px + x_tile * TILE_SQUARE_WIDTH;
-                screen_buffer[x_real + y_real * SCREEN_BUFFER_SQUARE_WIDTH] = color_translate(line_data, TILE_SQUARE_WIDTH - 1 - px);
-            }
-        }
-    }
-    /*
-     * I decided to not do branching between draw background or window,
-     * just draw the background and then draw the window on the top
-     * we will achieve the same result 
-     * (which can be proved because no interruption need to be triggered during scanline FIFO)
-     */
-    // draw window
-    if (lcdc_bit5) {
-        for (uint8_t x_tile = 0; x_tile < (SCREEN_BUFFER_SQUARE_WIDTH / TILE_SQUARE_WIDTH); ++x_tile) {
-            // draw a chunk
-            // attention windows x need to -7
-        }
-    }
-    // draw sprite
-    if (lcdc_bit1) {
-        for (uint8_t i = 0; i < 0xA0; ++i) {
-            // get sprite size
-            if (lcdc_bit2);
-        }
-    }
-
-    // Here all the data was transferred to LCD driver,
-	// so set LY to current line(use this logic according to documentation)
-	LY = screen_context.line_current;
-}
-
-static void _h_blank(uint8_t line_current)
-{
-    // CPU just idling
-
-	// change lcdc mode to 0
-	STAT = (STAT & (~0x3)) | 0x0;
-
-	// if bit 3(h blank interruption) is enabled
-	if ((STAT << 4) >> 3)
-		my_gb_cpu_on_interruption(INT_LCDC_STATUS);
-}
-
-static void _v_blank(uint8_t line_currrent)
-{
-    // CPU just idling
-
-	// change lcdc mode to 1
-	STAT = (STAT & (~0x3)) | 0x1;
-
-	// if bit 4(v blank interruption is enabled)
-	if ((STAT << 3) >> 4)
-		my_gb_cpu_on_interruption(INT_VBLANK);
-
-    // change LY
-    LY = line_currrent;
-}
-
-#ifdef MDEBUG
-// When debug, show full screen buffer.
-static void _screen_mapping(void)
-{
-    for (uint32_t y = 0; y < SCREEN_BUFFER_SQUARE_WIDTH; ++y) {
-        for (uint32_t x = 0; x < SCREEN_BUFFER_SQUARE_WIDTH; ++x) {
-            uint32_t color = screen_buffer[x + y * SCREEN_BUFFER_SQUARE_WIDTH];
-            for (uint32_t px_y = 0; px_y < SCALE_RATIO; ++px_y) {
-                for (uint32_t px_x = 0; px_x < SCALE_RATIO; ++px_x) {
-                    scg_back_buffer[px_x + x * SCALE_RATIO + px_y + (y * SCALE_RATIO) * (SCREEN_BUFFER_SQUARE_WIDTH * SCALE_RATIO)] = color;
-                }
-            }
-        }
-    }
-
-    scg_refresh();
-}
-#else
-// put gameboy screen buffer to back buffer and swap buffer
-// currently not refresh gameboy line by line 
-// actually for reducing Bitblt count, 
-// we use the strategy that only refresh screen only during V blank
-// may try to use fresh line by line in the future
-static void _screen_mapping(void)
-{
-	// copy screen buffer to windows dib(device independent bitmaps) buffer
-    // (according to SCX and SCY map pixels from 256 * 256 to 160 * 144)
-    for (uint32_t y = 0; y < GAMEBOY_SCREEN_HEIGHT; ++y) {
-        for (uint32_t x = 0; x < GAMEBOY_SCREEN_WIDTH; ++x) {
-            uint32_t buffer_x = (x + screen_context.SCX_pixel_transfer) % SCREEN_BUFFER_SQUARE_WIDTH;
-            uint32_t buffer_y = (y + screen_context.SCY_pixel_transfer) % SCREEN_BUFFER_SQUARE_WIDTH;
-            int buffer_index = buffer_x + buffer_y * SCREEN_BUFFER_SQUARE_WIDTH;
-            uint32_t color = screen_buffer[buffer_index];
-            for (uint32_t px_y = 0; px_y < SCALE_RATIO; ++px_y) {
-                for (uint32_t px_x = 0; px_x < SCALE_RATIO; ++px_x) {
-                    scg_back_buffer[px_x + x * SCALE_RATIO + (px_y + y * SCALE_RATIO) * (GAMEBOY_SCREEN_WIDTH * SCALE_RATIO)] = color;
-                }
-            }
-        }
-    }
-
-	scg_refresh();
-}
-#endif
-
-uint32_t my_gb_screen_run(uint32_t cycles_want)
-{
-    if (LCDC >> 7) {
-        uint32_t cycles = 0;
-        while (cycles < cycles_want) {
-            switch (screen_context.state_next) {
-            case SCREEN_STATE_HBLANK:
-                cycles += HBLANK_CYCLES;
-                _h_blank(screen_context.line_current);
-                ++screen_context.line_current;
-                if (screen_context.line_current > GAMEBOY_SCREEN_HEIGHT - 1) {
-                    screen_context.state_next = SCREEN_STATE_VBLANK;
-                } else {
-                    screen_context.state_next = SCREEN_STATE_OAM_SEARCH;
-                }
-                break;
-            case SCREEN_STATE_VBLANK:
-                cycles += VBLANK_CYCLES;
-                _v_blank(screen_context.line_current);
-                ++screen_context.line_current;
-                if (screen_context.line_current > 153) {
-                    screen_context.state_next = SCREEN_STATE_OAM_SEARCH;
-                    screen_context.line_current = 0;
-                    _screen_mapping();
-                } else {
-                    screen_context.state_next = SCREEN_STATE_VBLANK;
-                }
-                break;
-            case SCREEN_STATE_OAM_SEARCH:
-                cycles += OAM_SEARCH_CYCLES;
-                _oam_search(screen_context.line_current);
-                screen_context.state_next = SCREEN_STATE_PIXEL_TRANSFER;
-                break;
-            case SCREEN_STATE_PIXEL_TRANSFER:
-                cycles += PIXEL_TRANSFER_CYCLES;
-                _pixel_transfer(screen_context.line_current);
-                screen_context.state_next = SCREEN_STATE_HBLANK;
-                break;
-            }
-        }
-        return cycles - cycles_want;
-    } else {
-        return 0;
-    }
-}
-
+#include"screen.h"
+#include"cpu.h"
+#include"ram.h"
+#include"scheduler.h"
+#include"../machine.h"
+#include<stdint.h>
+#include<string.h>
+#ifdef _WIN32
+#include"../../dep/SCG/scg.h"
+#else
+// Window stubs, creating a window fails outside of Windows.
+#define _T(s) s
+static unsigned *scg_back_buffer;
+static int scg_create_window(int width, int height, const char *title, WNDPROC event_process) { return -1; }
+static void scg_close_window(void) {}
+static void scg_refresh(void) {}
+#endif
+
+// scale between real window size and gameboy screen size
+#define SCALE_RATIO 2
+
+#define SIZEOF_TILE 16
+#define SIZEOF_TILE_LINE 2
+
+#define OAM_SEARCH_CYCLES 20
+#define PIXEL_TRANSFER_CYCLES 43
+#define HBLANK_CYCLES 51
+// We split V blank period into 10 small parts
+// because LY need to be changed during it.
+#define VBLANK_CYCLES 114
+#define VBLANK_TIMES 10
+
+// 20 tiles cover the 160 pixels, one more when SCX is not a multiple of 8
+#define BG_MAP_WIDTH 32
+#define BG_LINE_TILES (GAMEBOY_SCREEN_WIDTH / TILE_SQUARE_WIDTH + 1)
+
+static void _screen_event(struct gb_machine *gb, uint64_t deadline);
+
+int my_gb_screen_construct(struct gb_machine *gb, WNDPROC callback)
+{
+    gb->screen.LCDC = 0;
+    gb->screen.STAT = 0;
+    gb->screen.SCY = 0;
+    gb->screen.SCX = 0;
+    gb->screen.LY = 0;
+    gb->screen.LYC = 0;
+    gb->screen.DMA = 0;
+    gb->screen.BGP = 0;
+    gb->screen.OBP0 = 0;
+    gb->screen.OBP1 = 0;
+    gb->screen.WY = 0;
+    gb->screen.WX = 0;
+    gb->screen.ram = 0;
+    memset(gb->screen.screen_buffer, 0, sizeof(gb->screen.screen_buffer));
+    // nothing decoded yet
+    memset(gb->screen.tile_dirty, 0xFF, sizeof(gb->screen.tile_dirty));
+    my_gb_pixel_select(&gb->screen.kernels, 1);
+    my_gb_screen_set_scheme(gb, my_gb_screen_scheme_green);
+    gb->screen.context.state_next = SCREEN_STATE_OAM_SEARCH;
+    gb->screen.context.cycles_remain = 0;
+    gb->screen.context.line_current = 0;
+    gb->screen.context.window_line = 0;
+    my_gb_scheduler_register(gb, EVENT_SCREEN, _screen_event);
+    my_gb_scheduler_schedule(gb, EVENT_SCREEN, gb->scheduler.clock);
+	gb->screen.has_window = callback != 0;
+	if (!gb->screen.has_window)
+		return 0;
+	if (scg_create_window(
+		GAMEBOY_SCREEN_WIDTH * SCALE_RATIO,
+		GAMEBOY_SCREEN_HEIGHT * SCALE_RATIO,
+		_T("My Game Boy"),
+		callback) == -1) {
+		return -1;
+	}
+	return 0;
+}
+
+void my_gb_screen_destruct(struct gb_machine *gb)
+{
+    if (gb->screen.has_window)
+        scg_close_window();
+}
+
+int my_gb_screen_link_ram(struct gb_machine *gb, uint8_t* _ram)
+{
+	gb->screen.ram = _ram;
+	return 0;
+}
+
+void my_gb_cpu_link_screen(struct gb_machine *gb)
+{
+	// pretend to link cpu
+    // we can use cpu functions directly
+}
+
+void my_gb_screen_tile_written(struct gb_machine *gb, uint16_t address, uint32_t length)
+{
+    uint32_t end = (uint32_t)address + length;
+    if (address < 0x8000)
+        address = 0x8000;
+    if (end > TILE_DATA_END)
+        end = TILE_DATA_END;
+    if (end <= address)
+        return;
+    for (uint32_t tile = (address - 0x8000) / SIZEOF_TILE; tile <= (end - 1 - 0x8000) / SIZEOF_TILE; ++tile)
+        gb->screen.tile_dirty[tile / 32] |= (uint32_t)0x1 << (tile % 32);
+}
+
+const uint32_t my_gb_screen_scheme_green[4] = { 0xE0F8CF, 0x86C06C, 0x306850, 0x072821 };
+const uint32_t my_gb_screen_scheme_gray[4] = { 0xFFFFFF, 0xAAAAAA, 0x555555, 0x000000 };
+
+// Bits 2i+1 and 2i of the register are the shade of color index i.
+static void _palette_build(struct gb_machine *gb, uint32_t palette[4], uint8_t data)
+{
+    for (uint32_t i = 0; i < 4; ++i)
+        palette[i] = gb->screen.scheme[(data >> (i * 2)) & 0x3];
+}
+
+void my_gb_screen_palette_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    switch (address) {
+    case 0xFF47:
+        gb->screen.BGP = data;
+        _palette_build(gb, gb->screen.bg_palette, data);
+        break;
+    case 0xFF48:
+        gb->screen.OBP0 = data;
+        _palette_build(gb, gb->screen.obj_palette[0], data);
+        break;
+    case 0xFF49:
+        gb->screen.OBP1 = data;
+        _palette_build(gb, gb->screen.obj_palette[1], data);
+        break;
+    }
+}
+
+void my_gb_screen_set_scheme(struct gb_machine *gb, const uint32_t scheme[4])
+{
+    memcpy(gb->screen.scheme, scheme, sizeof(gb->screen.scheme));
+    _palette_build(gb, gb->screen.bg_palette, gb->screen.BGP);
+    _palette_build(gb, gb->screen.obj_palette[0], gb->screen.OBP0);
+    _palette_build(gb, gb->screen.obj_palette[1], gb->screen.OBP1);
+}
+
+static void _tile_decode(struct gb_machine *gb, uint32_t tile)
+{
+    const uint8_t *data = gb->screen.ram + RAM_OFFSET_VRAM + tile * SIZEOF_TILE;
+    uint8_t *pixels = gb->screen.tile_cache[tile];
+    uint8_t *flipped = gb->screen.tile_cache_flip[tile];
+
+    // to get color of bit 2
+    //      |-|
+    // 11000|1|10 -> $C6 (low byte of tile line)
+    // 00000|0|00 -> $00 (high byte of tile line)
+    //      |-|
+    // so color is 0b01 = 1, bit 7 is the leftmost pixel
+    for (uint32_t y = 0; y < TILE_SQUARE_WIDTH; ++y, data += SIZEOF_TILE_LINE) {
+        gb->screen.kernels.tile_line(data[0], data[1],
+            pixels + y * TILE_SQUARE_WIDTH, flipped + y * TILE_SQUARE_WIDTH);
+    }
+    gb->screen.tile_dirty[tile / 32] &= ~((uint32_t)0x1 << (tile % 32));
+}
+
+// Decoded tile of a tile index, tile_data_pt being 0x8000 or 0x9000.
+static inline const uint8_t *_tile_cached(struct gb_machine *gb, uint16_t tile_data_pt, uint8_t tile_index)
+{
+    // With 0x9000 as tile data address, tile index is signed.
+    uint32_t tile = tile_data_pt == 0x8000 ? tile_index : (uint32_t)(256 + (int8_t)tile_index);
+    if (gb->screen.tile_dirty[tile / 32] & ((uint32_t)0x1 << (tile % 32)))
+        _tile_decode(gb, tile);
+    return gb->screen.tile_cache[tile];
+}
+
+/*
+ * Gameboy lcdc mode changing sequence is like this:
+ *   2233330000022333300000....111111
+ * 2: OAM search        (20 clocks)
+ * 3: pixel transfer    (43 clocks)
+ * 0: H blank           (51 clocks)
+ * 1: V blank           (10 lines 10 * 114 clocks)
+ *
+ *  Total clock count equals to 114 * 154 = 17556 clocks.
+ *  So refresh rate is 1024 * 1024 / 17556 = 59.7275.
+ */
+
+static void _oam_search(struct gb_machine *gb, uint8_t line_current)
+{
+	// Change LCDC STAT mode to 2
+	gb->screen.STAT = (gb->screen.STAT & (~0x3)) | 0x2;
+
+	// Don't need really search for OAM
+
+	// If LY == LYC
+	if (gb->screen.context.line_current == gb->screen.LYC) {
+		// Set bit 2(coincidence flag)
+		gb->screen.STAT |= 0x1 << 2;
+		// if STAT register bit 6(coincidence interruption enable) is set
+        // trying to cause interruption
+		if ((gb->screen.STAT << 1) >> 6)
+			my_gb_cpu_on_interruption(gb, INT_LCDC_STATUS);
+	} else {
+		// Reset bit 2(coincidence flag)
+		gb->screen.STAT &= ~(0x1 << 2);
+	}
+
+	// If bit 5(enable OAM search interruption) is enabled
+	if ((gb->screen.STAT << 2) >> 5)
+		my_gb_cpu_on_interruption(gb, INT_LCDC_STATUS);
+
+}
+
+// Copy line y_tile_offset of tiles of a map row, x_tile on, to indexes.
+static inline void _tile_span(struct gb_machine *gb, uint8_t *indexes, const uint8_t *map, uint8_t x_tile,
+    uint32_t tiles, uint16_t tile_data_pt, uint8_t y_tile_offset)
+{
+    for (uint32_t i = 0; i < tiles; ++i) {
+        const uint8_t *tile = _tile_cached(gb, tile_data_pt, map[(x_tile + i) % BG_MAP_WIDTH]);
+        memcpy(indexes + i * TILE_SQUARE_WIDTH, tile + y_tile_offset * TILE_SQUARE_WIDTH, TILE_SQUARE_WIDTH);
+    }
+}
+
+static void _pixel_transfer(struct gb_machine *gb, uint8_t line_current)
+{
+	// change lcdc mode to 3
+	gb->screen.STAT = (gb->screen.STAT & (~0x3)) | 0x3;
+    my_gb_cpu_lock_vram(gb, 1);
+
+	// draw a line by accessing V-RAM and OAM
+    uint16_t sprite_tile_data_pt;
+    uint16_t bg_wnd_tile_data_pt;
+    uint16_t bg_tile_map_pt;
+    uint16_t wnd_tile_map_pt;
+    uint16_t sprite_tile_map_pt;
+
+    // sprite map and tile data address is fixed
+    sprite_tile_data_pt = 0x8000;
+    sprite_tile_map_pt = 0xFE00;
+
+    // extract this bit because bit 4 will be used in determining offset
+    uint8_t lcdc_bit0 = (gb->screen.LCDC) & 0x1;
+    uint8_t lcdc_bit1 = (gb->screen.LCDC >> 1) & 0x1;
+    uint8_t lcdc_bit2 = (gb->screen.LCDC >> 2) & 0x1;
+    uint8_t lcdc_bit3 = (gb->screen.LCDC >> 3) & 0x1;
+    uint8_t lcdc_bit4 = (gb->screen.LCDC >> 4) & 0x1;
+    uint8_t lcdc_bit5 = (gb->screen.LCDC >> 5) & 0x1;
+    uint8_t lcdc_bit6 = (gb->screen.LCDC >> 6) & 0x1;
+
+	if (lcdc_bit4) {
+		bg_wnd_tile_data_pt = 0x8000;
+	} else {
+		bg_wnd_tile_data_pt = 0x9000;
+	}
+	if (lcdc_bit3) {
+        bg_tile_map_pt = 0x9C00;    // 0x9C00~0x9FFF
+    } else {
+        bg_tile_map_pt = 0x9800;    // 0x9800~0x9BFF
+    }
+	if (lcdc_bit6) {
+        wnd_tile_map_pt = 0x9C00;   // same with above
+    } else {
+        wnd_tile_map_pt = 0x9800;
+    }
+
+    // Only the tiles under the visible 160 pixels are fetched, their rows of
+    // color indexes are copied in a row, the visible part starting at the
+    // fine offset of SCX then goes to the visible line through the colors.
+    // Spans of tiles start up to a tile before the visible pixels and end
+    // up to a tile after them, hence the margins.
+    uint32_t *line = gb->screen.screen_buffer + gb->screen.context.line_current * GAMEBOY_SCREEN_WIDTH;
+    uint8_t indexes[TILE_SQUARE_WIDTH + GAMEBOY_SCREEN_WIDTH + TILE_SQUARE_WIDTH];
+    uint8_t *visible = indexes + TILE_SQUARE_WIDTH;
+    // draw background
+    if (lcdc_bit0) {
+        uint8_t y_real = (gb->screen.context.line_current + gb->screen.SCY);       // y in the 256 * 256 background
+        const uint8_t *map = gb->screen.ram + bg_tile_map_pt - 0x8000 + RAM_OFFSET_VRAM + (y_real / TILE_SQUARE_WIDTH) * BG_MAP_WIDTH;
+        _tile_span(gb, visible - gb->screen.SCX % TILE_SQUARE_WIDTH, map, gb->screen.SCX / TILE_SQUARE_WIDTH,
+            BG_LINE_TILES, bg_wnd_tile_data_pt, y_real % TILE_SQUARE_WIDTH);
+    } else {
+        // background off shows color 0
+        memset(indexes, 0, sizeof(indexes));
+    }
+    /*
+     * I decided to not do branching between draw background or window,
+     * just draw the background and then draw the window on the top
+     * we will achieve the same result 
+     * (which can be proved because no interruption need to be triggered during scanline FIFO)
+     */
+    // draw window
+    // It is hidden with the background, from WY down and WX - 7 right.
+    // Its lines are counted apart: a line it is not drawn on does not move it.
+    int32_t wnd_x = (int32_t)gb->screen.WX - 7;
+    if (lcdc_bit0 && lcdc_bit5 && gb->screen.context.line_current >= gb->screen.WY && wnd_x < GAMEBOY_SCREEN_WIDTH) {
+        uint8_t y_real = gb->screen.context.window_line++;
+        const uint8_t *map = gb->screen.ram + wnd_tile_map_pt - 0x8000 + RAM_OFFSET_VRAM + (y_real / TILE_SQUARE_WIDTH) * BG_MAP_WIDTH;
+        _tile_span(gb, visible + wnd_x, map, 0,
+            (GAMEBOY_SCREEN_WIDTH - wnd_x + TILE_SQUARE_WIDTH - 1) / TILE_SQUARE_WIDTH, bg_wnd_tile_data_pt, y_real % TILE_SQUARE_WIDTH);
+    }
+    gb->screen.kernels.line_expand(line, visible, GAMEBOY_SCREEN_WIDTH, gb->screen.bg_palette);
+    // draw sprite
+    if (lcdc_bit1) {
+        for (uint8_t i = 0; i < 0xA0; ++i) {
+            // get sprite size
+            if (lcdc_bit2);
+        }
+    }
+
+    // Here all the data was transferred to LCD driver,
+	// so set LY to current line(use this logic according to documentation)
+	gb->screen.LY = gb->screen.context.line_current;
+}
+
+static void _h_blank(struct gb_machine *gb, uint8_t line_current)
+{
+    // CPU just idling
+
+	// change lcdc mode to 0
+	gb->screen.STAT = (gb->screen.STAT & (~0x3)) | 0x0;
+    my_gb_cpu_lock_vram(gb, 0);
+
+	// if bit 3(h blank interruption) is enabled
+	if ((gb->screen.STAT << 4) >> 3)
+		my_gb_cpu_on_interruption(gb, INT_LCDC_STATUS);
+}
+
+static void _v_blank(struct gb_machine *gb, uint8_t line_currrent)
+{
+    // CPU just idling
+
+	// change lcdc mode to 1
+	gb->screen.STAT = (gb->screen.STAT & (~0x3)) | 0x1;
+
+	// if bit 4(v blank interruption is enabled)
+	if ((gb->screen.STAT << 3) >> 4)
+		my_gb_cpu_on_interruption(gb, INT_VBLANK);
+
+    // change LY
+    gb->screen.LY = line_currrent;
+}
+
+// put gameboy screen buffer to back buffer and swap buffer
+// currently not refresh gameboy line by line
+// actually for reducing Bitblt count,
+// we use the strategy that only refresh screen only during V blank
+// may try to use fresh line by line in the future
+static void _screen_mapping(struct gb_machine *gb)
+{
+    if (!gb->screen.has_window)
+        return;
+	// copy screen buffer to windows dib(device independent bitmaps) buffer
+    for (uint32_t y = 0; y < GAMEBOY_SCREEN_HEIGHT; ++y) {
+        for (uint32_t x = 0; x < GAMEBOY_SCREEN_WIDTH; ++x) {
+            uint32_t color = gb->screen.screen_buffer[x + y * GAMEBOY_SCREEN_WIDTH];
+            for (uint32_t px_y = 0; px_y < SCALE_RATIO; ++px_y) {
+                for (uint32_t px_x = 0; px_x < SCALE_RATIO; ++px_x) {
+                    scg_back_buffer[px_x + x * SCALE_RATIO + (px_y + y * SCALE_RATIO) * (GAMEBOY_SCREEN_WIDTH * SCALE_RATIO)] = color;
+                }
+            }
+        }
+    }
+
+	scg_refresh();
+}
+
+// Do the screen state coming due and schedule the next one.
+static void _screen_event(struct gb_machine *gb, uint64_t deadline)
+{
+    uint32_t cycles;
+    if (!(gb->screen.LCDC >> 7)) {
+        // LCD is off, check again one scanline later
+        my_gb_scheduler_schedule(gb, EVENT_SCREEN, deadline + OAM_SEARCH_CYCLES + PIXEL_TRANSFER_CYCLES + HBLANK_CYCLES);
+        return;
+    }
+    switch (gb->screen.context.state_next) {
+    case SCREEN_STATE_HBLANK:
+        cycles = HBLANK_CYCLES;
+        _h_blank(gb, gb->screen.context.line_current);
+        ++gb->screen.context.line_current;
+        if (gb->screen.context.line_current > GAMEBOY_SCREEN_HEIGHT - 1) {
+            gb->screen.context.state_next = SCREEN_STATE_VBLANK;
+        } else {
+            gb->screen.context.state_next = SCREEN_STATE_OAM_SEARCH;
+        }
+        break;
+    case SCREEN_STATE_VBLANK:
+        cycles = VBLANK_CYCLES;
+        _v_blank(gb, gb->screen.context.line_current);
+        ++gb->screen.context.line_current;
+        if (gb->screen.context.line_current > 153) {
+            gb->screen.context.state_next = SCREEN_STATE_OAM_SEARCH;
+            gb->screen.context.line_current = 0;
+            gb->screen.context.window_line = 0;
+            _screen_mapping(gb);
+        } else {
+            gb->screen.context.state_next = SCREEN_STATE_VBLANK;
+        }
+        break;
+    case SCREEN_STATE_OAM_SEARCH:
+        cycles = OAM_SEARCH_CYCLES;
+        _oam_search(gb, gb->screen.context.line_current);
+        gb->screen.context.state_next = SCREEN_STATE_PIXEL_TRANSFER;
+        break;
+    default:
+        cycles = PIXEL_TRANSFER_CYCLES;
+        _pixel_transfer(gb, gb->screen.context.line_current);
+        gb->screen.context.state_next = SCREEN_STATE_HBLANK;
+        break;
+    }
+    my_gb_scheduler_schedule(gb, EVENT_SCREEN, deadline + cycles);
+}
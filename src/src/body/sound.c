@@ -1,63 +1,48 @@
-#include "sound.h"
-
-uint8_t NR10;
-uint8_t NR11;
-uint8_t NR12;
-uint8_t NR13;
-uint8_t NR14;
-uint8_t NR21;
-uint8_t NR22;
-uint8_t NR23;
-uint8_t NR24;
-uint8_t NR30;
-uint8_t NR31;
-uint8_t NR32;
-uint8_t NR33;
-uint8_t NR34;
-uint8_t NR41;
-uint8_t NR42;
-uint8_t NR43;
-uint8_t NR44;
-uint8_t NR50;
-uint8_t NR51;
-uint8_t NR52;
-uint8_t W[0x10];
-
-int my_gb_sound_construct(void)
-{
-    NR10 = 0;
-    NR11 = 0;
-    NR12 = 0;
-    NR13 = 0;
-    NR14 = 0;
-    NR21 = 0;
-    NR22 = 0;
-    NR23 = 0;
-    NR24 = 0;
-    NR30 = 0;
-    NR31 = 0;
-    NR32 = 0;
-    NR33 = 0;
-    NR34 = 0;
-    NR41 = 0;
-    NR42 = 0;
-    NR43 = 0;
-    NR44 = 0;
-    NR50 = 0;
-    NR51 = 0;
-    NR52 = 0;
-    for (int i = 0; i < 0x10; ++i)
-        W[i] = 0;
-    return 0;
-}
-
-void my_gb_sound_destruct(void)
-{
-}
-
-uint32_t my_gb_sound_run(uint32_t cycles_want)
-{
-    uint32_t cycles = 0;
-    return 0;
-}
-
+#include "sound.h"
+#include "scheduler.h"
+#include "../machine.h"
+
+// 512Hz
+#define FRAME_SEQUENCER_CYCLES 2048
+
+// Clock length counters, envelopes and sweep (currently only counting steps).
+static void _frame_sequencer(struct gb_machine *gb, uint64_t deadline)
+{
+    gb->sound.frame_sequencer_step = (gb->sound.frame_sequencer_step + 1) & 0x7;
+    my_gb_scheduler_schedule(gb, EVENT_SOUND, deadline + FRAME_SEQUENCER_CYCLES);
+}
+
+int my_gb_sound_construct(struct gb_machine *gb)
+{
+    gb->sound.NR10 = 0;
+    gb->sound.NR11 = 0;
+    gb->sound.NR12 = 0;
+    gb->sound.NR13 = 0;
+    gb->sound.NR14 = 0;
+    gb->sound.NR21 = 0;
+    gb->sound.NR22 = 0;
+    gb->sound.NR23 = 0;
+    gb->sound.NR24 = 0;
+    gb->sound.NR30 = 0;
+    gb->sound.NR31 = 0;
+    gb->sound.NR32 = 0;
+    gb->sound.NR33 = 0;
+    gb->sound.NR34 = 0;
+    gb->sound.NR41 = 0;
+    gb->sound.NR42 = 0;
+    gb->sound.NR43 = 0;
+    gb->sound.NR44 = 0;
+    gb->sound.NR50 = 0;
+    gb->sound.NR51 = 0;
+    gb->sound.NR52 = 0;
+    for (int i = 0; i < 0x10; ++i)
+        gb->sound.W[i] = 0;
+    gb->sound.frame_sequencer_step = 0;
+    my_gb_scheduler_register(gb, EVENT_SOUND, _frame_sequencer);
+    my_gb_scheduler_schedule(gb, EVENT_SOUND, gb->scheduler.clock + FRAME_SEQUENCER_CYCLES);
+    return 0;
+}
+
+void my_gb_sound_destruct(struct gb_machine *gb)
+{
+}
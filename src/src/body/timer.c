@@ -0,0 +1,111 @@
+#include"timer.h"
+#include"cpu.h"         // for timer overflow interruption
+#include"scheduler.h"
+#include"../machine.h"
+
+// DIV is incremented every 64 machine cycles
+#define DIV_SHIFT 6
+
+// log2 of machine cycles per TIMA increment, indexed by TAC bit 0-1
+static const uint8_t tima_shift[4] = { 8, 2, 4, 6 };
+
+#define TIMA_ENABLED (gb->timer.TAC & 0x4)
+#define TIMA_SHIFT tima_shift[gb->timer.TAC & 0x3]
+
+// number of TIMA increments between divider reset and clock,
+// TIMA follows the falling edges of the internal divider
+static inline uint64_t _tima_ticks(struct gb_machine *gb, uint64_t clock)
+{
+    return (clock - gb->timer.div_base) >> TIMA_SHIFT;
+}
+
+// bring tima up to clock, reloading TMA when passing overflow
+static void _tima_sync(struct gb_machine *gb, uint64_t clock)
+{
+    if (clock <= gb->timer.tima_base)
+        return;
+    if (TIMA_ENABLED) {
+        uint64_t value = gb->timer.tima + (_tima_ticks(gb, clock) - _tima_ticks(gb, gb->timer.tima_base));
+        if (value > 0xFF)
+            value = gb->timer.TMA + (value - 0x100) % (0x100 - gb->timer.TMA);
+        gb->timer.tima = (uint8_t)value;
+    }
+    gb->timer.tima_base = clock;
+}
+
+// schedule the next overflow as a single event
+static void _tima_schedule(struct gb_machine *gb)
+{
+    if (TIMA_ENABLED) {
+        uint64_t tick = _tima_ticks(gb, gb->timer.tima_base) + (0x100 - gb->timer.tima);
+        my_gb_scheduler_schedule(gb, EVENT_TIMER, gb->timer.div_base + (tick << TIMA_SHIFT));
+    } else {
+        my_gb_scheduler_schedule(gb, EVENT_TIMER, SCHEDULER_NEVER);
+    }
+}
+
+static void _tima_overflow(struct gb_machine *gb, uint64_t deadline)
+{
+    // passing overflow reloads TMA
+    _tima_sync(gb, deadline);
+    my_gb_cpu_on_interruption(gb, INT_TIMER_OVERFLOW);
+    _tima_schedule(gb);
+}
+
+int my_gb_timer_construct(struct gb_machine *gb)
+{
+    gb->timer.TMA = 0;
+    gb->timer.TAC = 0;
+    gb->timer.tima = 0;
+    gb->timer.div_base = gb->scheduler.clock;
+    gb->timer.tima_base = gb->scheduler.clock;
+    my_gb_scheduler_register(gb, EVENT_TIMER, _tima_overflow);
+    _tima_schedule(gb);
+    return 0;
+}
+
+void my_gb_timer_destruct(struct gb_machine *gb)
+{
+}
+
+uint8_t my_gb_timer_read(struct gb_machine *gb, uint16_t address)
+{
+    uint8_t read_result;
+    switch (address) {
+    case 0xFF04:
+        read_result = (uint8_t)((gb->scheduler.clock - gb->timer.div_base) >> DIV_SHIFT);
+        break;
+    case 0xFF05:
+        _tima_sync(gb, gb->scheduler.clock);
+        read_result = gb->timer.tima;
+        break;
+    case 0xFF06:
+        read_result = gb->timer.TMA;
+        break;
+    default:
+        read_result = gb->timer.TAC | 0xF8;
+        break;
+    }
+    return read_result;
+}
+
+void my_gb_timer_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    _tima_sync(gb, gb->scheduler.clock);
+    switch (address) {
+    case 0xFF04:
+        // writing any value resets the whole internal divider
+        gb->timer.div_base = gb->scheduler.clock;
+        break;
+    case 0xFF05:
+        gb->timer.tima = data;
+        break;
+    case 0xFF06:
+        gb->timer.TMA = data;
+        break;
+    default:
+        gb->timer.TAC = data & 0x7;
+        break;
+    }
+    _tima_schedule(gb);
+}
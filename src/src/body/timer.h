@@ -0,0 +1,68 @@
+#pragma once
+#ifndef _MY_GB_TIMER_H_
+#define _MY_GB_TIMER_H_
+
+#include<stdint.h>
+
+struct gb_machine;
+
+/*
+FF04
+   Name     - DIV
+   Contents - Divider Register (R/W)
+
+              This register is incremented 16384 (~16779
+              on SGB) times a second. Writing any value
+              sets it to $00.
+FF05
+   Name     - TIMA
+   Contents - Timer counter (R/W)
+
+              This timer is incremented by a clock frequency
+              specified by the TAC register ($FF07). The timer
+              generates an interrupt when it overflows.
+
+FF06
+   Name     - TMA
+   Contents - Timer Modulo (R/W)
+
+              When the TIMA overflows, this data will be loaded.
+
+FF07
+   Name     - TAC
+   Contents - Timer Control (R/W)
+
+              Bit 2 - Timer Stop
+                      0: Stop Timer
+                      1: Start Timer
+
+              Bits 1+0 - Input Clock Select
+                         00: 4.096 KHz    (~4.194 KHz SGB)
+                         01: 262.144 KHz  (~268.4 KHz SGB)
+                         10: 65.536 KHz   (~67.11 KHz SGB)
+                         11: 16.384 KHz   (~16.78 KHz SGB)
+*/
+
+// DIV and TIMA are not ticked, they are computed from clock of the scheduler
+// when read, so access them through my_gb_timer_read/write.
+struct gb_timer {
+    uint8_t TMA;
+    uint8_t TAC;
+
+    // cycle the internal divider was last reset at
+    uint64_t div_base;
+    // value of TIMA at tima_base
+    uint8_t tima;
+    uint64_t tima_base;
+};
+
+int my_gb_timer_construct(struct gb_machine *gb);
+
+void my_gb_timer_destruct(struct gb_machine *gb);
+
+// address between 0xFF04 and 0xFF07
+uint8_t my_gb_timer_read(struct gb_machine *gb, uint16_t address);
+
+void my_gb_timer_write(struct gb_machine *gb, uint16_t address, uint8_t data);
+
+#endif
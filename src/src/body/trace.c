@@ -0,0 +1,72 @@
+#include"trace.h"
+#include"../machine.h"
+
+#include<stdio.h>	    // for the default sink
+
+static void _trace_print(struct gb_machine *gb, enum TRACE_EVENT event, uint16_t pc, uint8_t opcode)
+{
+    switch (event) {
+    case TRACE_BOOT_LOGO_HALF_LOADED:
+        printf("Logo data half loaded.\n");
+        break;
+    case TRACE_BOOT_LOGO_LOADED:
+        printf("Logo data fully loaded.\n");
+        break;
+    case TRACE_BOOT_LOGO_VALID:
+        printf("Logo is valid!\n");
+        break;
+    case TRACE_BOOT_INIT_SOUND:
+        printf("Play Init Sound.\n");
+        break;
+    case TRACE_BOOT_FINISHED:
+        printf("Run through boot rom.\n");
+        if (opcode) {
+            printf("Boot rom running correctly.\n");
+        } else {
+            fprintf(stderr, "Boot ROM running badly!!!\n");
+        }
+        break;
+    case TRACE_INTERRUPTION:
+        switch (pc) {
+        case 0x0040:
+            printf("VBLANK interruption.\n");
+            break;
+        case 0x0048:
+            printf("LCDC status interruption.\n");
+            break;
+        case 0x0050:
+            printf("Timer overflow interruption.\n");
+            break;
+        case 0x0058:
+            printf("Serial transfer interruption.\n");
+            break;
+        case 0x0060:
+            printf("Button press interruption.\n");
+            break;
+        }
+        break;
+    case TRACE_HALT:
+        printf("Entering halt mode.\n");
+        break;
+    case TRACE_STOP:
+        if (opcode == 0x00) {
+            printf("Entering stop mode. Halt CPU & LCD display until button pressed.\n");
+        } else {
+            printf("Entering corrupted stop mode.\n");
+        }
+        break;
+    }
+}
+
+static my_gb_trace_sink trace_sink = _trace_print;
+
+void my_gb_trace_set_sink(my_gb_trace_sink sink)
+{
+    trace_sink = sink;
+}
+
+void my_gb_trace_emit(struct gb_machine *gb, enum TRACE_EVENT event, uint16_t pc, uint8_t opcode)
+{
+    if (trace_sink)
+        trace_sink(gb, event, pc, opcode);
+}
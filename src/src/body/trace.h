@@ -0,0 +1,40 @@
+#pragma once
+#ifndef _MY_GB_TRACE_H_
+#define _MY_GB_TRACE_H_
+
+#include<stdint.h>
+
+enum TRACE_EVENT {
+    TRACE_BOOT_LOGO_HALF_LOADED,
+    TRACE_BOOT_LOGO_LOADED,
+    TRACE_BOOT_LOGO_VALID,
+    TRACE_BOOT_INIT_SOUND,
+    TRACE_BOOT_FINISHED,        // opcode is 1 when registers hold the expected values
+    TRACE_INTERRUPTION,         // pc is the interruption vector, opcode is the IF bit taken
+    TRACE_HALT,
+    TRACE_STOP,                 // opcode is the byte following STOP, 0x00 when not corrupted
+};
+
+struct gb_machine;
+
+// pc is the address of the instruction the event belongs to
+typedef void (*my_gb_trace_sink)(struct gb_machine *gb, enum TRACE_EVENT event, uint16_t pc, uint8_t opcode);
+
+// Trace hooks are only compiled in debug builds,
+// define MY_GB_NO_TRACE to drop them from a debug build too.
+#if !defined(NDEBUG) && !defined(MY_GB_NO_TRACE)
+#define MY_GB_TRACE_ENABLED
+#define MY_GB_TRACE(event, pc, opcode) my_gb_trace_emit(gb, (event), (pc), (opcode))
+#else
+// sizeof keeps the arguments referenced without evaluating them
+#define MY_GB_TRACE(event, pc, opcode) ((void)sizeof(event), (void)sizeof(pc), (void)sizeof(opcode))
+#endif
+
+// Replace the sink receiving trace events, NULL discards them.
+// The default sink prints events to stdout.
+// The sink is shared by all machines of the process.
+void my_gb_trace_set_sink(my_gb_trace_sink sink);
+
+void my_gb_trace_emit(struct gb_machine *gb, enum TRACE_EVENT event, uint16_t pc, uint8_t opcode);
+
+#endif
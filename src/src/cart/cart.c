@@ -1,433 +1,613 @@
-#include"cart.h"
-#include<stdio.h>		// for debug info
-#include<stdlib.h>		// for malloc
-#include<stdint.h>		// for uint*_t
-#include<string.h>
-
-static uint8_t *rom = 0;
-static uint8_t *ram = 0;
-
-
-// MBC2 have built-in 512x4 bit ram.
-// Only when cart MBC type is MBC2, this chunk of ram is used 
-// For convenience, use lower nibble of 8bit to simulate the 4bit,
-// higher nibbles are left untouched.
-static uint8_t MBC2_ram[512];
-
-// MBC read and write function pointer
-static uint8_t(*MBC_read)(uint16_t address) = 0;
-static void (*MBC_write)(uint16_t address, uint8_t data) = 0;
-
-static uint8_t MBC1_read(uint16_t address);
-static uint8_t MBC2_read(uint16_t address);
-static uint8_t MBC3_read(uint16_t address);
-static uint8_t MBC5_read(uint16_t address);
-
-static void MBC1_write(uint16_t address, uint8_t data);
-static void MBC2_write(uint16_t address, uint8_t data);
-static void MBC3_write(uint16_t address, uint8_t data);
-static void MBC5_write(uint16_t address, uint8_t data);
-
-int my_gb_cart_construct(const char *filename)
-{
-    // open ROM file
-    FILE *cart_file_fs = NULL;      // ROM file file stream
-    uint8_t *cart_file = NULL;      // ROM file memory map
-
-    uint32_t cart_type = 0;
-    uint32_t rom_type = 0;
-    uint32_t ram_type = 0;
-
-    uint32_t rom_size = 0;
-    uint32_t ram_size = 0;
-    // store data locally, move to static or global when necessary
-
-
-    cart_file_fs = fopen(filename, "rb");
-    if (cart_file_fs == NULL) {
-        fprintf(stderr, "Open rom file %s failed.\n", filename);
-        goto error;
-    }
-    if (fseek(cart_file_fs, 0, SEEK_END) == -1)
-        goto error;
-
-    // get ROM file size for read
-    int rom_file_size = ftell(cart_file_fs);
-    if (rom_file_size <= 0x150) {
-        fprintf(stderr, "Rom file %s too small to check cartridge properties.\n", filename);
-        goto error;
-    }
-
-    // copy ROM to computer memory
-    cart_file = (uint8_t *)malloc(rom_file_size * sizeof(uint8_t));
-    if (!cart_file)
-        goto error;
-    rewind(cart_file_fs);
-    int read_size = fread(cart_file, 1, rom_file_size, cart_file_fs);
-    if (read_size != rom_file_size) {
-        fprintf(stderr, "Open rom file(%s) successful, but read failed.\n", filename);
-        goto error;
-    }
-    fclose(cart_file_fs);
-    cart_file_fs = 0;
-
-    printf("ROM %15s loaded.\n", cart_file + 0x134);
-
-    // check cartridge hardware type
-    cart_type = cart_file[0x147];
-    switch (cart_type) {
-    case 0x0:		// ROM ONLY
-    case 0x8:		// ROM + RAM
-    case 0x9:		// ROM + RAM + BATTERY
-        MBC_read = NULL;
-        MBC_write = NULL;
-    case 0x1:		// ROM + MBC1
-    case 0x2:		// ROM + MBC1 + RAM
-    case 0x3:		// ROM + MBC1 + RAM + BATT
-        MBC_read = MBC1_read;
-        MBC_write = MBC1_write;
-        break;
-    case 0x5:		// ROM + MBC2
-    case 0x6:		// ROM + MBC2 + BATTERY
-        MBC_read = MBC2_read;
-        MBC_write = MBC2_write;
-        break;
-    case 0x12:		// ROM + MBC3 + RAM
-    case 0x13:		// ROM + MBC3 + RAM + BATT
-        MBC_read = MBC3_write;
-        MBC_write = MBC3_write;
-        break;
-    case 0x19:		// ROM + MBC5
-    case 0x1A:		// ROM + MBC5 + RAM
-    case 0x1B:		// ROM + MBC5 + RAM + BATT
-    case 0x1C:		// ROM + MBC5 + RUMBLE
-    case 0x1D:		// ROM + MBC5 + RUMBLE + SRAM
-    case 0x1E:		// ROM + MBC5 + RUMBLE + SRAM + BATT
-        MBC_read = MBC5_write;
-        MBC_write = MBC5_write;
-        break;
-    case 0xB:		// ROM + MMM01
-    case 0xC:		// ROM + MMM01 + SRAM
-    case 0xD:		// ROM + MMM01 + SRAM + BATT
-    case 0x1F:		// Pocket Camera
-    case 0xFD:		// Bandai TAMA5
-    case 0xFE:		// Hudson HuC - 3
-        printf("unsupported cart type: %X", cart_type);
-        goto error;
-    default:
-        printf("never seen cart type: %X.\n", cart_type);
-        goto error;
-    }
-
-    rom_type = cart_file[0x148];
-    // ROM bank size: 16kb
-    switch (rom_type) {
-    case 0x0:
-        rom_size = 2 * 16 * 1024;
-        break;
-    case 0x1:
-        rom_size = 4 * 16 * 1024;
-        break;
-    case 0x2:
-        rom_size = 8 * 16 * 1024;
-        break;
-    case 0x3:
-        rom_size = 16 * 16 * 1024;
-        break;
-    case 0x4:
-        rom_size = 32 * 16 * 1024;
-        break;
-    case 0x5:
-        rom_size = 64 * 16 * 1024;
-        break;
-    case 0x6:
-        rom_size = 128 * 16 * 1024;
-        break;
-    case 0x52:
-        rom_size = 72 * 16 * 1024;
-        break;
-    case 0x53:
-        rom_size = 80 * 16 * 1024;
-        break;
-    case 0x54:
-        rom_size = 96 * 16 * 1024;
-        break;
-    default:
-        rom_size = 0;
-        printf("unrecognized ROM type %X. assume no ROM\n", rom_type);
-        goto error;
-    }
-
-    if (rom_size) {
-        rom = (uint8_t *)malloc(rom_size);
-        if (!rom) {
-            fprintf(stderr, "rom allocation failed!\n");
-            goto error;
-        }
-        memcpy(rom, cart_file, rom_size);
-    }
-
-    // ATTENTION!!!!!!!!!!!!!!!!!!!!!
-    // NEED to implement rom copy from rom_raw
-
-    ram_type = cart_file[0x149];
-    // RAM bank size: 8kb
-    switch (ram_type) {
-    case 0x0:
-        ram_size = 0;
-        break;
-    case 0x1:
-        ram_size = 2 * 1024;
-        break;
-    case 0x2:
-        ram_size = 1 * 8 * 1024;
-        break;
-    case 0x3:
-        ram_size = 4 * 8 * 1024;
-        break;
-    case 0x4:
-        ram_size = 16 * 8 * 1024;
-        break;
-    case 0x5:
-        ram_size = 8 * 8 * 1024;
-        break;
-    default:
-        ram_size = 0;
-        printf("unrecognized RAM type %X. assume no RAM\n", ram_type);
-        goto error;
-    }
-    if (ram_size) {
-        ram = (uint8_t *)malloc(ram_size);
-        if (!ram) {
-            fprintf(stderr, "ram allocation failed.\n");
-            goto error;
-        }
-    }
-
-    free(cart_file);
-    return 0;
-error:
-    if (cart_file_fs)
-        fclose(cart_file_fs);
-    if (cart_file)
-        free(cart_file);
-    if (rom) {
-        free(rom);
-        rom = NULL;
-    }
-    if (ram) {
-        free(ram);
-        ram = NULL;
-    }
-    return -1;
-}
-
-void my_gb_cart_destruct(void)
-{
-    if (rom) {
-        free(rom);
-        rom = NULL;
-    }
-    if (ram) {
-        free(ram);
-        ram = NULL;
-    }
-}
-
-uint8_t my_gb_cart_address_read(uint16_t address)
-{
-    uint8_t read_result = 0;
-    read_result = MBC_read(address);
-    return read_result;
-}
-
-void my_gb_cart_address_write(uint16_t address, uint8_t data)
-{
-    // implementation needed
-    MBC_write(address, data);
-}
-
-/*
- * MBC1
- * max 2MByte ROM and/or 32KByte RAM
- * Partly From http://gbdev.gg8.se/wiki/articles/Memory_Bank_Controllers
-
- * 0000-3FFF - ROM Bank 00 (Read Only)
- * 4000-7FFF - ROM Bank 01-7F (Read Only)
-
- * 0000-1FFF - RAM Enable (Write Only)
- * 2000-3FFF - ROM Bank Number (Write Only)
- * 4000-5FFF - RAM Bank Number - or - Upper Bits of ROM Bank Number (Write Only)
- * 6000-7FFF - ROM/RAM Mode Select (Write Only)
-
- * A000-BFFF - RAM Bank 00-03, if any (Read/Write)
- */
-uint8_t MBC1_read(uint16_t address)
-{
-    uint8_t result;
-    if (address < 0x3FFF) {
-        result = rom[address];
-    } else if (address < 0x7FFF) {
-        result = 0;
-    } else if (address > 0xA000 && address < 0xBFFF) {
-        result = 0;
-    } else {
-        result = 0;
-        fprintf(stderr,
-                "error: trying to read invalid location of cart.\n");
-    }
-    return result;
-}
-
-void MBC1_write(uint16_t address, uint8_t data)
-{
-    if (address < 0x1FFF) {
-    } else if (address < 0x3FFF) {
-    } else if (address < 0x5FFF) {
-    } else if (address < 0x7FFF) {
-    } else if (address > 0xA000 && address < 0xBFFF) {
-    } else {
-        fprintf(stderr,
-                "error: trying to write invalid location of cart.\n");
-    }
-}
-
-
-/*
- * MBC2
- * max 256KByte ROM and 512x4 bits RAM
- * Partly From http://gbdev.gg8.se/wiki/articles/Memory_Bank_Controllers
- * 0000-3FFF - ROM Bank 00 (Read Only)
- * 4000-7FFF - ROM Bank 01-7F (Read Only)
-
- * 0000-1FFF - RAM Enable (Write Only)
- * 2000-3FFF - ROM Bank Number (Write Only)
-
- * A000-A1FF - 512x4bits RAM, built-in into the MBC2 chip (Read/Write)
- *    Hint: The MBC2 doesn't support external RAM,
-            instead it includes 512x4 bits of built-in RAM.
-            As the data consists of 4bit values,
-            only the lower nibble of the "bytes" in this memory area are used.
- */
-
-uint8_t MBC2_read(uint16_t address)
-{
-    uint8_t result;
-    if (address < 0x3FFF) {
-        result = 0;
-    } else if (address < 0x7FFF) {
-        result = 0;
-    } else if (address > 0xA000 && address < 0xA1FF) {
-        result = 0;
-    } else {
-        result = 0;
-        fprintf(stderr,
-                "error: trying to read invalid location of cart.\n");
-    }
-    return result;
-}
-
-void MBC2_write(uint16_t address, uint8_t data)
-{
-    if (address < 0x1FFF) {
-    } else if (address < 0x3FFF) {
-    } else if (address > 0xA000 && address < 0xA1FF) {
-        MBC2_ram[address - 0xA000] = data & 0x0F;
-    } else {
-        fprintf(stderr,
-                "error: trying to write invalid location of cart.\n");
-    }
-}
-
-
-/*
- * MBC3
- * max 2MByte ROM and/or 64KByte RAM and Timer
- * Partly From http://gbdev.gg8.se/wiki/articles/Memory_Bank_Controllers
- * 0000-3FFF - ROM Bank 00 (Read Only)
- * 4000-7FFF - ROM Bank 01-7F (Read Only)
-
- * 0000-1FFF - RAM and Timer Enable (Write Only)
- * 2000-3FFF - ROM Bank Number (Write Only)
- * 4000-5FFF - RAM Bank Number - or - RTC Register Select (Write Only)
- * 6000-7FFF - Latch Clock Data (Write Only)
-
- * A000-BFFF - RAM Bank 00-03 - or - RTC Register 08-0C (Read/Write)
- */
-
-uint8_t MBC3_read(uint16_t address)
-{
-    uint8_t result;
-    if (address < 0x3FFF) {
-        result = 0;
-    } else if (address < 0x7FFF) {
-        result = 0;
-    } else if (address > 0xA000 && address < 0xBFFF) {
-        result = 0;
-    } else {
-        result = 0;
-        fprintf(stderr,
-                "error: trying to read invalid location of cart.\n");
-    }
-    return result;
-}
-
-void MBC3_write(uint16_t address, uint8_t data)
-{
-    if (address < 0x1FFF) {
-    } else if (address < 0x3FFF) {
-    } else if (address < 0x5FFF) {
-    } else if (address < 0x7FFF) {
-    } else if (address > 0xA000 && address < 0xBFFF) {
-    } else {
-        fprintf(stderr,
-                "error: trying to write invalid location of cart.\n");
-    }
-}
-
-/*
- * MBC5
- * max 8MByte ROM and/or 128KByte RAM
- * Partly From http://gbdev.gg8.se/wiki/articles/Memory_Bank_Controllers
-
- * 0000-3FFF - ROM Bank 00 (Read Only)
- * 4000-7FFF - ROM Bank 00 - 1FF(Read Only)
-
- * 0000-1FFF - RAM Enable(Write Only)
- * 2000-2FFF - Low 8 bits of ROM Bank Number(Write Only)
- * 3000-3FFF - High bit of ROM Bank Number(Write Only)
- * 4000-5FFF - RAM Bank Number(Write Only)
-
- * A000-BFFF - RAM Bank 00 - 0F, if any(Read / Write)
- */
-
-uint8_t MBC5_read(uint16_t address)
-{
-    uint8_t result;
-    if (address < 0x3FFF) {
-        result = 0;
-    } else if (address < 0x7FFF) {
-        result = 0;
-    } else if (address > 0xA000 && address < 0xBFFF) {
-        result = 0;
-    } else {
-        result = 0;
-        fprintf(stderr,
-                "error: trying to read invalid location of cart.\n");
-    }
-    return result;
-}
-void MBC5_write(uint16_t address, uint8_t data)
-{
-    if (address < 0x1FFF) {
-    } else if (address < 0x2FFF) {
-    } else if (address < 0x3FFF) {
-    } else if (address < 0x5FFF) {
-    } else if (address > 0xA000 && address < 0xBFFF) {
-    } else {
-        fprintf(stderr,
-                "error: trying to write invalid location of cart.\n");
-    }
-}
-
-
+#include"cart.h"
+#include"../machine.h"
+#include<stdio.h>		// for debug info
+#include<stdlib.h>		// for malloc
+#include<stdint.h>		// for uint*_t
+#include<string.h>
+
+static uint8_t NO_MBC_read(struct gb_machine *gb, uint16_t address);
+static uint8_t MBC1_read(struct gb_machine *gb, uint16_t address);
+static uint8_t MBC2_read(struct gb_machine *gb, uint16_t address);
+static uint8_t MBC3_read(struct gb_machine *gb, uint16_t address);
+static uint8_t MBC5_read(struct gb_machine *gb, uint16_t address);
+
+static void NO_MBC_write(struct gb_machine *gb, uint16_t address, uint8_t data);
+static void MBC1_write(struct gb_machine *gb, uint16_t address, uint8_t data);
+static void MBC2_write(struct gb_machine *gb, uint16_t address, uint8_t data);
+static void MBC3_write(struct gb_machine *gb, uint16_t address, uint8_t data);
+static void MBC5_write(struct gb_machine *gb, uint16_t address, uint8_t data);
+
+int my_gb_cart_construct(struct gb_machine *gb, const char *filename)
+{
+    // open ROM file
+    FILE *cart_file_fs = NULL;      // ROM file file stream
+    uint8_t *cart_file = NULL;      // ROM file memory map
+
+    uint32_t cart_type = 0;
+    uint32_t rom_type = 0;
+    uint32_t ram_type = 0;
+
+    gb->cart.rom = NULL;
+    gb->cart.ram = NULL;
+    gb->cart.rom_size = 0;
+    gb->cart.ram_size = 0;
+
+    cart_file_fs = fopen(filename, "rb");
+    if (cart_file_fs == NULL) {
+        fprintf(stderr, "Open rom file %s failed.\n", filename);
+        goto error;
+    }
+    if (fseek(cart_file_fs, 0, SEEK_END) == -1)
+        goto error;
+
+    // get ROM file size for read
+    int rom_file_size = ftell(cart_file_fs);
+    if (rom_file_size <= 0x150) {
+        fprintf(stderr, "Rom file %s too small to check cartridge properties.\n", filename);
+        goto error;
+    }
+
+    // copy ROM to computer memory
+    cart_file = (uint8_t *)malloc(rom_file_size * sizeof(uint8_t));
+    if (!cart_file)
+        goto error;
+    rewind(cart_file_fs);
+    int read_size = fread(cart_file, 1, rom_file_size, cart_file_fs);
+    if (read_size != rom_file_size) {
+        fprintf(stderr, "Open rom file(%s) successful, but read failed.\n", filename);
+        goto error;
+    }
+    fclose(cart_file_fs);
+    cart_file_fs = 0;
+
+    printf("ROM %15s loaded.\n", cart_file + 0x134);
+
+    // check cartridge hardware type
+    cart_type = cart_file[0x147];
+    switch (cart_type) {
+    case 0x0:		// ROM ONLY
+    case 0x8:		// ROM + RAM
+    case 0x9:		// ROM + RAM + BATTERY
+        // No MBC, ram(if any) is always accessible
+        gb->cart.MBC_read = NO_MBC_read;
+        gb->cart.MBC_write = NO_MBC_write;
+        gb->cart.ram_enabled = 1;
+        gb->cart.ram_mappable = 1;
+        break;
+    case 0x1:		// ROM + MBC1
+    case 0x2:		// ROM + MBC1 + RAM
+    case 0x3:		// ROM + MBC1 + RAM + BATT
+        gb->cart.MBC_read = MBC1_read;
+        gb->cart.MBC_write = MBC1_write;
+        gb->cart.ram_enabled = 0;
+        gb->cart.ram_mappable = 1;
+        break;
+    case 0x5:		// ROM + MBC2
+    case 0x6:		// ROM + MBC2 + BATTERY
+        gb->cart.MBC_read = MBC2_read;
+        gb->cart.MBC_write = MBC2_write;
+        gb->cart.ram_enabled = 0;
+        gb->cart.ram_mappable = 0;
+        break;
+    case 0x11:		// ROM + MBC3
+    case 0x12:		// ROM + MBC3 + RAM
+    case 0x13:		// ROM + MBC3 + RAM + BATT
+        gb->cart.MBC_read = MBC3_read;
+        gb->cart.MBC_write = MBC3_write;
+        gb->cart.ram_enabled = 0;
+        gb->cart.ram_mappable = 1;
+        break;
+    case 0x19:		// ROM + MBC5
+    case 0x1A:		// ROM + MBC5 + RAM
+    case 0x1B:		// ROM + MBC5 + RAM + BATT
+    case 0x1C:		// ROM + MBC5 + RUMBLE
+    case 0x1D:		// ROM + MBC5 + RUMBLE + SRAM
+    case 0x1E:		// ROM + MBC5 + RUMBLE + SRAM + BATT
+        gb->cart.MBC_read = MBC5_read;
+        gb->cart.MBC_write = MBC5_write;
+        gb->cart.ram_enabled = 0;
+        gb->cart.ram_mappable = 1;
+        break;
+    case 0xB:		// ROM + MMM01
+    case 0xC:		// ROM + MMM01 + SRAM
+    case 0xD:		// ROM + MMM01 + SRAM + BATT
+    case 0x1F:		// Pocket Camera
+    case 0xFD:		// Bandai TAMA5
+    case 0xFE:		// Hudson HuC - 3
+        printf("unsupported cart type: %X", cart_type);
+        goto error;
+    default:
+        printf("never seen cart type: %X.\n", cart_type);
+        goto error;
+    }
+
+    rom_type = cart_file[0x148];
+    // ROM bank size: 16kb
+    switch (rom_type) {
+    case 0x0:
+        gb->cart.rom_size = 2 * 16 * 1024;
+        break;
+    case 0x1:
+        gb->cart.rom_size = 4 * 16 * 1024;
+        break;
+    case 0x2:
+        gb->cart.rom_size = 8 * 16 * 1024;
+        break;
+    case 0x3:
+        gb->cart.rom_size = 16 * 16 * 1024;
+        break;
+    case 0x4:
+        gb->cart.rom_size = 32 * 16 * 1024;
+        break;
+    case 0x5:
+        gb->cart.rom_size = 64 * 16 * 1024;
+        break;
+    case 0x6:
+        gb->cart.rom_size = 128 * 16 * 1024;
+        break;
+    case 0x52:
+        gb->cart.rom_size = 72 * 16 * 1024;
+        break;
+    case 0x53:
+        gb->cart.rom_size = 80 * 16 * 1024;
+        break;
+    case 0x54:
+        gb->cart.rom_size = 96 * 16 * 1024;
+        break;
+    default:
+        gb->cart.rom_size = 0;
+        printf("unrecognized ROM type %X. assume no ROM\n", rom_type);
+        goto error;
+    }
+
+    if (gb->cart.rom_size) {
+        gb->cart.rom = (uint8_t *)malloc(gb->cart.rom_size);
+        if (!gb->cart.rom) {
+            fprintf(stderr, "rom allocation failed!\n");
+            goto error;
+        }
+        // Some dumps are shorter than the size in header, pad them with 0xFF
+        memset(gb->cart.rom, 0xFF, gb->cart.rom_size);
+        memcpy(gb->cart.rom, cart_file, (uint32_t)rom_file_size < gb->cart.rom_size ? (uint32_t)rom_file_size : gb->cart.rom_size);
+    }
+
+    ram_type = cart_file[0x149];
+    // RAM bank size: 8kb
+    switch (ram_type) {
+    case 0x0:
+        gb->cart.ram_size = 0;
+        break;
+    case 0x1:
+        gb->cart.ram_size = 2 * 1024;
+        break;
+    case 0x2:
+        gb->cart.ram_size = 1 * 8 * 1024;
+        break;
+    case 0x3:
+        gb->cart.ram_size = 4 * 8 * 1024;
+        break;
+    case 0x4:
+        gb->cart.ram_size = 16 * 8 * 1024;
+        break;
+    case 0x5:
+        gb->cart.ram_size = 8 * 8 * 1024;
+        break;
+    default:
+        gb->cart.ram_size = 0;
+        printf("unrecognized RAM type %X. assume no RAM\n", ram_type);
+        goto error;
+    }
+    if (gb->cart.ram_size) {
+        gb->cart.ram = (uint8_t *)malloc(gb->cart.ram_size);
+        if (!gb->cart.ram) {
+            fprintf(stderr, "ram allocation failed.\n");
+            goto error;
+        }
+    }
+    // 2KB ram only fills part of a page, MBC functions deal with it
+    if (gb->cart.ram_size < 8 * 1024)
+        gb->cart.ram_mappable = 0;
+
+    gb->cart.rom_bank = 1;
+    gb->cart.rom_bank_0 = 0;
+    gb->cart.ram_bank = 0;
+    gb->cart.MBC1_mode = 0;
+    gb->cart.MBC1_bank_low = 1;
+    gb->cart.MBC1_bank_high = 0;
+    gb->cart.MBC3_rtc_selected = 0;
+    memset(gb->cart.MBC2_ram, 0, sizeof(gb->cart.MBC2_ram));
+
+    free(cart_file);
+    return 0;
+error:
+    if (cart_file_fs)
+        fclose(cart_file_fs);
+    if (cart_file)
+        free(cart_file);
+    if (gb->cart.rom) {
+        free(gb->cart.rom);
+        gb->cart.rom = NULL;
+    }
+    if (gb->cart.ram) {
+        free(gb->cart.ram);
+        gb->cart.ram = NULL;
+    }
+    gb->cart.rom_size = 0;
+    gb->cart.ram_size = 0;
+    return -1;
+}
+
+void my_gb_cart_destruct(struct gb_machine *gb)
+{
+    if (gb->cart.rom) {
+        free(gb->cart.rom);
+        gb->cart.rom = NULL;
+    }
+    if (gb->cart.ram) {
+        free(gb->cart.ram);
+        gb->cart.ram = NULL;
+    }
+    gb->cart.rom_size = 0;
+    gb->cart.ram_size = 0;
+}
+
+static inline uint8_t *_rom_bank_get(struct gb_machine *gb, uint32_t bank)
+{
+    return gb->cart.rom + (bank * 0x4000) % gb->cart.rom_size;
+}
+
+static inline uint8_t *_ram_bank_get(struct gb_machine *gb)
+{
+    return gb->cart.ram + (gb->cart.ram_bank * 0x2000) % gb->cart.ram_size;
+}
+
+void my_gb_cart_map(struct gb_machine *gb, uint8_t *page_read[0x100], uint8_t *page_write[0x100])
+{
+    uint32_t page;
+    uint8_t *bank;
+
+    if (!gb->cart.rom)
+        return;
+
+    // ROM pages are read only, writes go to MBC registers through handler
+    bank = _rom_bank_get(gb, gb->cart.rom_bank_0);
+    for (page = 0x00; page < 0x40; ++page) {
+        page_read[page] = bank + (page - 0x00) * 0x100;
+        page_write[page] = NULL;
+    }
+    bank = _rom_bank_get(gb, gb->cart.rom_bank);
+    for (page = 0x40; page < 0x80; ++page) {
+        page_read[page] = bank + (page - 0x40) * 0x100;
+        page_write[page] = NULL;
+    }
+
+    // Disabled, absent or MBC2 ram is handled by MBC read write functions
+    if (gb->cart.ram && gb->cart.ram_enabled && gb->cart.ram_mappable) {
+        bank = _ram_bank_get(gb);
+        for (page = 0xA0; page < 0xC0; ++page) {
+            page_read[page] = bank + (page - 0xA0) * 0x100;
+            page_write[page] = bank + (page - 0xA0) * 0x100;
+        }
+    } else {
+        for (page = 0xA0; page < 0xC0; ++page) {
+            page_read[page] = NULL;
+            page_write[page] = NULL;
+        }
+    }
+}
+
+uint8_t my_gb_cart_address_read(struct gb_machine *gb, uint16_t address)
+{
+    uint8_t read_result = 0;
+    read_result = gb->cart.MBC_read(gb, address);
+    return read_result;
+}
+
+void my_gb_cart_address_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    gb->cart.MBC_write(gb, address, data);
+}
+
+/*
+ * Shared cart ram access for MBC without special ram.
+ * Used when the ram page is not directly mapped (disabled or smaller than a page).
+ */
+static uint8_t _ram_read(struct gb_machine *gb, uint16_t address)
+{
+    if (!gb->cart.ram || !gb->cart.ram_enabled)
+        return 0xFF;
+    return _ram_bank_get(gb)[(address - 0xA000) % (gb->cart.ram_size < 0x2000 ? gb->cart.ram_size : 0x2000)];
+}
+
+static void _ram_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    if (!gb->cart.ram || !gb->cart.ram_enabled)
+        return;
+    _ram_bank_get(gb)[(address - 0xA000) % (gb->cart.ram_size < 0x2000 ? gb->cart.ram_size : 0x2000)] = data;
+}
+
+/*
+ * No MBC
+ * 32KByte ROM and optional 8KByte RAM
+
+ * 0000-7FFF - ROM (Read Only)
+ * A000-BFFF - RAM, if any (Read/Write)
+ */
+uint8_t NO_MBC_read(struct gb_machine *gb, uint16_t address)
+{
+    uint8_t result;
+    if (address <= 0x3FFF) {
+        result = _rom_bank_get(gb, 0)[address];
+    } else if (address <= 0x7FFF) {
+        result = _rom_bank_get(gb, 1)[address - 0x4000];
+    } else if (address >= 0xA000 && address <= 0xBFFF) {
+        result = _ram_read(gb, address);
+    } else {
+        result = 0xFF;
+        fprintf(stderr,
+                "error: trying to read invalid location of cart.\n");
+    }
+    return result;
+}
+
+void NO_MBC_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    if (address <= 0x7FFF) {
+        // no register to write
+    } else if (address >= 0xA000 && address <= 0xBFFF) {
+        _ram_write(gb, address, data);
+    } else {
+        fprintf(stderr,
+                "error: trying to write invalid location of cart.\n");
+    }
+}
+
+/*
+ * MBC1
+ * max 2MByte ROM and/or 32KByte RAM
+ * Partly From http://gbdev.gg8.se/wiki/articles/Memory_Bank_Controllers
+
+ * 0000-3FFF - ROM Bank 00 (Read Only)
+ * 4000-7FFF - ROM Bank 01-7F (Read Only)
+
+ * 0000-1FFF - RAM Enable (Write Only)
+ * 2000-3FFF - ROM Bank Number (Write Only)
+ * 4000-5FFF - RAM Bank Number - or - Upper Bits of ROM Bank Number (Write Only)
+ * 6000-7FFF - ROM/RAM Mode Select (Write Only)
+
+ * A000-BFFF - RAM Bank 00-03, if any (Read/Write)
+ */
+
+static void MBC1_update(struct gb_machine *gb)
+{
+    gb->cart.rom_bank = (gb->cart.MBC1_bank_high << 5) | gb->cart.MBC1_bank_low;
+    if (gb->cart.MBC1_mode) {
+        // ram banking mode: upper bits select ram bank and bank of 0x0000-0x3FFF
+        gb->cart.rom_bank_0 = gb->cart.MBC1_bank_high << 5;
+        gb->cart.ram_bank = gb->cart.MBC1_bank_high;
+    } else {
+        gb->cart.rom_bank_0 = 0;
+        gb->cart.ram_bank = 0;
+    }
+}
+
+uint8_t MBC1_read(struct gb_machine *gb, uint16_t address)
+{
+    uint8_t result;
+    if (address <= 0x3FFF) {
+        result = _rom_bank_get(gb, gb->cart.rom_bank_0)[address];
+    } else if (address <= 0x7FFF) {
+        result = _rom_bank_get(gb, gb->cart.rom_bank)[address - 0x4000];
+    } else if (address >= 0xA000 && address <= 0xBFFF) {
+        result = _ram_read(gb, address);
+    } else {
+        result = 0xFF;
+        fprintf(stderr,
+                "error: trying to read invalid location of cart.\n");
+    }
+    return result;
+}
+
+void MBC1_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    if (address <= 0x1FFF) {
+        gb->cart.ram_enabled = (data & 0x0F) == 0x0A;
+    } else if (address <= 0x3FFF) {
+        gb->cart.MBC1_bank_low = data & 0x1F;
+        if (!gb->cart.MBC1_bank_low)
+            gb->cart.MBC1_bank_low = 1;
+        MBC1_update(gb);
+    } else if (address <= 0x5FFF) {
+        gb->cart.MBC1_bank_high = data & 0x03;
+        MBC1_update(gb);
+    } else if (address <= 0x7FFF) {
+        gb->cart.MBC1_mode = data & 0x01;
+        MBC1_update(gb);
+    } else if (address >= 0xA000 && address <= 0xBFFF) {
+        _ram_write(gb, address, data);
+    } else {
+        fprintf(stderr,
+                "error: trying to write invalid location of cart.\n");
+    }
+}
+
+
+/*
+ * MBC2
+ * max 256KByte ROM and 512x4 bits RAM
+ * Partly From http://gbdev.gg8.se/wiki/articles/Memory_Bank_Controllers
+ * 0000-3FFF - ROM Bank 00 (Read Only)
+ * 4000-7FFF - ROM Bank 01-7F (Read Only)
+
+ * 0000-1FFF - RAM Enable (Write Only)
+ * 2000-3FFF - ROM Bank Number (Write Only)
+
+ * A000-A1FF - 512x4bits RAM, built-in into the MBC2 chip (Read/Write)
+ *    Hint: The MBC2 doesn't support external RAM,
+            instead it includes 512x4 bits of built-in RAM.
+            As the data consists of 4bit values,
+            only the lower nibble of the "bytes" in this memory area are used.
+ */
+
+uint8_t MBC2_read(struct gb_machine *gb, uint16_t address)
+{
+    uint8_t result;
+    if (address <= 0x3FFF) {
+        result = _rom_bank_get(gb, 0)[address];
+    } else if (address <= 0x7FFF) {
+        result = _rom_bank_get(gb, gb->cart.rom_bank)[address - 0x4000];
+    } else if (address >= 0xA000 && address <= 0xBFFF) {
+        // ram echoes every 512 bytes, upper nibble reads as 1
+        if (gb->cart.ram_enabled)
+            result = gb->cart.MBC2_ram[(address - 0xA000) & 0x1FF] | 0xF0;
+        else
+            result = 0xFF;
+    } else {
+        result = 0xFF;
+        fprintf(stderr,
+                "error: trying to read invalid location of cart.\n");
+    }
+    return result;
+}
+
+void MBC2_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    if (address <= 0x3FFF) {
+        // bit 8 of address tells ram enable from rom bank number
+        if (address & 0x0100) {
+            gb->cart.rom_bank = data & 0x0F;
+            if (!gb->cart.rom_bank)
+                gb->cart.rom_bank = 1;
+        } else {
+            gb->cart.ram_enabled = (data & 0x0F) == 0x0A;
+        }
+    } else if (address <= 0x7FFF) {
+        // nothing here
+    } else if (address >= 0xA000 && address <= 0xBFFF) {
+        if (gb->cart.ram_enabled)
+            gb->cart.MBC2_ram[(address - 0xA000) & 0x1FF] = data & 0x0F;
+    } else {
+        fprintf(stderr,
+                "error: trying to write invalid location of cart.\n");
+    }
+}
+
+
+/*
+ * MBC3
+ * max 2MByte ROM and/or 64KByte RAM and Timer
+ * Partly From http://gbdev.gg8.se/wiki/articles/Memory_Bank_Controllers
+ * 0000-3FFF - ROM Bank 00 (Read Only)
+ * 4000-7FFF - ROM Bank 01-7F (Read Only)
+
+ * 0000-1FFF - RAM and Timer Enable (Write Only)
+ * 2000-3FFF - ROM Bank Number (Write Only)
+ * 4000-5FFF - RAM Bank Number - or - RTC Register Select (Write Only)
+ * 6000-7FFF - Latch Clock Data (Write Only)
+
+ * A000-BFFF - RAM Bank 00-03 - or - RTC Register 08-0C (Read/Write)
+ */
+
+// RTC is not implemented, when a RTC register is selected
+// ram is unmapped and reads give 0
+uint8_t MBC3_read(struct gb_machine *gb, uint16_t address)
+{
+    uint8_t result;
+    if (address <= 0x3FFF) {
+        result = _rom_bank_get(gb, 0)[address];
+    } else if (address <= 0x7FFF) {
+        result = _rom_bank_get(gb, gb->cart.rom_bank)[address - 0x4000];
+    } else if (address >= 0xA000 && address <= 0xBFFF) {
+        if (gb->cart.MBC3_rtc_selected)
+            result = 0;
+        else
+            result = _ram_read(gb, address);
+    } else {
+        result = 0xFF;
+        fprintf(stderr,
+                "error: trying to read invalid location of cart.\n");
+    }
+    return result;
+}
+
+void MBC3_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    if (address <= 0x1FFF) {
+        gb->cart.ram_enabled = (data & 0x0F) == 0x0A;
+    } else if (address <= 0x3FFF) {
+        gb->cart.rom_bank = data & 0x7F;
+        if (!gb->cart.rom_bank)
+            gb->cart.rom_bank = 1;
+    } else if (address <= 0x5FFF) {
+        if (data <= 0x03) {
+            gb->cart.ram_bank = data;
+            gb->cart.MBC3_rtc_selected = 0;
+            gb->cart.ram_mappable = gb->cart.ram_size >= 8 * 1024;
+        } else if (data >= 0x08 && data <= 0x0C) {
+            gb->cart.MBC3_rtc_selected = 1;
+            gb->cart.ram_mappable = 0;
+        }
+    } else if (address <= 0x7FFF) {
+        // latch clock data, no RTC
+    } else if (address >= 0xA000 && address <= 0xBFFF) {
+        if (!gb->cart.MBC3_rtc_selected)
+            _ram_write(gb, address, data);
+    } else {
+        fprintf(stderr,
+                "error: trying to write invalid location of cart.\n");
+    }
+}
+
+/*
+ * MBC5
+ * max 8MByte ROM and/or 128KByte RAM
+ * Partly From http://gbdev.gg8.se/wiki/articles/Memory_Bank_Controllers
+
+ * 0000-3FFF - ROM Bank 00 (Read Only)
+ * 4000-7FFF - ROM Bank 00 - 1FF(Read Only)
+
+ * 0000-1FFF - RAM Enable(Write Only)
+ * 2000-2FFF - Low 8 bits of ROM Bank Number(Write Only)
+ * 3000-3FFF - High bit of ROM Bank Number(Write Only)
+ * 4000-5FFF - RAM Bank Number(Write Only)
+
+ * A000-BFFF - RAM Bank 00 - 0F, if any(Read / Write)
+ */
+
+uint8_t MBC5_read(struct gb_machine *gb, uint16_t address)
+{
+    uint8_t result;
+    if (address <= 0x3FFF) {
+        result = _rom_bank_get(gb, 0)[address];
+    } else if (address <= 0x7FFF) {
+        result = _rom_bank_get(gb, gb->cart.rom_bank)[address - 0x4000];
+    } else if (address >= 0xA000 && address <= 0xBFFF) {
+        result = _ram_read(gb, address);
+    } else {
+        result = 0xFF;
+        fprintf(stderr,
+                "error: trying to read invalid location of cart.\n");
+    }
+    return result;
+}
+void MBC5_write(struct gb_machine *gb, uint16_t address, uint8_t data)
+{
+    if (address <= 0x1FFF) {
+        gb->cart.ram_enabled = (data & 0x0F) == 0x0A;
+    } else if (address <= 0x2FFF) {
+        // bank 0 can be mapped to 0x4000 on MBC5
+        gb->cart.rom_bank = (gb->cart.rom_bank & 0x100) | data;
+    } else if (address <= 0x3FFF) {
+        gb->cart.rom_bank = (gb->cart.rom_bank & 0xFF) | ((uint32_t)(data & 0x1) << 8);
+    } else if (address <= 0x5FFF) {
+        gb->cart.ram_bank = data & 0x0F;
+    } else if (address <= 0x7FFF) {
+        // nothing here
+    } else if (address >= 0xA000 && address <= 0xBFFF) {
+        _ram_write(gb, address, data);
+    } else {
+        fprintf(stderr,
+                "error: trying to write invalid location of cart.\n");
+    }
+}
+
@@ -1,15 +1,59 @@
-#pragma once
-#ifndef _MY_GB_CART_H_
-#define _MY_GB_CART_H_
-
-#include<stdint.h> // for uintN_t
-
-int my_gb_cart_construct(const char *filename);
-
-void my_gb_cart_destruct(void);
-
-uint8_t my_gb_cart_address_read(uint16_t address);
-
-void my_gb_cart_address_write(uint16_t address, uint8_t data);
-
-#endif 
+#pragma once
+#ifndef _MY_GB_CART_H_
+#define _MY_GB_CART_H_
+
+#include<stdint.h> // for uintN_t
+
+struct gb_machine;
+
+struct gb_cart {
+    uint8_t *rom;
+    uint8_t *ram;
+
+    // size of rom and ram in bytes, used to wrap bank numbers
+    uint32_t rom_size;
+    uint32_t ram_size;
+
+    // MBC bank registers
+    // rom_bank is the bank mapped to 0x4000-0x7FFF,
+    // rom_bank_0 is the bank mapped to 0x0000-0x3FFF(only changes with MBC1 mode 1)
+    uint32_t rom_bank;
+    uint32_t rom_bank_0;
+    uint32_t ram_bank;
+    uint32_t ram_enabled;
+    uint32_t MBC1_mode;
+    // lower 5 bits and upper 2 bits of the rom bank written by cart
+    uint32_t MBC1_bank_low;
+    uint32_t MBC1_bank_high;
+    // MBC2 ram is built into MBC chip and only has 4bit per byte,
+    // so it can never be directly mapped to cpu address space.
+    uint32_t ram_mappable;
+    uint32_t MBC3_rtc_selected;
+
+    // MBC2 have built-in 512x4 bit ram.
+    // Only when cart MBC type is MBC2, this chunk of ram is used 
+    // For convenience, use lower nibble of 8bit to simulate the 4bit,
+    // higher nibbles are left untouched.
+    uint8_t MBC2_ram[512];
+
+    // MBC read and write function pointer
+    uint8_t (*MBC_read)(struct gb_machine *gb, uint16_t address);
+    void (*MBC_write)(struct gb_machine *gb, uint16_t address, uint8_t data);
+};
+
+int my_gb_cart_construct(struct gb_machine *gb, const char *filename);
+
+void my_gb_cart_destruct(struct gb_machine *gb);
+
+uint8_t my_gb_cart_address_read(struct gb_machine *gb, uint16_t address);
+
+// Writes to 0x0000-0x7FFF change MBC registers,
+// page mapping of the cart should be refreshed after them.
+void my_gb_cart_address_write(struct gb_machine *gb, uint16_t address, uint8_t data);
+
+// Fill the cart part(0x0000-0x7FFF and 0xA000-0xBFFF) of the cpu page tables
+// with host pointers to current rom and ram banks.
+// NULL means the page has to be accessed through my_gb_cart_address_read/write.
+void my_gb_cart_map(struct gb_machine *gb, uint8_t *page_read[0x100], uint8_t *page_write[0x100]);
+
+#endif 
@@ -0,0 +1,88 @@
+#include<stdio.h>
+#include"./machine.h"
+
+int my_gb_machine_construct(struct gb_machine *gb, const char *cart_location, WNDPROC callback)
+{
+    // init scheduler, other modules register their events to it
+    if (my_gb_scheduler_construct(gb) == -1) {
+        fprintf(stderr, "scheduler construction failed.\n");
+        return -1;
+    }
+    // init internal ram
+    if (my_gb_ram_construct(gb) == -1) {
+        fprintf(stderr, "internal ram construction failed.\n");
+        goto error_ram;
+    }
+    // init cpu
+    if (my_gb_cpu_construct(gb) == -1) {
+        fprintf(stderr, "cpu construction failed.\n");
+        goto error_cpu;
+    }
+    // init timer
+    if (my_gb_timer_construct(gb) == -1) {
+        fprintf(stderr, "timer construction failed.\n");
+        goto error_timer;
+    }
+    // init input
+    if (my_gb_input_construct(gb) == -1) {
+        fprintf(stderr, "input construction failed.\n");
+        goto error_input;
+    }
+    // init sound
+    if (my_gb_sound_construct(gb) == -1) {
+        fprintf(stderr, "sound construction failed.\n");
+        goto error_sound;
+    }
+    // init screen
+    if (my_gb_screen_construct(gb, callback) == -1) {
+        fprintf(stderr, "screen construction failed.\n");
+        goto error_screen;
+    }
+    // init cart
+    if (my_gb_cart_construct(gb, cart_location) == -1) {
+        fprintf(stderr, "cannot open cart in %s, please check.\n", cart_location);
+        goto error_cart;
+    }
+
+    my_gb_cpu_link_input(gb);
+    my_gb_cpu_link_screen(gb);
+    my_gb_cpu_link_ram(gb, my_gb_ram_get(gb));
+    my_gb_screen_link_ram(gb, my_gb_ram_get(gb));
+    my_gb_cpu_link_cart(gb);
+    return 0;
+
+    // destruct the parts built so far, in the order of my_gb_machine_destruct
+error_cart:
+    my_gb_screen_destruct(gb);
+error_screen:
+    my_gb_sound_destruct(gb);
+error_sound:
+    my_gb_input_destruct(gb);
+error_input:
+    my_gb_timer_destruct(gb);
+error_timer:
+    my_gb_cpu_destruct(gb);
+error_cpu:
+    my_gb_ram_destruct(gb);
+error_ram:
+    my_gb_scheduler_destruct(gb);
+    return -1;
+}
+
+void my_gb_machine_destruct(struct gb_machine *gb)
+{
+    my_gb_cart_destruct(gb);
+    my_gb_screen_destruct(gb);
+    my_gb_sound_destruct(gb);
+    my_gb_input_destruct(gb);
+    my_gb_timer_destruct(gb);
+    my_gb_cpu_destruct(gb);
+    my_gb_ram_destruct(gb);
+    my_gb_scheduler_destruct(gb);
+}
+
+void my_gb_machine_run(struct gb_machine *gb, uint32_t cycles)
+{
+    // cpu runs until the next event, which is dispatched in time
+    my_gb_scheduler_run(gb, cycles);
+}
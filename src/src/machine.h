@@ -0,0 +1,41 @@
+#pragma once
+#ifndef _MY_GB_MACHINE_H_
+#define _MY_GB_MACHINE_H_
+
+#include"./body/scheduler.h"
+#include"./body/cpu.h"
+#include"./body/timer.h"
+#include"./body/ram.h"
+#include"./body/screen.h"
+#include"./body/sound.h"
+#include"./body/input.h"
+#include"./cart/cart.h"
+#include<stdint.h>
+
+/*
+ * Whole state of one emulated Game Boy.
+ * Every my_gb_* function works on the machine passed to it,
+ * so machines are independent and can run on separate threads.
+ * (Except the window, only one machine of the process can own it.)
+ */
+struct gb_machine {
+    struct gb_scheduler scheduler;
+    struct gb_cpu cpu;
+    struct gb_timer timer;
+    struct gb_ram ram;
+    struct gb_screen screen;
+    struct gb_sound sound;
+    struct gb_input input;
+    struct gb_cart cart;
+};
+
+// Construct every part of the machine and link them together.
+// Run headless(no window) when callback is NULL.
+int my_gb_machine_construct(struct gb_machine *gb, const char *cart_location, WNDPROC callback);
+
+void my_gb_machine_destruct(struct gb_machine *gb);
+
+// Run machine for cycles, dispatching events coming due.
+void my_gb_machine_run(struct gb_machine *gb, uint32_t cycles);
+
+#endif
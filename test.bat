@@ -1,7 +1,7 @@
-@echo off
-mkdir build
-cd build
-cmake ..
-msbuild my_gameboy_all.sln
-cd ..
+@echo off
+mkdir build
+cd build
+cmake ..
+msbuild my_gameboy_all.sln
+cd ..
 .\build\test\Debug\my_gameboy_test.exe
\ No newline at end of file
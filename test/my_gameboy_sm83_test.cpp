@@ -0,0 +1,456 @@
+#include"gtest/gtest.h"
+extern "C" {
+#include"../src/src/machine.h"
+}
+
+#include<atomic>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<fstream>
+#include<algorithm>
+#include<map>
+#include<memory>
+#include<mutex>
+#include<sstream>
+#include<string>
+#include<thread>
+#include<vector>
+
+/*
+ * Single step conformance tests of the cpu.
+ * Cases are in the format of the public SM83 single step tests: one json
+ * file per opcode("27.json", "cb 37.json"), each holding an array of
+ * { name, initial, final, cycles }, where a state is the registers, ime, ie
+ * and the ram bytes touched. Every case runs one my_gb_cpu_step on a machine
+ * whose whole address space is a flat RAM, so no I/O side effect interferes,
+ * then registers, memory and the number of machine cycles are compared.
+ * Bus activity of each cycle is not checked.
+ *
+ * test/sm83 holds a small hand checked corpus, point SM83_TESTS_DIR to a
+ * checkout of the full corpus (its v1 directory) to run that instead.
+ * Cases are spread over every core, mismatches are reported by opcode.
+ */
+
+#ifndef SM83_TESTS_DEFAULT_DIR
+#define SM83_TESTS_DEFAULT_DIR "sm83"
+#endif
+
+namespace {
+
+// Just enough json for the corpus: objects, arrays, numbers, strings and literals.
+struct json {
+    enum type { null, number, string, array, object } kind = null;
+    double value = 0;
+    std::string text;
+    std::vector<json> items;
+    std::map<std::string, json> members;
+
+    const json &operator[](const std::string &key) const
+    {
+        static const json missing;
+        auto it = members.find(key);
+        return it == members.end() ? missing : it->second;
+    }
+    uint32_t u32() const { return (uint32_t)value; }
+};
+
+class json_parser {
+public:
+    explicit json_parser(const std::string &source) : s(source) {}
+
+    bool parse(json &out)
+    {
+        return value(out) && (skip(), i == s.size());
+    }
+
+private:
+    const std::string &s;
+    size_t i = 0;
+
+    void skip()
+    {
+        while (i < s.size() && (s[i] == ' ' || s[i] == '\n' || s[i] == '\r' || s[i] == '\t'))
+            ++i;
+    }
+
+    bool literal(const char *word)
+    {
+        size_t n = strlen(word);
+        if (s.compare(i, n, word) != 0)
+            return false;
+        i += n;
+        return true;
+    }
+
+    bool str(std::string &out)
+    {
+        if (s[i] != '"')
+            return false;
+        for (++i; i < s.size() && s[i] != '"'; ++i) {
+            if (s[i] == '\\' && ++i >= s.size())
+                return false;
+            out.push_back(s[i]);
+        }
+        if (i >= s.size())
+            return false;
+        ++i;
+        return true;
+    }
+
+    bool value(json &out)
+    {
+        skip();
+        if (i >= s.size())
+            return false;
+        char c = s[i];
+        if (c == '{') {
+            out.kind = json::object;
+            ++i;
+            skip();
+            if (s[i] == '}')
+                return ++i, true;
+            for (;;) {
+                std::string key;
+                skip();
+                if (!str(key))
+                    return false;
+                skip();
+                if (s[i++] != ':' || !value(out.members[key]))
+                    return false;
+                skip();
+                if (s[i] == '}')
+                    return ++i, true;
+                if (s[i++] != ',')
+                    return false;
+            }
+        }
+        if (c == '[') {
+            out.kind = json::array;
+            ++i;
+            skip();
+            if (s[i] == ']')
+                return ++i, true;
+            for (;;) {
+                out.items.emplace_back();
+                if (!value(out.items.back()))
+                    return false;
+                skip();
+                if (s[i] == ']')
+                    return ++i, true;
+                if (s[i++] != ',')
+                    return false;
+            }
+        }
+        if (c == '"') {
+            out.kind = json::string;
+            return str(out.text);
+        }
+        if (literal("null"))
+            return true;
+        if (literal("true") || literal("false")) {
+            out.kind = json::number;
+            out.value = s[i - 2] == 'u';    // tr(u)e
+            return true;
+        }
+        char *end;
+        out.kind = json::number;
+        out.value = strtod(s.c_str() + i, &end);
+        if (end == s.c_str() + i)
+            return false;
+        i = end - s.c_str();
+        return true;
+    }
+};
+
+struct sm83_case {
+    std::string opcode;     // file name without .json
+    const json *test;
+};
+
+// Opcodes of the corpus, files which are missing are skipped.
+std::vector<std::string> opcode_names()
+{
+    std::vector<std::string> names;
+    char name[8];
+    for (int i = 0; i < 0x100; ++i) {
+        snprintf(name, sizeof(name), "%02x", i);
+        names.push_back(name);
+    }
+    for (int i = 0; i < 0x100; ++i) {
+        snprintf(name, sizeof(name), "cb %02x", i);
+        names.push_back(name);
+    }
+    return names;
+}
+
+std::string corpus_dir()
+{
+    const char *dir = getenv("SM83_TESTS_DIR");
+    return dir ? dir : SM83_TESTS_DEFAULT_DIR;
+}
+
+// Flat RAM over the whole address space, one per worker.
+class sm83_bus {
+public:
+    sm83_bus() : gb(new gb_machine()), ram(0x10000)
+    {
+        my_gb_scheduler_construct(gb.get());
+        my_gb_cpu_construct(gb.get());
+        gb->cpu.BOOT = 1;
+        for (uint32_t page = 0; page < 0x100; ++page) {
+            gb->cpu.page_read[page] = &ram[page << 8];
+            gb->cpu.page_write[page] = &ram[page << 8];
+        }
+    }
+
+    ~sm83_bus()
+    {
+        my_gb_cpu_destruct(gb.get());
+    }
+
+    // Return an empty string when the case passes, what differs otherwise.
+    std::string run(const json &test)
+    {
+        const json &initial = test["initial"];
+        const json &expected = test["final"];
+        std::ostringstream diff;
+        uint32_t cycles;
+
+        for (const json &cell : initial["ram"].items)
+            ram[cell.items[0].u32()] = (uint8_t)cell.items[1].u32();
+        _registers_set(initial);
+        cycles = my_gb_cpu_step(gb.get());
+
+        _register_check(diff, "a", gb->cpu.AF >> 8, expected);
+        _register_check(diff, "f", gb->cpu.AF & 0xFF, expected);
+        _register_check(diff, "b", gb->cpu.BC >> 8, expected);
+        _register_check(diff, "c", gb->cpu.BC & 0xFF, expected);
+        _register_check(diff, "d", gb->cpu.DE >> 8, expected);
+        _register_check(diff, "e", gb->cpu.DE & 0xFF, expected);
+        _register_check(diff, "h", gb->cpu.HL >> 8, expected);
+        _register_check(diff, "l", gb->cpu.HL & 0xFF, expected);
+        _register_check(diff, "sp", gb->cpu.SP, expected);
+        _register_check(diff, "pc", gb->cpu.PC, expected);
+        _register_check(diff, "ime", gb->cpu.IME, expected);
+        for (const json &cell : expected["ram"].items) {
+            uint32_t address = cell.items[0].u32();
+            if (ram[address] != cell.items[1].u32())
+                diff << " [" << std::hex << address << "]=" << (uint32_t)ram[address]
+                     << " expected " << cell.items[1].u32();
+        }
+        if (cycles != test["cycles"].items.size())
+            diff << " cycles=" << std::dec << cycles << " expected " << test["cycles"].items.size();
+
+        // leave the bus clean for the next case
+        for (const json &cell : initial["ram"].items)
+            ram[cell.items[0].u32()] = 0;
+        for (const json &cell : expected["ram"].items)
+            ram[cell.items[0].u32()] = 0;
+        return diff.str();
+    }
+
+    // Run code placed at 0x0100 until PC reaches end, return the ops run.
+    // With skip the deadline is far ahead so that copy and fill loops are
+    // run at once, without it they go op by op.
+    uint32_t run_code(const std::vector<uint8_t> &code, uint16_t end, bool skip, uint64_t &cycles)
+    {
+        uint32_t ops = 0;
+        std::fill(ram.begin(), ram.end(), 0);
+        std::copy(code.begin(), code.end(), ram.begin() + 0x0100);
+        gb->cpu.AF = gb->cpu.BC = gb->cpu.DE = gb->cpu.HL = 0;
+        gb->cpu.flags.op = FLAG_OP_NONE;
+        gb->cpu.SP = 0xFFFE;
+        gb->cpu.PC = 0x0100;
+        gb->cpu.IME = gb->cpu.IE = gb->cpu.IF = 0;
+        gb->cpu.interrupt_pending = 0;
+        gb->cpu.is_halted = 0;
+        gb->cpu.is_stopped = 0;
+        cycles = 0;
+        while (gb->cpu.PC != end && ops < 0x10000) {
+            gb->scheduler.deadline = gb->scheduler.clock + (skip ? 0x100000 : 0);
+            cycles += my_gb_cpu_step(gb.get());
+            ++ops;
+        }
+        return ops;
+    }
+
+    const gb_machine &machine() const { return *gb; }
+    uint8_t byte(uint16_t address) const { return ram[address]; }
+
+private:
+    std::unique_ptr<gb_machine> gb;
+    std::vector<uint8_t> ram;
+
+    void _registers_set(const json &state)
+    {
+        gb->cpu.AF = (uint16_t)(state["a"].u32() << 8 | state["f"].u32());
+        gb->cpu.flags.op = FLAG_OP_NONE;
+        gb->cpu.BC = (uint16_t)(state["b"].u32() << 8 | state["c"].u32());
+        gb->cpu.DE = (uint16_t)(state["d"].u32() << 8 | state["e"].u32());
+        gb->cpu.HL = (uint16_t)(state["h"].u32() << 8 | state["l"].u32());
+        gb->cpu.SP = (uint16_t)state["sp"].u32();
+        gb->cpu.PC = (uint16_t)state["pc"].u32();
+        gb->cpu.IME = (uint8_t)state["ime"].u32();
+        gb->cpu.IE = (uint8_t)state["ie"].u32();
+        gb->cpu.IF = 0;
+        gb->cpu.interrupt_pending = 0;
+        gb->cpu.is_halted = 0;
+        gb->cpu.is_stopped = 0;
+        // nothing to sleep to or skip before
+        gb->scheduler.deadline = gb->scheduler.clock;
+    }
+
+    static void _register_check(std::ostringstream &diff, const char *name, uint32_t value, const json &expected)
+    {
+        if (expected[name].kind == json::number && value != expected[name].u32())
+            diff << " " << name << "=" << std::hex << value << " expected " << expected[name].u32();
+    }
+};
+
+}
+
+TEST(sm83_single_step_test, corpus)
+{
+    std::vector<std::unique_ptr<json>> files;
+    std::vector<sm83_case> cases;
+    std::string dir = corpus_dir();
+
+    for (const std::string &opcode : opcode_names()) {
+        std::ifstream in(dir + "/" + opcode + ".json", std::ios::binary);
+        if (!in)
+            continue;
+        std::stringstream source;
+        source << in.rdbuf();
+        files.emplace_back(new json());
+        ASSERT_TRUE(json_parser(source.str()).parse(*files.back())) << opcode << ".json is not valid json";
+        for (const json &test : files.back()->items)
+            cases.push_back({ opcode, &test });
+    }
+    ASSERT_FALSE(cases.empty()) << "no test case found in " << dir;
+
+    std::atomic<size_t> next(0);
+    std::mutex report_lock;
+    std::map<std::string, std::pair<size_t, std::string>> failures;   // opcode -> count, first failure
+    uint32_t worker_count = std::thread::hardware_concurrency();
+    std::vector<std::thread> workers;
+
+    if (worker_count == 0)
+        worker_count = 1;
+    for (uint32_t w = 0; w < worker_count; ++w) {
+        workers.emplace_back([&]() {
+            sm83_bus bus;
+            for (size_t i = next++; i < cases.size(); i = next++) {
+                std::string diff = bus.run(*cases[i].test);
+                if (diff.empty())
+                    continue;
+                std::lock_guard<std::mutex> guard(report_lock);
+                auto &failure = failures[cases[i].opcode];
+                if (failure.first++ == 0)
+                    failure.second = (*cases[i].test)["name"].text + ":" + diff;
+            }
+        });
+    }
+    for (std::thread &worker : workers)
+        worker.join();
+
+    size_t failed = 0;
+    for (const auto &failure : failures) {
+        ADD_FAILURE() << "opcode " << failure.first << ": " << failure.second.first
+                      << " cases failed, first " << failure.second.second;
+        failed += failure.second.first;
+    }
+    printf("%zu cases of %zu files on %u threads, %zu failed\n",
+        cases.size(), files.size(), worker_count, failed);
+}
+
+// A fill loop reloading A while DEC BC; LD A,B; OR C counts down
+// must fill with the reloaded value, not with A left by the counter.
+TEST(copy_loop_test, fill_reload_bc)
+{
+    const std::vector<uint8_t> code = {
+        0x21, 0x00, 0xC0,   // LD HL,C000
+        0x01, 0x00, 0x01,   // LD BC,0100
+        0x3E, 0x55,         // loop: LD A,55
+        0x22,               // LD (HL+),A
+        0x0B,               // DEC BC
+        0x78,               // LD A,B
+        0xB1,               // OR C
+        0x20, 0xF8,         // JR NZ,loop
+        0x00,               // end: NOP
+    };
+    sm83_bus skipped, stepped;
+    uint64_t skipped_cycles, stepped_cycles;
+    uint32_t skipped_ops = skipped.run_code(code, 0x010E, true, skipped_cycles);
+    uint32_t stepped_ops = stepped.run_code(code, 0x010E, false, stepped_cycles);
+
+    // the loop was run at once
+    EXPECT_LT(skipped_ops, stepped_ops);
+    for (uint32_t address = 0xC000; address < 0xC100; ++address)
+        ASSERT_EQ(skipped.byte(address), 0x55) << std::hex << address;
+    EXPECT_EQ(skipped.byte(0xC100), 0x00);
+    EXPECT_EQ(skipped_cycles, stepped_cycles);
+    EXPECT_EQ(skipped.machine().cpu.AF, stepped.machine().cpu.AF);
+    EXPECT_EQ(skipped.machine().cpu.BC, stepped.machine().cpu.BC);
+    EXPECT_EQ(skipped.machine().cpu.HL, stepped.machine().cpu.HL);
+}
+
+// Code written to HRAM and across a WRAM page boundary, then patched.
+// Stack writes to HRAM must not drop the HRAM routine, writes to its
+// operand(and to an operand crossing into the next page) must.
+TEST(block_cache_test, hram_and_page_crossing)
+{
+    const std::vector<uint8_t> code = {
+        0xF3,               // DI
+        0x31, 0xFE, 0xFF,   // LD SP,FFFE
+        0x21, 0x80, 0xFF,   // LD HL,FF80
+        0x36, 0x3E,         // LD (HL),3E       FF80: LD A,11
+        0x23,               // INC HL
+        0x36, 0x11,         // LD (HL),11
+        0x23,               // INC HL
+        0x36, 0xC9,         // LD (HL),C9       FF82: RET
+        0xCD, 0x80, 0xFF,   // CALL FF80
+        0x47,               // LD B,A
+        0xC5,               // PUSH BC
+        0xC1,               // POP BC
+        0xCD, 0x80, 0xFF,   // CALL FF80
+        0x3E, 0x22,         // LD A,22
+        0xEA, 0x81, 0xFF,   // LD (FF81),A
+        0xCD, 0x80, 0xFF,   // CALL FF80
+        0x4F,               // LD C,A
+        0x21, 0xFF, 0xC0,   // LD HL,C0FF
+        0x36, 0x3E,         // LD (HL),3E       C0FF: LD A,33
+        0x23,               // INC HL
+        0x36, 0x33,         // LD (HL),33
+        0x23,               // INC HL
+        0x36, 0xC9,         // LD (HL),C9       C101: RET
+        0xCD, 0xFF, 0xC0,   // CALL C0FF
+        0x57,               // LD D,A
+        0x3E, 0x44,         // LD A,44
+        0xEA, 0x00, 0xC1,   // LD (C100),A
+        0xCD, 0xFF, 0xC0,   // CALL C0FF
+        0x5F,               // LD E,A
+        0x18, 0xFE,         // end: JR end
+    };
+    const uint16_t end = (uint16_t)(0x0150 + code.size() - 2);
+    const char *rom = "block_cache_test.gb";
+    std::vector<uint8_t> image(0x8000, 0);
+    const uint8_t entry[] = { 0x00, 0xC3, 0x50, 0x01 };   // NOP, JP 0150
+    std::copy(entry, entry + sizeof(entry), image.begin() + 0x0100);
+    std::copy(code.begin(), code.end(), image.begin() + 0x0150);
+    std::ofstream(rom, std::ios::binary).write((const char *)image.data(), image.size());
+
+    std::unique_ptr<gb_machine> gb(new gb_machine());
+    ASSERT_EQ(my_gb_machine_construct(gb.get(), rom, NULL), 0);
+    my_gb_cpu_skip_boot(gb.get());
+    for (uint32_t i = 0; i < 100 && gb->cpu.PC != end; ++i)
+        my_gb_machine_run(gb.get(), 1000);
+
+    EXPECT_EQ(gb->cpu.PC, end);
+    EXPECT_EQ(gb->cpu.BC, 0x1122);
+    EXPECT_EQ(gb->cpu.DE, 0x3344);
+    // only the patch of the operand hit the HRAM routine
+    EXPECT_EQ(gb->cpu.code_generation[0xFF], 1u);
+    my_gb_machine_destruct(gb.get());
+    std::remove(rom);
+}
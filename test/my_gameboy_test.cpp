@@ -1,9 +1,9 @@
-#include"gtest/gtest.h"
-extern "C" {
-#include"../src/src/body/screen.c"
-}
-
-TEST(color_parse_test, 0)
-{
-
+#include"gtest/gtest.h"
+extern "C" {
+#include"../src/src/body/screen.c"
+}
+
+TEST(color_parse_test, 0)
+{
+
 }
\ No newline at end of file